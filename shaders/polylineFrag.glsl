@@ -0,0 +1,30 @@
+#version 330 core
+// Fragment shader for the thick polylines expanded in polylineVert.glsl
+
+
+
+in vec4 vertexColor;
+// Colour interpolated along the segment
+
+in float edgeCoordinate;
+// -1 and 1 on the two edges of the line, 0 on its centre
+
+
+
+uniform float lineWidth;
+// Line width in pixels, sets how much of the edge is faded
+
+
+
+out vec4 FragColor;
+// Output variable for the final fragment color (RGBA)
+
+
+
+void main() {
+    // Fade the outermost pixel on each side instead of leaving a hard, aliased edge
+    float feather = min(1.0, 2.0 / max(lineWidth, 1.0));
+    float coverage = 1.0 - smoothstep(1.0 - feather, 1.0, abs(edgeCoordinate));
+
+    FragColor = vec4(vertexColor.rgb, vertexColor.a * coverage);
+}
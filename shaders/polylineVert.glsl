@@ -0,0 +1,250 @@
+#version 330 core
+// Thick polyline expansion; one instance per segment, nine vertices each (see PolylineRenderer)
+
+
+
+uniform samplerBuffer positions;
+// Point positions, three floats per point
+
+
+
+uniform samplerBuffer colors;
+// Optional per-point RGBA colours
+
+
+
+uniform usamplerBuffer indices;
+// Optional index list into the points, e.g. one simplification level of the path
+
+
+
+uniform usamplerBuffer stripIds;
+// Strip each point belongs to when many strips share the point buffer
+
+
+
+uniform samplerBuffer stripColors;
+// RGBA colour per strip when many strips share the point buffer
+
+
+
+uniform int packedStrips;
+// 1 for multi-draws of many strips: the vertex ID encodes the segment, neighbours must carry the same strip ID
+
+uniform int useColors;
+// 1 when the colour buffer holds one colour per point
+
+uniform int useIndices;
+// 1 when the vertices of the strip are read through the index list
+
+uniform int firstVertex;
+// First vertex of the strip, in the index list when useIndices is 1
+
+uniform int vertexCount;
+// Number of vertices in the strip, the draw has vertexCount - 1 instances
+
+
+
+uniform mat4 view;
+// Uniform matrix for transforming world space to camera (view) space
+
+uniform mat4 projection;
+// Uniform matrix for transforming camera (view) space to clip space
+
+uniform vec2 viewportSize;
+// Viewport size in pixels, widths are measured on screen
+
+
+
+uniform vec4 lineColor;
+// Base colour, multiplied with the per-point colour when there is one
+
+uniform float lineWidth;
+// Line width in pixels
+
+uniform float miterLimit;
+// Longest miter allowed, in half widths; sharper joins get a bevel instead
+
+uniform float depthBias;
+// Fraction of the eye distance the line is pulled towards the camera so it wins against the ground it lies on
+
+
+
+out vec4 vertexColor;
+// Colour of the segment end this vertex belongs to
+
+out float edgeCoordinate;
+// -1 and 1 on the two edges of the line, 0 on its centre, used for the anti-aliased border
+
+
+
+const int VERTICES_PER_SEGMENT = 9;
+// Two body triangles and one bevel triangle per segment
+
+
+
+const float NEAR_W = 1e-4;
+// Segments are clipped where they pass behind the eye before they are projected
+
+
+
+// Body corners as (end, side): two triangles spanning the segment from end 0 to end 1
+const vec2 BODY_CORNERS[6] = vec2[6](
+    vec2(0.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(0.0, -1.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+);
+
+
+
+int pointIndex(int vertex) {
+    // Index of the strip vertex in the point buffer
+    return useIndices == 1 ? int(texelFetch(indices, firstVertex + vertex).r) : firstVertex + vertex;
+}
+
+
+
+vec4 projectPoint(int vertex) {
+    // Fetch a point and move it to clip space, pulled towards the eye by the depth bias
+    // Scaling the view-space position keeps it on the same screen pixel and only changes its depth
+    int base = pointIndex(vertex) * 3;
+    vec3 position = vec3(texelFetch(positions, base).r, texelFetch(positions, base + 1).r, texelFetch(positions, base + 2).r);
+    vec4 viewPosition = view * vec4(position, 1.0);
+    viewPosition.xyz *= 1.0 - depthBias;
+    return projection * viewPosition;
+}
+
+
+
+vec2 toScreen(vec4 clip) {
+    // Clip space to pixels, relative to the centre of the viewport
+    return clip.xy / clip.w * 0.5 * viewportSize;
+}
+
+
+
+vec2 direction(vec2 from, vec2 to, vec2 fallback) {
+    // Unit direction on screen, or the fallback for segments that project to a point
+    vec2 delta = to - from;
+    float len = length(delta);
+    return len > 1e-4 ? delta / len : fallback;
+}
+
+
+
+vec2 jointOffset(vec2 dirIn, vec2 dirOut, vec2 segmentNormal, out bool bevel) {
+    // Offset of the joint corner on the positive side, in half widths
+    // The miter lies along the bisector of the two normals; it is as long as needed to keep the width constant
+    vec2 tangent = dirIn + dirOut;
+    if (dot(tangent, tangent) < 1e-6) {
+        bevel = true;
+        return segmentNormal;
+    }
+
+    tangent = normalize(tangent);
+    vec2 miter = vec2(-tangent.y, tangent.x);
+    float scale = 1.0 / max(dot(miter, segmentNormal), 1e-3);
+
+    // Past the limit the corner is cut off; the segment keeps its own normal and the gap is filled by a bevel triangle
+    bevel = scale > miterLimit;
+    return bevel ? segmentNormal : miter * scale;
+}
+
+
+
+void main() {
+    int segment = gl_InstanceID;
+    int corner = gl_VertexID;
+
+    // Packed strips are drawn with glMultiDrawArrays, each strip's range starting at its first segment
+    if (packedStrips == 1) {
+        segment = gl_VertexID / VERTICES_PER_SEGMENT;
+        corner = gl_VertexID - segment * VERTICES_PER_SEGMENT;
+    }
+
+    vec4 clipA = projectPoint(segment);
+    vec4 clipB = projectPoint(segment + 1);
+
+    // Segment entirely behind the eye: emit a vertex outside the clip volume
+    if (clipA.w < NEAR_W && clipB.w < NEAR_W) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        vertexColor = vec4(0.0);
+        edgeCoordinate = 0.0;
+        return;
+    }
+
+    // Clip the part behind the eye so the screen direction stays meaningful
+    if (clipA.w < NEAR_W) clipA = mix(clipA, clipB, (NEAR_W - clipA.w) / (clipB.w - clipA.w));
+    if (clipB.w < NEAR_W) clipB = mix(clipB, clipA, (NEAR_W - clipB.w) / (clipA.w - clipB.w));
+
+    vec2 screenA = toScreen(clipA);
+    vec2 screenB = toScreen(clipB);
+    vec2 dir = direction(screenA, screenB, vec2(1.0, 0.0));
+    vec2 normal = vec2(-dir.y, dir.x);
+
+    // Neighbouring segments; missing, in another strip or behind the eye means the joint is square
+    bool hasPrev = segment > 0;
+    bool hasNext = segment + 2 < vertexCount;
+    uint strip = 0u;
+    if (packedStrips == 1) {
+        strip = texelFetch(stripIds, pointIndex(segment)).r;
+        hasPrev = hasPrev && texelFetch(stripIds, pointIndex(segment - 1)).r == strip;
+        hasNext = hasNext && texelFetch(stripIds, pointIndex(segment + 2)).r == strip;
+    }
+
+    vec2 dirPrev = dir;
+    if (hasPrev) {
+        vec4 clipPrev = projectPoint(segment - 1);
+        if (clipPrev.w >= NEAR_W) dirPrev = direction(toScreen(clipPrev), screenA, dir);
+    }
+
+    vec2 dirNext = dir;
+    if (hasNext) {
+        vec4 clipNext = projectPoint(segment + 2);
+        if (clipNext.w >= NEAR_W) dirNext = direction(screenB, toScreen(clipNext), dir);
+    }
+
+    bool bevelStart;
+    bool bevelEnd;
+    vec2 offsetStart = jointOffset(dirPrev, dir, normal, bevelStart);
+    vec2 offsetEnd = jointOffset(dir, dirNext, normal, bevelEnd);
+
+    float halfWidth = 0.5 * lineWidth;
+    float end;
+    vec2 offset;
+
+    if (corner < 6) {
+        // Segment body
+        end = BODY_CORNERS[corner].x;
+        edgeCoordinate = BODY_CORNERS[corner].y;
+        offset = (end == 0.0 ? offsetStart : offsetEnd) * edgeCoordinate;
+    }
+    else {
+        // Bevel triangle on the outer side of the start joint, collapsed to a point for mitered joints
+        end = 0.0;
+        float side = (dirPrev.x * dir.y - dirPrev.y * dir.x) > 0.0 ? -1.0 : 1.0;
+        vec2 normalPrev = vec2(-dirPrev.y, dirPrev.x);
+
+        if (!bevelStart || corner == 6) {
+            offset = vec2(0.0);
+            edgeCoordinate = 0.0;
+        }
+        else {
+            offset = (corner == 7 ? normalPrev : normal) * side;
+            edgeCoordinate = side;
+        }
+    }
+
+    // Back to clip space at the depth of the segment end
+    vec4 clip = end == 0.0 ? clipA : clipB;
+    vec2 screen = (end == 0.0 ? screenA : screenB) + offset * halfWidth;
+    gl_Position = vec4(screen / (0.5 * viewportSize) * clip.w, clip.z, clip.w);
+
+    // Colour of the end point, interpolated along the segment
+    vertexColor = lineColor;
+    if (useColors == 1) {
+        vertexColor *= texelFetch(colors, pointIndex(segment + int(end)));
+    }
+    if (packedStrips == 1) {
+        vertexColor *= texelFetch(stripColors, int(strip));
+    }
+}
@@ -0,0 +1,9 @@
+#version 330 core
+// Depth-only pass for the cascaded shadow maps
+
+
+
+void main()
+{
+    // No colour output, only the depth written by the rasterizer is kept
+}
@@ -0,0 +1,23 @@
+#version 330 core
+// Depth-only pass for the cascaded shadow maps
+
+
+
+layout(location = 0) in vec3 aPos;
+// Input attribute at location 0, the vertex position (x, y, z); other attributes are ignored
+
+
+
+uniform mat4 model;
+// Uniform matrix for transforming object space to world space
+
+uniform mat4 lightSpaceMatrix;
+// Orthographic projection times view of the cascade being rendered
+
+
+
+void main()
+{
+    // Transform the vertex straight into the cascade's clip space
+    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+}
@@ -49,15 +49,153 @@ uniform vec3 viewPos;
 
 
 
+// Uniforms for single-pass material splatting
+uniform sampler2DArray materials;
+// Albedo layers in weight-channel order: grass, dirt, rock, snow
+
+uniform sampler2D splatWeights;
+// Per-vertex layer weights baked on the CPU from altitude and slope, one texel per grid vertex
+
+uniform bool useSplatting;
+// False for geometry without baked weights, which falls back to the height colouring
+
+uniform vec2 terrainOrigin;
+// World-space XZ position of grid vertex (0, 0)
+
+uniform float terrainCellSize;
+// World-space distance between neighbouring grid vertices
+
+uniform vec2 terrainGridSize;
+// Number of grid vertices along X and Z, the size of the weight texture
+
+uniform float materialTiling;
+// Material repeats per world unit
+
+
+
+// Uniforms for the baked detail normal map
+uniform sampler2D normalMap;
+// Full-resolution normal X and Z per grid vertex, Y is reconstructed below
+
+uniform bool useNormalMap;
+// When set, shading uses the baked normals instead of the interpolated vertex normals
+
+
+
+// Uniforms for the cascaded sun shadows
+uniform sampler2DArrayShadow shadowMap;
+// Depth layers with hardware comparison; the cascades start at shadowLayerOffset
+
+uniform bool useShadows;
+// False until the shadow maps have been initialized
+
+uniform vec3 sunDirection;
+// Towards the sun the cascades were rendered from; direct light uses it so shading and shadows agree
+
+uniform int cascadeCount;
+// Number of cascades in use
+
+uniform int shadowLayerOffset;
+// Array layer of cascade 0, the layers below hold the cached static depth
+
+uniform mat4 lightSpaceMatrices[4];
+// World to light clip space for each cascade
+
+uniform float cascadeSplits[4];
+// View-space depth where each cascade ends
+
+uniform float shadowTexelSize;
+// Size of one shadow map texel in texture coordinates
+
+uniform mat4 view;
+// Camera view matrix, used to pick the cascade from the fragment's view depth
+
+
+
+// Uniforms for the walking-time overlay
+uniform sampler2D isochroneMap;
+// Seconds from the nearest seed per grid vertex, infinity where nothing reaches
+
+uniform bool useIsochrones;
+// True while the overlay is shown
+
+uniform float isochroneInterval;
+// Seconds covered by one band
+
+uniform int isochroneBandCount;
+// Number of bands, fragments beyond the last one are left untinted
+
+
+
+// Returns 1.0 for lit and 0.0 for fully shadowed fragments
+float computeShadow(vec3 normal, vec3 lightDir) {
+
+    // Pick the first cascade whose range contains the fragment
+    float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+    int cascade = cascadeCount - 1;
+
+    for (int i = 0; i < cascadeCount; ++i) {
+        if (viewDepth < cascadeSplits[i]) {
+            cascade = i;
+            break;
+        }
+    }
+
+    // Nothing beyond the last cascade is shadowed
+    if (viewDepth > cascadeSplits[cascadeCount - 1]) {
+        return 1.0;
+    }
+
+
+
+    // Project into the cascade and map to [0, 1] texture space
+    vec4 lightClip = lightSpaceMatrices[cascade] * vec4(FragPos, 1.0);
+    vec3 shadowCoord = lightClip.xyz / lightClip.w * 0.5 + 0.5;
+
+    // Slope-scaled bias on top of the polygon offset used when rendering the depth
+    float bias = max(0.0015 * (1.0 - dot(normal, lightDir)), 0.0003);
+    float layer = float(shadowLayerOffset + cascade);
+
+
+
+    // 3x3 PCF, each fetch is already a bilinear 2x2 comparison
+    float lit = 0.0;
+
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            vec2 offset = vec2(x, y) * shadowTexelSize;
+            lit += texture(shadowMap, vec4(shadowCoord.xy + offset, layer, shadowCoord.z - bias));
+        }
+    }
+
+    return lit / 9.0;
+}
+
+
+
 void main() {
 
+    // Texel centres sit on grid vertices, so shift by half a texel
+    vec2 gridUV = ((FragPos.xz - terrainOrigin) / terrainCellSize + 0.5) / terrainGridSize;
+
+
+
     // Normalize the surface normal for accurate lighting calculations
     vec3 norm = normalize(Normal);
 
 
 
-    // Compute the light direction vector from the fragment to the light source
-    vec3 lightDir = normalize(light.position - FragPos);
+    // Take the normal from the full-resolution bake so lighting does not depend on mesh density
+    if (useNormalMap) {
+        vec2 normalXZ = texture(normalMap, gridUV).rg;
+        norm = normalize(vec3(normalXZ.x, sqrt(max(1.0 - dot(normalXZ, normalXZ), 0.0)), normalXZ.y));
+    }
+
+
+
+    // Direction towards the sun; the same one the shadow cascades are fitted to, so the slope bias
+    // and the lit side of N.L match the shadow map
+    vec3 lightDir = normalize(sunDirection);
 
 
 
@@ -98,8 +236,84 @@ void main() {
 
 
 
-    // Combine ambient, diffuse, and specular lighting with height-based coloring
-    vec3 result = (ambient + diffuse + specular) * heightColor;
+    // Replace the height colouring with the two dominant material layers
+    vec3 surfaceColor = heightColor;
+
+    if (useSplatting) {
+
+        vec4 weights = texture(splatWeights, gridUV);
+
+
+
+        // Pick the two heaviest layers so every fragment costs exactly two array fetches
+        float firstWeight = weights.x;
+        float firstLayer = 0.0;
+        float secondWeight = -1.0;
+        float secondLayer = 0.0;
+
+        for (int i = 1; i < 4; ++i) {
+            float w = weights[i];
+
+            if (w > firstWeight) {
+                secondWeight = firstWeight;
+                secondLayer = firstLayer;
+                firstWeight = w;
+                firstLayer = float(i);
+            } else if (w > secondWeight) {
+                secondWeight = w;
+                secondLayer = float(i);
+            }
+        }
+
+
+
+        // Renormalize the pair, the dropped layers' share goes to the two that remain
+        float pairTotal = max(firstWeight + secondWeight, 1e-4);
+        vec2 materialUV = FragPos.xz * materialTiling;
+        vec3 firstColor = texture(materials, vec3(materialUV, firstLayer)).rgb;
+        vec3 secondColor = texture(materials, vec3(materialUV, secondLayer)).rgb;
+        surfaceColor = (firstColor * firstWeight + secondColor * secondWeight) / pairTotal;
+    }
+
+
+
+    // Tint the surface by walking-time band, from green near the seeds to red at the limit
+    if (useIsochrones) {
+
+        float travelTime = texture(isochroneMap, gridUV).r;
+        float bands = travelTime / isochroneInterval;
+
+        if (bands < float(isochroneBandCount)) {
+            float band = floor(bands);
+            float ramp = isochroneBandCount > 1 ? band / float(isochroneBandCount - 1) : 0.0;
+            vec3 bandColor = mix(vec3(0.1, 0.8, 0.2), vec3(0.9, 0.2, 0.1), ramp);
+            surfaceColor = mix(surfaceColor, bandColor, 0.35);
+        }
+
+
+
+        // Dark contour where a band ends, about one pixel wide at any distance
+        float contourDistance = abs(bands - round(bands));
+        float contour = 1.0 - smoothstep(0.0, 1.5 * fwidth(bands), contourDistance);
+
+        if (bands > 0.5 && bands < float(isochroneBandCount) + 0.5) {
+            surfaceColor = mix(surfaceColor, vec3(0.05), contour * 0.8);
+        }
+    }
+
+
+
+    // Only direct light is blocked by the sun shadows, ambient stays
+    float shadow = 1.0;
+
+    if (useShadows) {
+        shadow = computeShadow(norm, lightDir);
+    }
+
+
+
+    // Combine ambient, diffuse, and specular lighting with the surface colour
+    vec3 result = (ambient + shadow * (diffuse + specular)) * surfaceColor;
 
 
 
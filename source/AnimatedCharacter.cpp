@@ -4,13 +4,22 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
 #include <iostream>
+#include <utility>
+
+namespace {
+    constexpr float TRACE_WIDTH_PIXELS = 3.0f;
+}
 
 // Constructor
 AnimatedCharacter::AnimatedCharacter()
-    : characterVAO(0), characterVBO(0), traceVAO(0), traceVBO(0),
+    : characterVAO(0), characterVBO(0),
     characterPosition(0.0f), previousPosition(0.0f),
     progress(0.0f), currentPathIndex(0),
+    distanceTravelled(0.0f),
+    playbackRate(0.0f),
+    playbackTime(0.0),
     movementSpeed(15.0f), // Base movement speed
     characterScale(1.0f),
     currentSpeed(0.0f),
@@ -106,26 +115,48 @@ void AnimatedCharacter::setupCharacterBuffers() {
     std::cout << "INFO: Character buffers initialized." << std::endl;
 }
 
-//generated VAO and VBO 
+//buffer textures read by the polyline shader
 void AnimatedCharacter::setupTraceBuffers() {
-    glGenVertexArrays(1, &traceVAO);
-    glGenBuffers(1, &traceVBO);
+    traceRenderer.initialize();
 }
 
 
-void AnimatedCharacter::loadPathData(const std::vector<glm::vec3>& path) {
-    pathPoints = path; //stores the provided path point
-    if (!pathPoints.empty()) {
-        characterPosition = pathPoints[0]; // starting position
+void AnimatedCharacter::loadPathData(PathData::Ptr pathData) {
+    path = std::move(pathData); //one more reference to the shared path, no copy of the points
+    distanceTravelled = 0.0f;
+    playbackTime = 0.0;
+    if (path && !path->isEmpty()) {
+        characterPosition = path->getPoints()[0]; // starting position
         previousPosition = characterPosition; //sets the previous postion
     }
-    setupCharacterBuffers(); //set openGL buffer for renderings
-    setupTraceBuffers();
+    if (characterVAO == 0) {
+        setupCharacterBuffers(); //set openGL buffer for renderings, once; later paths reuse them
+        setupTraceBuffers();
+    }
+}
+
+float AnimatedCharacter::slopeSpeedMultiplier(float slope) {
+    // Adjust speed based on slope
+    float speedMultiplier;
+    if (slope > 0.0f) {
+        // Uphill: slower
+        speedMultiplier = 1.0f / (1.0f + slope * 5.0f); //produces a value less than 0
+    }
+    else {
+        // Downhill: faster
+        speedMultiplier = 1.0f - slope * 2.0f; 
+    }
+
+    // Clamp speedMultiplier to prevent negative speeds
+    speedMultiplier = glm::clamp(speedMultiplier, 0.2f, 2.0f);
+    return speedMultiplier;
 }
 
-void AnimatedCharacter::updatePosition(float deltaTime, const Terrain& terrain) {
+void AnimatedCharacter::updatePosition(float deltaTime, const HeightSource& terrain) {
     //path point validaty check
-    if (pathPoints.empty() || simulationFinished) return;
+    if (!path || path->isEmpty() || simulationFinished) return;
+    const std::vector<glm::vec3>& pathPoints = path->getPoints();
+    const ArcLengthTable& arcLength = path->getArcLength();
 
     //starting simulation
     if (!simulationStarted) {
@@ -133,63 +164,55 @@ void AnimatedCharacter::updatePosition(float deltaTime, const Terrain& terrain)
         std::cout << "Simulation Started" << std::endl;
     }
 
-    //checking the path index is greater then the pathPoint
-    if (currentPathIndex >= pathPoints.size() - 1) {
+    //checking the path has at least one segment
+    if (pathPoints.size() < 2) {
         simulationFinished = true;
         std::cout << "Simulation Finished" << std::endl;
         return;
     }
 
-    glm::vec3 start = pathPoints[currentPathIndex];
-    glm::vec3 end = pathPoints[currentPathIndex + 1];
-
-    float distance = glm::distance(start, end);
-
-    // Ensure distance is not zero to avoid division by zero
-    if (distance < 0.0001f) {
-        currentPathIndex++;
-        progress = 0.0f;
-        return;
-    }
-
-    // Calculate slope (height difference over horizontal distance)
-    float heightDiff = end.y - start.y;
-    float horizontalDistance = glm::distance(glm::vec2(start.x, start.z), glm::vec2(end.x, end.z));
-
-    //A small threshold(0.0001f) is used to avoid division by zero or extremely small numbers
-    float slope = (horizontalDistance > 0.0001f) ? (heightDiff / horizontalDistance) : 0.0f;
+    const TimeTable& timeTable = path->getTimeTable();
+    const bool timed = isTimedPlayback();
 
-    // Adjust speed based on slope
-    float speedMultiplier;
-    if (slope > 0.0f) {
-        // Uphill: slower
-        speedMultiplier = 1.0f / (1.0f + slope * 5.0f); //produces a value less than 0
+    if (timed) {
+        // The recorded clock advances and the distance is looked up from it, one binary search
+        // whatever the rate, so fast-forwarding costs the same per frame as real time
+        playbackTime = std::min(playbackTime + static_cast<double>(deltaTime) * playbackRate, timeTable.getDuration());
+        distanceTravelled = timeTable.getDistanceAtTime(playbackTime);
+        if (playbackTime >= timeTable.getDuration()) {
+            simulationFinished = true;
+            std::cout << "Simulation Finished" << std::endl;
+        }
     }
     else {
-        // Downhill: faster
-        speedMultiplier = 1.0f - slope * 2.0f; 
-    }
+        // The segment under the character sets the slope
+        size_t segment = arcLength.findSegment(distanceTravelled);
+        glm::vec3 start = pathPoints[segment];
+        glm::vec3 end = pathPoints[segment + 1];
 
-    // Clamp speedMultiplier to prevent negative speeds
-    speedMultiplier = glm::clamp(speedMultiplier, 0.2f, 2.0f);
+        // Calculate slope (height difference over horizontal distance)
+        float heightDiff = end.y - start.y;
+        float horizontalDistance = glm::distance(glm::vec2(start.x, start.z), glm::vec2(end.x, end.z));
 
-    float adjustedSpeed = movementSpeed * speedMultiplier;
+        //A small threshold(0.0001f) is used to avoid division by zero or extremely small numbers
+        float slope = (horizontalDistance > 0.0001f) ? (heightDiff / horizontalDistance) : 0.0f;
 
-    //Tracks the current position along the path, ranging from 0.0 to 1.0
-    progress += (adjustedSpeed * deltaTime) / distance;
+        float adjustedSpeed = movementSpeed * slopeSpeedMultiplier(slope);
 
-    if (progress >= 1.0f) {
-        progress = 0.0f; // Reset progress for the next segment
-        currentPathIndex++; // Move to the next path segment
-        if (currentPathIndex >= pathPoints.size() - 1) {
+        // Advance along the arc length; a large step may cross several segments at once
+        distanceTravelled += adjustedSpeed * deltaTime;
+        if (distanceTravelled >= arcLength.getTotalLength()) {
+            distanceTravelled = arcLength.getTotalLength();
             simulationFinished = true;
             std::cout << "Simulation Finished" << std::endl;
-            return;
         }
     }
 
-    // mix Interpolate position between start and end based on progress
-    characterPosition = glm::mix(start, end, progress);
+    // Binary search for the segment, then interpolate within it
+    ArcLengthTable::Sample sample = arcLength.sample(distanceTravelled);
+    currentPathIndex = sample.segment;
+    progress = sample.t; //position within the current segment, ranging from 0.0 to 1.0
+    characterPosition = sample.position;
 
     // Ensure character stays above terrain
     float terrainHeight = terrain.getHeightAtPosition(characterPosition.x, characterPosition.z);
@@ -202,6 +225,14 @@ void AnimatedCharacter::updatePosition(float deltaTime, const Terrain& terrain)
     float distanceMoved = glm::length(movement);
     currentSpeed = distanceMoved / deltaTime;
 
+    // Recorded speed relative to the hike's average, mapped onto movementSpeed so the trace colours
+    // mean the same at any playback rate
+    if (timed && deltaTime > 0.0f) {
+        float averageSpeed = static_cast<float>(arcLength.getTotalLength() / timeTable.getDuration());
+        float recordedSpeed = distanceMoved / (deltaTime * playbackRate);
+        currentSpeed = averageSpeed > 0.0f ? recordedSpeed / averageSpeed * movementSpeed : movementSpeed;
+    }
+
     // Store position and speed
     tracePositions.push_back(characterPosition);
     traceSpeeds.push_back(currentSpeed);
@@ -210,11 +241,7 @@ void AnimatedCharacter::updatePosition(float deltaTime, const Terrain& terrain)
     previousPosition = characterPosition;
 }
 
-void AnimatedCharacter::render(const glm::mat4& view, const glm::mat4& projection, Shader& shader) {
-
-    //shader activation
-    shader.use();
-
+glm::mat4 AnimatedCharacter::getModelMatrix() const {
     //modelMatrix = Translates the character to its position in the world.
     glm::mat4 model = glm::translate(glm::mat4(1.0f), characterPosition);
 
@@ -228,10 +255,16 @@ void AnimatedCharacter::render(const glm::mat4& view, const glm::mat4& projectio
 
 
     //uniform scale based on characterScale
-    model = glm::scale(model, glm::vec3(characterScale));
+    return glm::scale(model, glm::vec3(characterScale));
+}
+
+void AnimatedCharacter::render(const glm::mat4& view, const glm::mat4& projection, Shader& shader) {
+
+    //shader activation
+    shader.use();
 
     // The shader uses this matrix to transform the characters vertices to world space.
-    shader.setMat4("model", model);
+    shader.setMat4("model", getModelMatrix());
 
     // Set object color based on speed
     glm::vec3 color = getColorBasedOnSpeed(currentSpeed);
@@ -253,78 +286,54 @@ void AnimatedCharacter::render(const glm::mat4& view, const glm::mat4& projectio
     glBindVertexArray(0);
 }
 
-void AnimatedCharacter::renderTrace(const glm::mat4& view, const glm::mat4& projection, Shader& shader) {
-
-    if (tracePositions.empty()) return;
-
-    //A static vector stores the trace's data(position and color)
-    static std::vector<float> vertexData;
-
-    //Clears any previous data in the vector.
-    vertexData.clear();
-
-    //required 3 flots for color and position respectively
-    vertexData.reserve(tracePositions.size() * 6); // Reserve memory to avoid reallocations
+void AnimatedCharacter::renderDepth(Shader& depthShader) const {
+    if (!path || path->isEmpty()) return;
 
+    // Same cube as render, the shadow pass has already set the light matrices
+    depthShader.setMat4("model", getModelMatrix());
+    glBindVertexArray(characterVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    glBindVertexArray(0);
+}
 
-    for (size_t i = 0; i < tracePositions.size(); ++i) {
-        glm::vec3 pos = tracePositions[i]; // Gets the position of a point in the trace
-        glm::vec3 color = getColorBasedOnSpeed(traceSpeeds[i]); //Calculates the color of the trace point based on its speed.
+void AnimatedCharacter::renderTrace(const glm::mat4& view, const glm::mat4& projection, Shader& shader) {
 
-        
-        //Appends each positions x, y, z
-        vertexData.push_back(pos.x);
-        vertexData.push_back(pos.y);
-        vertexData.push_back(pos.z);
+    if (tracePositions.size() < 2) return;
 
-        // Color
-        vertexData.push_back(color.r);
-        vertexData.push_back(color.g);
-        vertexData.push_back(color.b);
+    //Colours are kept per point so only the new ones are computed each frame
+    while (traceColors.size() < traceSpeeds.size()) {
+        glm::vec3 color = getColorBasedOnSpeed(traceSpeeds[traceColors.size()]); //Calculates the color of the trace point based on its speed.
+        traceColors.push_back(glm::u8vec4(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f, 255));
     }
 
-    //update binds the Vertex Array Object (VAO) for the trace
-    glBindVertexArray(traceVAO);
+    //the trace only ever grows, so only the points added since the last frame are uploaded;
+    //the renderer's buffers grow geometrically and keep the earlier points on the GPU
+    size_t uploaded = traceRenderer.getPointCount();
+    traceRenderer.appendPoints(tracePositions.data() + uploaded, tracePositions.size() - uploaded);
+    traceRenderer.appendColors(traceColors.data() + uploaded, traceColors.size() - uploaded);
 
-    //update binds the Vertex Buffer Object(VBO)
-    glBindBuffer(GL_ARRAY_BUFFER, traceVBO);
-
-    //uploads the vertex data to the GPU Dynamically
-    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_DYNAMIC_DRAW);
-
-    /*
-    0 =layout location in shader
-    3= 3 components(x,y,z)
-    GL_FLOAT = dataType
-    GL_FALSE = data is not normalized
-    3 * sizeof(float) = the stride between consecutive vertices
-    (void*)0 = the offset, 0 = starting from beginning
-   */
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0); // Position
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float))); // Color
-    glEnableVertexAttribArray(1);
-
-    // Use shader
-    shader.use();
-    shader.setMat4("model", glm::mat4(1.0f));
-    shader.setMat4("view", view);
-    shader.setMat4("projection", projection);
-
-    // continuous line
-    glDrawArrays(GL_LINE_STRIP, 0, static_cast<GLsizei>(tracePositions.size()));
-    glBindVertexArray(0);
+    // continuous thick line, one instanced draw for the whole trace
+    PolylineRenderer::Style style;
+    style.width = TRACE_WIDTH_PIXELS;
+    traceRenderer.draw(shader, view, projection, style);
 }
 
 // Reset hike stats
 void AnimatedCharacter::resetHike() {
     currentPathIndex = 0;
     progress = 0.0f;
-    characterPosition = pathPoints.empty() ? glm::vec3(0.0f) : pathPoints[0];
+    distanceTravelled = 0.0f;
+    playbackTime = 0.0;
+    characterPosition = (!path || path->isEmpty()) ? glm::vec3(0.0f) : path->getPoints()[0];
     previousPosition = characterPosition;
     tracePositions.clear();
     traceSpeeds.clear();
+    traceColors.clear();
+    if (traceRenderer.getPointCount() > 0) {
+        //the next trace is appended from the start of the buffers again
+        traceRenderer.setPoints(nullptr, 0);
+        traceRenderer.clearColors();
+    }
     simulationStarted = false;
     simulationFinished = false;
 }
@@ -334,13 +343,11 @@ void AnimatedCharacter::cleanup() {
     if (characterVAO) glDeleteVertexArrays(1, &characterVAO);
     if (characterVBO) glDeleteBuffers(1, &characterVBO);
 
-    if (traceVAO) glDeleteVertexArrays(1, &traceVAO);
-    if (traceVBO) glDeleteBuffers(1, &traceVBO);
+    traceRenderer.cleanup();
+    path.reset();
 
     characterVAO = 0;
     characterVBO = 0;
-    traceVAO = 0;
-    traceVBO = 0;
 
     std::cout << "INFO: Character resources cleaned up." << std::endl;
 }
@@ -350,13 +357,66 @@ glm::vec3 AnimatedCharacter::getCurrentPosition() const {
 }
 
 glm::vec3 AnimatedCharacter::getForwardDirection() const {
-    if (pathPoints.empty() || currentPathIndex >= pathPoints.size() - 1)
+    if (!path || path->getPointCount() < 2)
         return glm::vec3(0.0f, 0.0f, -1.0f); // Default forward direction
 
-    glm::vec3 start = pathPoints[currentPathIndex];
-    glm::vec3 end = pathPoints[currentPathIndex + 1];
-    glm::vec3 direction = glm::normalize(end - start); //converting the vector into a unit vector, represent direction
-    return glm::vec3(direction.x, 0.0f, direction.z); // Ignore Y component for horizontal rotation
+    // Horizontal unit direction of the segment under the character
+    return path->getArcLength().sample(distanceTravelled).heading;
+}
+
+void AnimatedCharacter::seekToDistance(float distance) {
+    if (!path || path->isEmpty()) return;
+    const ArcLengthTable& arcLength = path->getArcLength();
+
+    distanceTravelled = glm::clamp(distance, 0.0f, arcLength.getTotalLength());
+    playbackTime = path->getTimeTable().getTimeAtDistance(distanceTravelled);
+    ArcLengthTable::Sample sample = arcLength.sample(distanceTravelled);
+    currentPathIndex = sample.segment;
+    progress = sample.t;
+    characterPosition = sample.position;
+
+    // No speed spike and no finish flag carried over from before the jump
+    previousPosition = characterPosition;
+    simulationFinished = distanceTravelled >= arcLength.getTotalLength() && path->getPointCount() > 1;
+}
+
+float AnimatedCharacter::getDistanceTravelled() const {
+    return distanceTravelled;
+}
+
+float AnimatedCharacter::getPathLength() const {
+    return path ? path->getArcLength().getTotalLength() : 0.0f;
+}
+
+float AnimatedCharacter::getMovementSpeed() const {
+    return movementSpeed;
+}
+
+void AnimatedCharacter::setPlaybackRate(float rate) {
+    playbackRate = std::max(rate, 0.0f);
+
+    // Continue from where the character stands
+    if (path) playbackTime = path->getTimeTable().getTimeAtDistance(distanceTravelled);
+}
+
+float AnimatedCharacter::getPlaybackRate() const {
+    return playbackRate;
+}
+
+bool AnimatedCharacter::isTimedPlayback() const {
+    return playbackRate > 0.0f && path && !path->getTimeTable().isEmpty();
+}
+
+double AnimatedCharacter::getPlaybackTime() const {
+    return playbackTime;
+}
+
+size_t AnimatedCharacter::getCurrentSegment() const {
+    return path ? path->getArcLength().findSegment(distanceTravelled) : 0;
+}
+
+PathData::Ptr AnimatedCharacter::getPathData() const {
+    return path;
 }
 
 bool AnimatedCharacter::isSimulationStarted() const {
@@ -7,7 +7,9 @@
 #include <string>
 #include <vector>
 #include "Shader.h"
-#include "Terrain.h"
+#include "HeightSource.h"
+#include "PathData.h"
+#include "PolylineRenderer.h"
 
 class AnimatedCharacter {
 public:
@@ -16,16 +18,36 @@ public:
     ~AnimatedCharacter();
 
     // Initialization
-    void loadPathData(const std::vector<glm::vec3>& path);
+    // Shares the hiker's path instead of copying it; the character keeps it alive while it walks
+    void loadPathData(PathData::Ptr path);
 
     // Update and Render
-    void updatePosition(float deltaTime, const Terrain& terrain);
+    void updatePosition(float deltaTime, const HeightSource& terrain);
+
+    // Speed factor for a rise over run; shared with anything that predicts the character's walking times
+    static float slopeSpeedMultiplier(float slope);
     void render(const glm::mat4& view, const glm::mat4& projection, Shader& shader);
     void renderTrace(const glm::mat4& view, const glm::mat4& projection, Shader& shader);
+    void renderDepth(Shader& depthShader) const;
 
     // Reset
     void resetHike();
 
+    // Jumps to a distance along the path without stepping through the segments in between
+    void seekToDistance(float distance);
+    float getDistanceTravelled() const;
+    float getPathLength() const;
+    float getMovementSpeed() const;    // World units per second on level ground
+
+    // Replays a path recorded with timestamps at its real pace, rate times faster; 0 walks at the
+    // slope-adjusted movement speed instead, as do paths without timestamps
+    void setPlaybackRate(float rate);
+    float getPlaybackRate() const;
+    bool isTimedPlayback() const;
+    double getPlaybackTime() const;    // Recorded seconds since the start of the path
+    size_t getCurrentSegment() const;  // Index of the path point the character last passed
+    PathData::Ptr getPathData() const; // Path being walked, null before loadPathData
+
     // Cleanup
     void cleanup();
 
@@ -39,12 +61,14 @@ public:
 private:
     // Member variables
     unsigned int characterVAO, characterVBO;
-    unsigned int traceVAO, traceVBO;
     glm::vec3 characterPosition;
     glm::vec3 previousPosition;
-    std::vector<glm::vec3> pathPoints;
+    PathData::Ptr path;  // Points and arc-length table, shared with the hiker
     float progress;
     size_t currentPathIndex;
+    float distanceTravelled;
+    float playbackRate;     // Recorded seconds per real second, 0 when not replaying timestamps
+    double playbackTime;
     float movementSpeed;    // Base movement speed
     float characterScale;
     float currentSpeed;
@@ -54,8 +78,11 @@ private:
     // Trace data
     std::vector<glm::vec3> tracePositions;
     std::vector<float> traceSpeeds;
+    std::vector<glm::u8vec4> traceColors;
+    PolylineRenderer traceRenderer;
 
     // Private methods
+    glm::mat4 getModelMatrix() const;
     void setupCharacterBuffers();
     void setupTraceBuffers();
     glm::vec3 getColorBasedOnSpeed(float speed);
@@ -0,0 +1,121 @@
+// ArcLengthTable.cpp
+
+#include "ArcLengthTable.h"
+#include <algorithm>
+#include <utility>
+
+ArcLengthTable::ArcLengthTable() {
+}
+
+void ArcLengthTable::build(const std::vector<glm::vec3>& pathPoints) {
+    points = pathPoints;
+    buildCumulative();
+}
+
+void ArcLengthTable::build(std::vector<glm::vec3>&& pathPoints) {
+    points = std::move(pathPoints);
+    buildCumulative();
+}
+
+void ArcLengthTable::buildCumulative() {
+    cumulative.resize(points.size());
+    if (points.empty()) return;
+
+    cumulative[0] = 0.0f;
+    double total = 0.0; // Accumulate in double so long tracks do not drift
+    for (size_t i = 1; i < points.size(); ++i) {
+        total += glm::distance(points[i - 1], points[i]);
+        cumulative[i] = static_cast<float>(total);
+    }
+}
+
+void ArcLengthTable::clear() {
+    points.clear();
+    cumulative.clear();
+}
+
+bool ArcLengthTable::isEmpty() const {
+    return points.empty();
+}
+
+float ArcLengthTable::getTotalLength() const {
+    return cumulative.empty() ? 0.0f : cumulative.back();
+}
+
+size_t ArcLengthTable::getPointCount() const {
+    return points.size();
+}
+
+const std::vector<glm::vec3>& ArcLengthTable::getPoints() const {
+    return points;
+}
+
+float ArcLengthTable::getDistanceAtPoint(size_t index) const {
+    if (cumulative.empty()) return 0.0f;
+    return cumulative[std::min(index, cumulative.size() - 1)];
+}
+
+size_t ArcLengthTable::findSegment(float distance) const {
+    if (points.size() < 2) return 0;
+
+    // First point strictly beyond the distance ends the segment; zero-length segments are skipped
+    auto it = std::upper_bound(cumulative.begin(), cumulative.end(), distance);
+    size_t end = static_cast<size_t>(it - cumulative.begin());
+    end = std::clamp<size_t>(end, 1, points.size() - 1);
+    return end - 1;
+}
+
+ArcLengthTable::Sample ArcLengthTable::sampleSegment(size_t segment, float distance) const {
+    Sample result;
+    result.segment = segment;
+
+    if (points.size() < 2) {
+        if (!points.empty()) result.position = points[0];
+        return result;
+    }
+
+    const glm::vec3& start = points[segment];
+    const glm::vec3& end = points[segment + 1];
+    float length = cumulative[segment + 1] - cumulative[segment];
+
+    result.t = length > 0.0f ? glm::clamp((distance - cumulative[segment]) / length, 0.0f, 1.0f) : 0.0f;
+    result.position = glm::mix(start, end, result.t);
+
+    glm::vec2 horizontal(end.x - start.x, end.z - start.z);
+    float horizontalLength = glm::length(horizontal);
+    if (horizontalLength > 1e-6f) {
+        result.heading = glm::vec3(horizontal.x / horizontalLength, 0.0f, horizontal.y / horizontalLength);
+    }
+    return result;
+}
+
+ArcLengthTable::Sample ArcLengthTable::sample(float distance) const {
+    return sampleSegment(findSegment(distance), distance);
+}
+
+void ArcLengthTable::sampleMany(const float* distances, size_t count, Sample* out) const {
+    size_t segment = 0;
+    float previous = -1.0f;
+
+    for (size_t i = 0; i < count; ++i) {
+        float distance = distances[i];
+
+        if (distance >= previous && points.size() >= 2) {
+            // Walk forward a few segments before falling back to a search
+            size_t steps = 0;
+            while (segment + 2 < points.size() && cumulative[segment + 1] <= distance && steps < 8) {
+                ++segment;
+                ++steps;
+            }
+            if (segment + 2 < points.size() && cumulative[segment + 1] <= distance) {
+                segment = findSegment(distance);
+            }
+        }
+        else {
+            segment = findSegment(distance);
+        }
+
+        out[i] = sampleSegment(segment, distance);
+        previous = distance;
+    }
+}
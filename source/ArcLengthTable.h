@@ -0,0 +1,52 @@
+// ArcLengthTable.h
+
+#ifndef ARC_LENGTH_TABLE_H
+#define ARC_LENGTH_TABLE_H
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Cumulative distance along a polyline, built once per path. Any distance maps to its segment
+// with a binary search, so seeking to "km 12" costs O(log n) instead of walking the path.
+class ArcLengthTable {
+public:
+    struct Sample {
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 heading = glm::vec3(0.0f, 0.0f, -1.0f); // Horizontal unit direction of the segment
+        size_t segment = 0;                                // Index of the segment's start point
+        float t = 0.0f;                                    // Position within the segment, 0..1
+    };
+
+    ArcLengthTable();
+
+    void build(const std::vector<glm::vec3>& points);
+    void build(std::vector<glm::vec3>&& points);  // Takes the points over instead of copying them
+    void clear();
+
+    bool isEmpty() const;
+    float getTotalLength() const;
+    size_t getPointCount() const;
+    const std::vector<glm::vec3>& getPoints() const;
+
+    // Distance from the start of the path to points[index]
+    float getDistanceAtPoint(size_t index) const;
+
+    // Segment containing the distance, clamped to the path
+    size_t findSegment(float distance) const;
+
+    Sample sample(float distance) const;
+
+    // Samples count distances into out. Ascending input is walked forward from the previous hit
+    // instead of searched from scratch, so dense scrubbing stays linear in count.
+    void sampleMany(const float* distances, size_t count, Sample* out) const;
+
+private:
+    void buildCumulative();
+    Sample sampleSegment(size_t segment, float distance) const;
+
+    std::vector<glm::vec3> points;
+    std::vector<float> cumulative; // cumulative[i] = distance from points[0] to points[i]
+};
+
+#endif // ARC_LENGTH_TABLE_H
@@ -0,0 +1,310 @@
+// CascadedShadowMap.cpp
+
+#include "CascadedShadowMap.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace {
+    constexpr float SPLIT_LAMBDA = 0.75f;          // Blend between logarithmic and uniform split distances
+    constexpr float BOUNDS_MARGIN = 0.25f;         // Extra radius kept around a cached cascade
+    constexpr float LIGHT_ANGLE_THRESHOLD = 0.5f;  // Degrees the sun may move before the caches are redrawn
+    constexpr int REPORT_INTERVAL_FRAMES = 300;
+
+    glm::mat4 lightViewFrom(const glm::vec3& eye, const glm::vec3& lightDirection) {
+        glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        return glm::lookAt(eye, eye - lightDirection, up);
+    }
+}
+
+CascadedShadowMap::CascadedShadowMap()
+    : depthArray(0), drawFBO(0), readFBO(0),
+    queryFrame(0),
+    resolution(2048),
+    cascadeCount(MAX_CASCADES),
+    shadowDistance(1000.0f),
+    casterExtent(1000.0f),
+    framesSinceReport(0) {
+    for (int set = 0; set < 2; ++set) {
+        for (int i = 0; i < MAX_CASCADES; ++i) {
+            timerQueries[set][i] = 0;
+            queryPending[set][i] = false;
+        }
+    }
+}
+
+bool CascadedShadowMap::initialize(int mapResolution, int count) {
+    resolution = mapResolution;
+    cascadeCount = std::clamp(count, 1, MAX_CASCADES);
+
+    depthShader = std::make_unique<Shader>("shaders/shadowDepthVert.glsl", "shaders/shadowDepthFrag.glsl");
+    if (!depthShader || !depthShader->isLoaded()) {
+        std::cerr << "ERROR: Failed to load shadow depth shader." << std::endl;
+        return false;
+    }
+
+    // Layers [0, cascadeCount) are the static caches, [cascadeCount, 2 * cascadeCount) the working layers
+    glGenTextures(1, &depthArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, cascadeCount * 2,
+        0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    const float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+
+    // Hardware depth comparison, with linear filtering this gives 2x2 PCF per fetch
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(1, &drawFBO);
+    glGenFramebuffers(1, &readFBO);
+    for (GLuint framebuffer : { drawFBO, readFBO }) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+
+    attachLayer(drawFBO, GL_FRAMEBUFFER, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "ERROR: Shadow map framebuffer is incomplete." << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return false;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glGenQueries(2 * MAX_CASCADES, &timerQueries[0][0]);
+
+    std::cout << "INFO: Cascaded shadow map initialized with " << cascadeCount << " cascades at "
+        << resolution << "x" << resolution << "." << std::endl;
+    return true;
+}
+
+void CascadedShadowMap::setShadowDistance(float distance) {
+    shadowDistance = distance;
+    invalidateStaticCasters();
+}
+
+void CascadedShadowMap::setCasterExtent(float extent) {
+    casterExtent = extent;
+    invalidateStaticCasters();
+}
+
+void CascadedShadowMap::invalidateStaticCasters() {
+    for (auto& cascade : cascades) {
+        cascade.cacheValid = false;
+    }
+}
+
+void CascadedShadowMap::attachLayer(GLuint framebuffer, GLenum target, int layer) {
+    glBindFramebuffer(target, framebuffer);
+    glFramebufferTextureLayer(target, GL_DEPTH_ATTACHMENT, depthArray, 0, layer);
+}
+
+bool CascadedShadowMap::needsStaticRender(const Cascade& cascade, const glm::vec3& center, float radius,
+    const glm::vec3& lightDirection) const {
+    if (!cascade.cacheValid) return true;
+
+    // The sun moved
+    if (glm::dot(cascade.cachedLightDirection, lightDirection) < std::cos(glm::radians(LIGHT_ANGLE_THRESHOLD))) {
+        return true;
+    }
+
+    // The slice left the cached bounds, or it shrank so much that the cache wastes resolution
+    if (glm::distance(center, cascade.cachedCenter) + radius > cascade.cachedRadius) return true;
+    if (radius * (1.0f + BOUNDS_MARGIN) < cascade.cachedRadius * 0.5f) return true;
+
+    return false;
+}
+
+void CascadedShadowMap::fitCascade(Cascade& cascade, const glm::vec3& center, float radius, const glm::vec3& lightDirection) {
+    float cachedRadius = radius * (1.0f + BOUNDS_MARGIN);
+
+    // Snap the centre to whole texels in light space so re-fitted caches do not shimmer
+    glm::mat4 lightRotation = lightViewFrom(glm::vec3(0.0f), lightDirection);
+    glm::vec3 lightSpaceCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+    float texelSize = 2.0f * cachedRadius / static_cast<float>(resolution);
+    lightSpaceCenter.x = std::floor(lightSpaceCenter.x / texelSize) * texelSize;
+    lightSpaceCenter.y = std::floor(lightSpaceCenter.y / texelSize) * texelSize;
+    glm::vec3 snappedCenter = glm::vec3(glm::inverse(lightRotation) * glm::vec4(lightSpaceCenter, 1.0f));
+
+    // Pull the eye back far enough to catch occluders between the slice and the sun
+    glm::vec3 eye = snappedCenter + lightDirection * (cachedRadius + casterExtent);
+    glm::mat4 lightView = lightViewFrom(eye, lightDirection);
+    glm::mat4 lightProjection = glm::ortho(-cachedRadius, cachedRadius, -cachedRadius, cachedRadius,
+        0.0f, 2.0f * cachedRadius + casterExtent);
+
+    cascade.lightSpaceMatrix = lightProjection * lightView;
+    cascade.cachedCenter = snappedCenter;
+    cascade.cachedRadius = cachedRadius;
+    cascade.cachedLightDirection = lightDirection;
+    cascade.cacheValid = true;
+}
+
+void CascadedShadowMap::render(const glm::mat4& view, float fovY, float aspect, float nearPlane,
+    const glm::vec3& lightDirection, const CasterCallback& drawStatic, const CasterCallback& drawDynamic) {
+    if (!depthShader || depthArray == 0) return;
+
+    collectTimings();
+
+    GLint previousViewport[4];
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    GLboolean cullingEnabled = glIsEnabled(GL_CULL_FACE);
+
+    // Heightfields are open surfaces, so draw both faces and bias the depth instead
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    glViewport(0, 0, resolution, resolution);
+
+    depthShader->use();
+    depthShader->setMat4("model", glm::mat4(1.0f));
+
+    glm::mat4 inverseView = glm::inverse(view);
+    float splitNear = std::max(nearPlane, 1.0f);
+    float sliceNear = nearPlane;
+
+    GLuint (&queries)[MAX_CASCADES] = timerQueries[queryFrame];
+
+    for (int i = 0; i < cascadeCount; ++i) {
+        Cascade& cascade = cascades[i];
+
+        // Practical split scheme: mostly logarithmic, with some uniform spacing mixed in
+        float t = static_cast<float>(i + 1) / cascadeCount;
+        float logSplit = splitNear * std::pow(shadowDistance / splitNear, t);
+        float uniformSplit = splitNear + (shadowDistance - splitNear) * t;
+        float sliceFar = SPLIT_LAMBDA * logSplit + (1.0f - SPLIT_LAMBDA) * uniformSplit;
+        cascade.splitFar = sliceFar;
+
+        // Bounding sphere of the slice; its radius only depends on the projection, so it is stable
+        glm::mat4 inverseSlice = inverseView * glm::inverse(glm::perspective(fovY, aspect, sliceNear, sliceFar));
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int c = 0; c < 8; ++c) {
+            glm::vec4 corner = inverseSlice * glm::vec4((c & 1) ? 1.0f : -1.0f, (c & 2) ? 1.0f : -1.0f, (c & 4) ? 1.0f : -1.0f, 1.0f);
+            corners[c] = glm::vec3(corner) / corner.w;
+            center += corners[c];
+        }
+        center /= 8.0f;
+
+        float radius = 0.0f;
+        for (const auto& corner : corners) {
+            radius = std::max(radius, glm::distance(corner, center));
+        }
+        radius = std::ceil(radius);
+        sliceNear = sliceFar;
+
+        glBeginQuery(GL_TIME_ELAPSED, queries[i]);
+
+        if (needsStaticRender(cascade, center, radius, lightDirection)) {
+            fitCascade(cascade, center, radius, lightDirection);
+
+            attachLayer(drawFBO, GL_FRAMEBUFFER, i);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            depthShader->setMat4("lightSpaceMatrix", cascade.lightSpaceMatrix);
+            drawStatic(*depthShader);
+            ++cascade.staticRenders;
+        }
+
+        // Start the working layer from the cached terrain depth
+        attachLayer(readFBO, GL_READ_FRAMEBUFFER, i);
+        attachLayer(drawFBO, GL_DRAW_FRAMEBUFFER, cascadeCount + i);
+        glBlitFramebuffer(0, 0, resolution, resolution, 0, 0, resolution, resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, drawFBO);
+        depthShader->use();
+        depthShader->setMat4("lightSpaceMatrix", cascade.lightSpaceMatrix);
+        depthShader->setMat4("model", glm::mat4(1.0f));
+        drawDynamic(*depthShader);
+
+        glEndQuery(GL_TIME_ELAPSED);
+        queryPending[queryFrame][i] = true;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    if (cullingEnabled) glEnable(GL_CULL_FACE);
+
+    queryFrame = 1 - queryFrame;
+
+    if (++framesSinceReport >= REPORT_INTERVAL_FRAMES) {
+        reportTimings();
+        framesSinceReport = 0;
+    }
+}
+
+void CascadedShadowMap::collectTimings() {
+    // This frame reuses the set issued two frames ago; read whatever finished, drop the rest
+    for (int i = 0; i < cascadeCount; ++i) {
+        if (!queryPending[queryFrame][i]) continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(timerQueries[queryFrame][i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(timerQueries[queryFrame][i], GL_QUERY_RESULT, &nanoseconds);
+            cascades[i].gpuMilliseconds += static_cast<double>(nanoseconds) / 1.0e6;
+            ++cascades[i].timedFrames;
+        }
+        queryPending[queryFrame][i] = false;
+    }
+}
+
+void CascadedShadowMap::reportTimings() {
+    for (int i = 0; i < cascadeCount; ++i) {
+        Cascade& cascade = cascades[i];
+        double average = cascade.timedFrames > 0 ? cascade.gpuMilliseconds / cascade.timedFrames : 0.0;
+
+        std::cout << "INFO: Shadow cascade " << i << " (to " << cascade.splitFar << " units): "
+            << average << " ms GPU per frame, " << cascade.staticRenders
+            << " static re-renders in the last " << REPORT_INTERVAL_FRAMES << " frames." << std::endl;
+
+        cascade.gpuMilliseconds = 0.0;
+        cascade.timedFrames = 0;
+        cascade.staticRenders = 0;
+    }
+}
+
+void CascadedShadowMap::apply(Shader& shader, int textureUnit) const {
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.setInt("shadowMap", textureUnit);
+    shader.setInt("useShadows", depthArray != 0 ? 1 : 0);
+    shader.setInt("cascadeCount", cascadeCount);
+    shader.setInt("shadowLayerOffset", cascadeCount);
+    shader.setFloat("shadowTexelSize", 1.0f / static_cast<float>(resolution));
+
+    for (int i = 0; i < cascadeCount; ++i) {
+        std::string index = "[" + std::to_string(i) + "]";
+        shader.setMat4("lightSpaceMatrices" + index, cascades[i].lightSpaceMatrix);
+        shader.setFloat("cascadeSplits" + index, cascades[i].splitFar);
+    }
+}
+
+void CascadedShadowMap::cleanup() {
+    if (timerQueries[0][0]) glDeleteQueries(2 * MAX_CASCADES, &timerQueries[0][0]);
+    if (drawFBO) glDeleteFramebuffers(1, &drawFBO);
+    if (readFBO) glDeleteFramebuffers(1, &readFBO);
+    if (depthArray) glDeleteTextures(1, &depthArray);
+
+    for (int set = 0; set < 2; ++set) {
+        for (int i = 0; i < MAX_CASCADES; ++i) {
+            timerQueries[set][i] = 0;
+            queryPending[set][i] = false;
+        }
+    }
+    drawFBO = 0;
+    readFBO = 0;
+    depthArray = 0;
+    invalidateStaticCasters();
+    depthShader.reset();
+}
@@ -0,0 +1,87 @@
+// CascadedShadowMap.h
+
+#ifndef CASCADED_SHADOW_MAP_H
+#define CASCADED_SHADOW_MAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <functional>
+#include <memory>
+#include "Shader.h"
+
+// Cascaded shadow maps for a directional sun. The depth array holds two layers per cascade:
+// a cache with only the static casters (terrain), rendered again only when the light or the
+// cascade bounds moved too far, and a working layer that is refreshed every frame by copying
+// the cache and drawing the dynamic casters on top. Lit shaders sample the working layers.
+class CascadedShadowMap {
+public:
+    static constexpr int MAX_CASCADES = 4;
+
+    // Draws casters with the depth shader; lightSpaceMatrix is already set, model is up to the caller
+    using CasterCallback = std::function<void(Shader& depthShader)>;
+
+    CascadedShadowMap();
+
+    bool initialize(int resolution, int cascadeCount);
+
+    // View distance covered by the last cascade
+    void setShadowDistance(float distance);
+
+    // How far towards the light occluders can sit outside a cascade, e.g. the terrain extent
+    void setCasterExtent(float extent);
+
+    // Forces the static caches to be re-rendered, e.g. after the terrain changed
+    void invalidateStaticCasters();
+
+    // Fits the cascades to the camera frustum, refreshes stale static caches and composites dynamic casters.
+    // Leaves the default framebuffer and the previous viewport bound.
+    void render(const glm::mat4& view, float fovY, float aspect, float nearPlane,
+        const glm::vec3& lightDirection, const CasterCallback& drawStatic, const CasterCallback& drawDynamic);
+
+    // Binds the working layers to textureUnit and sets the shadow uniforms; the shader must be in use
+    void apply(Shader& shader, int textureUnit) const;
+
+    void cleanup();
+
+private:
+    struct Cascade {
+        glm::mat4 lightSpaceMatrix = glm::mat4(1.0f);
+        glm::vec3 cachedCenter = glm::vec3(0.0f);
+        glm::vec3 cachedLightDirection = glm::vec3(0.0f, 1.0f, 0.0f);
+        float cachedRadius = 0.0f;
+        bool cacheValid = false;
+        float splitFar = 0.0f;   // View-space depth where this cascade ends
+
+        // Timing, accumulated until the next report
+        double gpuMilliseconds = 0.0;
+        int timedFrames = 0;
+        int staticRenders = 0;
+    };
+
+    bool needsStaticRender(const Cascade& cascade, const glm::vec3& center, float radius,
+        const glm::vec3& lightDirection) const;
+    void fitCascade(Cascade& cascade, const glm::vec3& center, float radius, const glm::vec3& lightDirection);
+    void attachLayer(GLuint framebuffer, GLenum target, int layer);
+    void collectTimings();
+    void reportTimings();
+
+    std::unique_ptr<Shader> depthShader;
+    Cascade cascades[MAX_CASCADES];
+
+    GLuint depthArray;
+    GLuint drawFBO;
+    GLuint readFBO;
+
+    // Two query sets so results are read a frame after they were issued, without stalling
+    GLuint timerQueries[2][MAX_CASCADES];
+    bool queryPending[2][MAX_CASCADES];
+    int queryFrame;
+
+    int resolution;
+    int cascadeCount;
+    float shadowDistance;
+    float casterExtent;
+    int framesSinceReport;
+};
+
+#endif // CASCADED_SHADOW_MAP_H
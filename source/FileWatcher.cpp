@@ -0,0 +1,145 @@
+// FileWatcher.cpp
+
+#include "FileWatcher.h"
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+FileWatcher::FileWatcher()
+    : opened(false), notifications(false), lastSize(0), changeHandle(INVALID_HANDLE_VALUE) {
+}
+#elif defined(__linux__)
+FileWatcher::FileWatcher()
+    : opened(false), notifications(false), lastSize(0), inotifyDescriptor(-1), watchDescriptor(-1) {
+}
+#else
+FileWatcher::FileWatcher()
+    : opened(false), notifications(false), lastSize(0) {
+}
+#endif
+
+FileWatcher::~FileWatcher() {
+    close();
+}
+
+bool FileWatcher::open(const std::string& path) {
+    close();
+
+    std::error_code error;
+    if (!fs::is_regular_file(path, error)) {
+        std::cerr << "ERROR: Cannot watch missing file: " << path << std::endl;
+        return false;
+    }
+    watchedPath = path;
+    lastSize = fs::file_size(path, error);
+    opened = true;
+
+#ifdef _WIN32
+    // Directory notifications cover every file in it; poll() only says that something changed
+    fs::path directory = fs::absolute(path, error).parent_path();
+    HANDLE handle = FindFirstChangeNotificationA(directory.string().c_str(), FALSE,
+        FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+    if (handle != INVALID_HANDLE_VALUE) {
+        changeHandle = handle;
+        notifications = true;
+    }
+#elif defined(__linux__)
+    inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyDescriptor >= 0) {
+        watchDescriptor = inotify_add_watch(inotifyDescriptor, path.c_str(),
+            IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+        notifications = watchDescriptor >= 0;
+    }
+#endif
+
+    if (!notifications) {
+        std::cout << "INFO: No change notifications for " << path << ", polling its size instead." << std::endl;
+    }
+    return true;
+}
+
+void FileWatcher::close() {
+#ifdef _WIN32
+    if (changeHandle != INVALID_HANDLE_VALUE) FindCloseChangeNotification(static_cast<HANDLE>(changeHandle));
+    changeHandle = INVALID_HANDLE_VALUE;
+#elif defined(__linux__)
+    if (inotifyDescriptor >= 0) ::close(inotifyDescriptor);
+    inotifyDescriptor = -1;
+    watchDescriptor = -1;
+#endif
+    watchedPath.clear();
+    opened = false;
+    notifications = false;
+    lastSize = 0;
+}
+
+bool FileWatcher::isOpen() const {
+    return opened;
+}
+
+bool FileWatcher::usesNotifications() const {
+    return notifications;
+}
+
+bool FileWatcher::pollSize() {
+    std::error_code error;
+    uintmax_t size = fs::file_size(watchedPath, error);
+    if (error || size == lastSize) return false;
+    lastSize = size;
+    return true;
+}
+
+bool FileWatcher::poll() {
+    if (!opened) return false;
+    if (!notifications) return pollSize();
+
+#ifdef _WIN32
+    if (WaitForSingleObject(static_cast<HANDLE>(changeHandle), 0) != WAIT_OBJECT_0) return false;
+    FindNextChangeNotification(static_cast<HANDLE>(changeHandle));
+    return true;
+#elif defined(__linux__)
+    // Drain every queued event; any of them means the file has to be looked at
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+    bool replaced = false;
+    ssize_t length;
+    while ((length = read(inotifyDescriptor, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t offset = 0; offset < length; ) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) replaced = true;
+            changed = true;
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    // A logger that rotates or rewrites the file leaves the watch on the old inode
+    if (replaced) {
+        inotify_rm_watch(inotifyDescriptor, watchDescriptor);
+        watchDescriptor = inotify_add_watch(inotifyDescriptor, watchedPath.c_str(),
+            IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+        if (watchDescriptor < 0) {
+            std::cout << "INFO: Lost the watch on " << watchedPath << ", polling its size instead." << std::endl;
+            notifications = false;
+        }
+    }
+    return changed;
+#else
+    return pollSize();
+#endif
+}
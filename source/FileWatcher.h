@@ -0,0 +1,46 @@
+// FileWatcher.h
+
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <cstdint>
+#include <string>
+
+// Change notifications for one file that another process keeps appending to, e.g. a GPS logger.
+// Linux uses inotify on the file and Windows a change notification on its directory; elsewhere,
+// or when neither can be set up, every poll compares the file size instead. Polling never blocks,
+// so it can run once per frame.
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const;
+    bool usesNotifications() const;
+
+    // True when the file may have changed since the last poll; reading it is up to the caller
+    bool poll();
+
+private:
+    bool pollSize();
+
+    std::string watchedPath;
+    bool opened;
+    bool notifications;
+    uintmax_t lastSize;      // Size seen by the last pollSize, the fallback
+
+#ifdef _WIN32
+    void* changeHandle;
+#elif defined(__linux__)
+    int inotifyDescriptor;
+    int watchDescriptor;
+#endif
+};
+
+#endif // FILE_WATCHER_H
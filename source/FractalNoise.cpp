@@ -0,0 +1,235 @@
+// FractalNoise.cpp
+
+#include "FractalNoise.h"
+#include <cmath>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define NOISE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define NOISE_AVX2_TARGET
+#else
+// No FMA on purpose: contracted multiply-adds would make the vector results differ from the scalar ones
+#define NOISE_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+    // Eight evenly spaced unit gradients, selected by the low three bits of the corner hash
+    const float GRADIENT_X[8] = { 1.0f, 0.70710678f, 0.0f, -0.70710678f, -1.0f, -0.70710678f, 0.0f, 0.70710678f };
+    const float GRADIENT_Z[8] = { 0.0f, 0.70710678f, 1.0f, 0.70710678f, 0.0f, -0.70710678f, -1.0f, -0.70710678f };
+
+    constexpr uint32_t PRIME_X = 0x27d4eb2du;
+    constexpr uint32_t PRIME_Z = 0x165667b1u;
+    constexpr uint32_t MIX = 0x5bd1e995u;
+    constexpr float NOISE_SCALE = 1.41421356f; // Stretches the gradient noise to roughly [-1, 1]
+
+    inline uint32_t hashCorner(int32_t x, int32_t z, uint32_t seed) {
+        uint32_t h = static_cast<uint32_t>(x) * PRIME_X + static_cast<uint32_t>(z) * PRIME_Z + seed;
+        h = (h ^ (h >> 13)) * MIX;
+        return h ^ (h >> 15);
+    }
+
+    inline float cornerValue(int32_t x, int32_t z, uint32_t seed, float offsetX, float offsetZ) {
+        uint32_t g = hashCorner(x, z, seed) & 7u;
+        return GRADIENT_X[g] * offsetX + GRADIENT_Z[g] * offsetZ;
+    }
+
+    inline float fade(float t) {
+        return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+    }
+
+    float gradientNoise(float x, float z, uint32_t seed) {
+        float floorX = std::floor(x);
+        float floorZ = std::floor(z);
+        int32_t ix = static_cast<int32_t>(floorX);
+        int32_t iz = static_cast<int32_t>(floorZ);
+        float dx = x - floorX;
+        float dz = z - floorZ;
+
+        float n00 = cornerValue(ix, iz, seed, dx, dz);
+        float n10 = cornerValue(ix + 1, iz, seed, dx - 1.0f, dz);
+        float n01 = cornerValue(ix, iz + 1, seed, dx, dz - 1.0f);
+        float n11 = cornerValue(ix + 1, iz + 1, seed, dx - 1.0f, dz - 1.0f);
+
+        float u = fade(dx);
+        float v = fade(dz);
+        float a = n00 + u * (n10 - n00);
+        float b = n01 + u * (n11 - n01);
+        return (a + v * (b - a)) * NOISE_SCALE;
+    }
+
+#ifdef NOISE_X86
+    NOISE_AVX2_TARGET inline __m256i hashCorner8(__m256i x, __m256i z, __m256i seed) {
+        __m256i h = _mm256_add_epi32(
+            _mm256_add_epi32(_mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(PRIME_X))),
+                _mm256_mullo_epi32(z, _mm256_set1_epi32(static_cast<int>(PRIME_Z)))),
+            seed);
+        h = _mm256_mullo_epi32(_mm256_xor_si256(h, _mm256_srli_epi32(h, 13)), _mm256_set1_epi32(static_cast<int>(MIX)));
+        return _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+    }
+
+    NOISE_AVX2_TARGET inline __m256 cornerValue8(__m256i x, __m256i z, __m256i seed, __m256 offsetX, __m256 offsetZ) {
+        const __m256 gradientX = _mm256_loadu_ps(GRADIENT_X);
+        const __m256 gradientZ = _mm256_loadu_ps(GRADIENT_Z);
+
+        __m256i g = _mm256_and_si256(hashCorner8(x, z, seed), _mm256_set1_epi32(7));
+        __m256 gx = _mm256_permutevar8x32_ps(gradientX, g);
+        __m256 gz = _mm256_permutevar8x32_ps(gradientZ, g);
+        return _mm256_add_ps(_mm256_mul_ps(gx, offsetX), _mm256_mul_ps(gz, offsetZ));
+    }
+
+    NOISE_AVX2_TARGET inline __m256 fade8(__m256 t) {
+        __m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))),
+            _mm256_set1_ps(10.0f));
+        return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+    }
+
+    NOISE_AVX2_TARGET __m256 gradientNoise8(__m256 x, __m256 z, uint32_t seedValue) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256i oneI = _mm256_set1_epi32(1);
+        __m256i seed = _mm256_set1_epi32(static_cast<int>(seedValue));
+
+        __m256 floorX = _mm256_floor_ps(x);
+        __m256 floorZ = _mm256_floor_ps(z);
+        __m256i ix = _mm256_cvttps_epi32(floorX);
+        __m256i iz = _mm256_cvttps_epi32(floorZ);
+        __m256 dx = _mm256_sub_ps(x, floorX);
+        __m256 dz = _mm256_sub_ps(z, floorZ);
+        __m256 dx1 = _mm256_sub_ps(dx, one);
+        __m256 dz1 = _mm256_sub_ps(dz, one);
+        __m256i ix1 = _mm256_add_epi32(ix, oneI);
+        __m256i iz1 = _mm256_add_epi32(iz, oneI);
+
+        __m256 n00 = cornerValue8(ix, iz, seed, dx, dz);
+        __m256 n10 = cornerValue8(ix1, iz, seed, dx1, dz);
+        __m256 n01 = cornerValue8(ix, iz1, seed, dx, dz1);
+        __m256 n11 = cornerValue8(ix1, iz1, seed, dx1, dz1);
+
+        __m256 u = fade8(dx);
+        __m256 v = fade8(dz);
+        __m256 a = _mm256_add_ps(n00, _mm256_mul_ps(u, _mm256_sub_ps(n10, n00)));
+        __m256 b = _mm256_add_ps(n01, _mm256_mul_ps(u, _mm256_sub_ps(n11, n01)));
+        return _mm256_mul_ps(_mm256_add_ps(a, _mm256_mul_ps(v, _mm256_sub_ps(b, a))), _mm256_set1_ps(NOISE_SCALE));
+    }
+#endif
+}
+
+FractalNoise::FractalNoise()
+    : FractalNoise(Parameters()) {
+}
+
+FractalNoise::FractalNoise(const Parameters& params)
+    : parameters(params), normalization(1.0f), useAvx2(cpuSupportsAvx2()) {
+    // Divide by the sum of the octave amplitudes so the result stays within [-1, 1]
+    float amplitude = 1.0f;
+    float total = 0.0f;
+    for (int octave = 0; octave < parameters.octaves; ++octave) {
+        total += amplitude;
+        amplitude *= parameters.gain;
+    }
+    normalization = total > 0.0f ? 1.0f / total : 1.0f;
+}
+
+const FractalNoise::Parameters& FractalNoise::getParameters() const {
+    return parameters;
+}
+
+bool FractalNoise::cpuSupportsAvx2() {
+#if defined(NOISE_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // AVX2 also needs the OS to save the YMM registers
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(NOISE_X86)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+void FractalNoise::setUseAvx2(bool enable) {
+    useAvx2 = enable && cpuSupportsAvx2();
+}
+
+bool FractalNoise::isUsingAvx2() const {
+    return useAvx2;
+}
+
+float FractalNoise::sample(float x, float z) const {
+    float value = 0.0f;
+    float amplitude = 1.0f;
+    float frequency = parameters.frequency;
+
+    for (int octave = 0; octave < parameters.octaves; ++octave) {
+        value += amplitude * gradientNoise(x * frequency, z * frequency, parameters.seed + static_cast<uint32_t>(octave));
+        frequency *= parameters.lacunarity;
+        amplitude *= parameters.gain;
+    }
+    return value * normalization;
+}
+
+void FractalNoise::sampleRow(float x, float z, float step, int count, float* out) const {
+#ifdef NOISE_X86
+    if (useAvx2) {
+        sampleRowAvx2(x, z, step, count, out);
+        return;
+    }
+#endif
+    sampleRowScalar(x, z, step, count, out);
+}
+
+void FractalNoise::sampleRowScalar(float x, float z, float step, int count, float* out) const {
+    for (int i = 0; i < count; ++i) {
+        out[i] = sample(x + static_cast<float>(i) * step, z);
+    }
+}
+
+#ifdef NOISE_X86
+NOISE_AVX2_TARGET void FractalNoise::sampleRowAvx2(float x, float z, float step, int count, float* out) const {
+    const __m256 laneOffsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 baseX = _mm256_set1_ps(x);
+    const __m256 stepX = _mm256_set1_ps(step);
+    const __m256 rowZ = _mm256_set1_ps(z);
+    const __m256 scale = _mm256_set1_ps(normalization);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 index = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), laneOffsets);
+        __m256 sampleX = _mm256_add_ps(baseX, _mm256_mul_ps(index, stepX));
+
+        __m256 value = _mm256_setzero_ps();
+        float amplitude = 1.0f;
+        float frequency = parameters.frequency;
+
+        for (int octave = 0; octave < parameters.octaves; ++octave) {
+            __m256 f = _mm256_set1_ps(frequency);
+            __m256 noise = gradientNoise8(_mm256_mul_ps(sampleX, f), _mm256_mul_ps(rowZ, f),
+                parameters.seed + static_cast<uint32_t>(octave));
+            value = _mm256_add_ps(value, _mm256_mul_ps(_mm256_set1_ps(amplitude), noise));
+            frequency *= parameters.lacunarity;
+            amplitude *= parameters.gain;
+        }
+
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(value, scale));
+    }
+
+    // Remainder of the row
+    for (; i < count; ++i) {
+        out[i] = sample(x + static_cast<float>(i) * step, z);
+    }
+}
+#else
+void FractalNoise::sampleRowAvx2(float x, float z, float step, int count, float* out) const {
+    sampleRowScalar(x, z, step, count, out);
+}
+#endif
@@ -0,0 +1,43 @@
+// FractalNoise.h
+
+#ifndef FRACTAL_NOISE_H
+#define FRACTAL_NOISE_H
+
+// Fractal Brownian motion over 2D gradient noise. Rows of samples are evaluated eight at a time with
+// AVX2 when the CPU supports it; the scalar path uses the same hash and produces the same values.
+class FractalNoise {
+public:
+    struct Parameters {
+        unsigned int seed = 1337;
+        int octaves = 6;
+        float frequency = 1.0f / 256.0f;  // Frequency of the first octave in cycles per world unit
+        float lacunarity = 2.0f;          // Frequency multiplier between octaves
+        float gain = 0.5f;                // Amplitude multiplier between octaves
+    };
+
+    FractalNoise();
+    explicit FractalNoise(const Parameters& params);
+
+    // Single sample, roughly in [-1, 1]
+    float sample(float x, float z) const;
+
+    // count samples at (x + i * step, z), written to out
+    void sampleRow(float x, float z, float step, int count, float* out) const;
+
+    const Parameters& getParameters() const;
+
+    // The vector path is used only when the CPU reports AVX2; it can be disabled for comparison
+    static bool cpuSupportsAvx2();
+    void setUseAvx2(bool enable);
+    bool isUsingAvx2() const;
+
+private:
+    void sampleRowScalar(float x, float z, float step, int count, float* out) const;
+    void sampleRowAvx2(float x, float z, float step, int count, float* out) const;
+
+    Parameters parameters;
+    float normalization;
+    bool useAvx2;
+};
+
+#endif // FRACTAL_NOISE_H
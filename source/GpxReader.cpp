@@ -0,0 +1,361 @@
+// GpxReader.cpp
+
+#include "GpxReader.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string_view>
+
+namespace {
+    constexpr size_t MAX_CAPTURE = 64;             // ele and time values are short, anything longer is cut
+    constexpr double EARTH_RADIUS = 6371000.0;     // Metres, mean radius
+    constexpr double DEGREES_TO_RADIANS = 3.14159265358979323846 / 180.0;
+
+    inline bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    inline bool parseDouble(std::string_view text, double& value) {
+        while (!text.empty() && isSpace(text.front())) text.remove_prefix(1);
+        if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc();
+    }
+
+    inline int parseDigits(const char* text, int count) {
+        int value = 0;
+        for (int i = 0; i < count; ++i) {
+            if (text[i] < '0' || text[i] > '9') return -1;
+            value = value * 10 + (text[i] - '0');
+        }
+        return value;
+    }
+
+    // Days since 1970-01-01 in the proleptic Gregorian calendar
+    long long daysFromCivil(int year, int month, int day) {
+        year -= month <= 2 ? 1 : 0;
+        const long long era = (year >= 0 ? year : year - 399) / 400;
+        const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+        const unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + static_cast<long long>(dayOfEra) - 719468;
+    }
+
+    // ISO 8601 as written by GPS loggers: YYYY-MM-DDThh:mm:ss[.fff][Z|+hh:mm|-hh:mm]
+    bool parseIsoTime(std::string_view text, double& seconds) {
+        while (!text.empty() && isSpace(text.front())) text.remove_prefix(1);
+        while (!text.empty() && isSpace(text.back())) text.remove_suffix(1);
+        if (text.size() < 19 || text[4] != '-' || text[7] != '-' || (text[10] != 'T' && text[10] != ' ')) return false;
+
+        const char* p = text.data();
+        int year = parseDigits(p, 4);
+        int month = parseDigits(p + 5, 2);
+        int day = parseDigits(p + 8, 2);
+        int hour = parseDigits(p + 11, 2);
+        int minute = parseDigits(p + 14, 2);
+        int second = parseDigits(p + 17, 2);
+        if (year < 0 || month < 1 || month > 12 || day < 1 || hour < 0 || minute < 0 || second < 0) return false;
+
+        double fraction = 0.0;
+        size_t cursor = 19;
+        if (cursor < text.size() && text[cursor] == '.') {
+            double scale = 0.1;
+            for (++cursor; cursor < text.size() && text[cursor] >= '0' && text[cursor] <= '9'; ++cursor) {
+                fraction += (text[cursor] - '0') * scale;
+                scale *= 0.1;
+            }
+        }
+
+        int offsetSeconds = 0;
+        if (text.size() >= cursor + 3 && (text[cursor] == '+' || text[cursor] == '-')) {
+            int offsetHours = parseDigits(p + cursor + 1, 2);
+            size_t minutesAt = cursor + 3;
+            if (minutesAt < text.size() && text[minutesAt] == ':') ++minutesAt;
+            int offsetMinutes = text.size() >= minutesAt + 2 ? parseDigits(p + minutesAt, 2) : 0;
+            if (offsetHours < 0 || offsetMinutes < 0) return false;
+            offsetSeconds = (offsetHours * 3600 + offsetMinutes * 60) * (text[cursor] == '-' ? -1 : 1);
+        }
+
+        long long days = daysFromCivil(year, month, day);
+        seconds = static_cast<double>(days * 86400 + hour * 3600 + minute * 60 + second - offsetSeconds) + fraction;
+        return true;
+    }
+
+    // Finds name="value" or name='value' inside a start tag
+    bool findAttribute(std::string_view tag, std::string_view name, std::string_view& value) {
+        size_t cursor = 0;
+        while ((cursor = tag.find(name, cursor)) != std::string_view::npos) {
+            bool boundary = cursor > 0 && isSpace(tag[cursor - 1]);
+            size_t equals = cursor + name.size();
+            while (equals < tag.size() && isSpace(tag[equals])) ++equals;
+
+            if (boundary && equals < tag.size() && tag[equals] == '=') {
+                size_t quote = equals + 1;
+                while (quote < tag.size() && isSpace(tag[quote])) ++quote;
+                if (quote < tag.size() && (tag[quote] == '"' || tag[quote] == '\'')) {
+                    size_t close = tag.find(tag[quote], quote + 1);
+                    if (close == std::string_view::npos) return false;
+                    value = tag.substr(quote + 1, close - quote - 1);
+                    return true;
+                }
+            }
+            cursor += name.size();
+        }
+        return false;
+    }
+}
+
+GpxReader::GpxReader(size_t bufferSize)
+    : bufferSize(std::max<size_t>(bufferSize, 4096)),
+    inPoint(false), segmentOpen(false),
+    trackIndex(-1), segmentIndex(-1),
+    capture(Capture::NONE) {
+}
+
+bool GpxReader::isGpxFile(const std::string& path) {
+    if (path.size() < 4) return false;
+    std::string extension = path.substr(path.size() - 4);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".gpx";
+}
+
+void GpxReader::finishCapture() {
+    if (capture == Capture::ELEVATION) {
+        double elevation = 0.0;
+        if (parseDouble(captureText, elevation)) {
+            currentPoint.elevation = static_cast<float>(elevation);
+            currentPoint.hasElevation = true;
+        }
+    }
+    else if (capture == Capture::TIME) {
+        currentPoint.hasTime = parseIsoTime(captureText, currentPoint.time);
+    }
+    capture = Capture::NONE;
+    captureText.clear();
+}
+
+void GpxReader::emitPoint(const Callbacks& callbacks, Stats& stats) {
+    inPoint = false;
+    if (callbacks.onPoint) callbacks.onPoint(currentPoint);
+    ++stats.points;
+}
+
+void GpxReader::handleTag(const char* begin, const char* end, const Callbacks& callbacks, Stats& stats) {
+    // Declarations and processing instructions carry nothing we need
+    if (begin == end || *begin == '?' || *begin == '!') return;
+
+    if (capture != Capture::NONE) finishCapture();
+
+    bool closing = *begin == '/';
+    if (closing) ++begin;
+    bool selfClosing = end > begin && end[-1] == '/';
+
+    const char* nameEnd = begin;
+    while (nameEnd < end && !isSpace(*nameEnd) && *nameEnd != '/') ++nameEnd;
+    std::string_view name(begin, nameEnd - begin);
+
+    // Ignore namespace prefixes such as gpx:trkpt
+    size_t colon = name.find(':');
+    if (colon != std::string_view::npos) name.remove_prefix(colon + 1);
+
+    auto beginSegment = [&]() {
+        if (trackIndex < 0) {
+            trackIndex = 0;
+            ++stats.tracks;
+        }
+        ++segmentIndex;
+        ++stats.segments;
+        segmentOpen = true;
+        if (callbacks.onSegmentBegin) callbacks.onSegmentBegin(trackIndex, segmentIndex);
+    };
+
+    if (name == "trkpt" || name == "rtept") {
+        if (closing) {
+            if (inPoint) emitPoint(callbacks, stats);
+            return;
+        }
+
+        if (!segmentOpen) beginSegment();
+
+        std::string_view tag(nameEnd, end - nameEnd);
+        std::string_view latitude, longitude;
+        currentPoint = TrackPoint();
+        inPoint = findAttribute(tag, "lat", latitude) && findAttribute(tag, "lon", longitude)
+            && parseDouble(latitude, currentPoint.latitude) && parseDouble(longitude, currentPoint.longitude);
+
+        if (inPoint && selfClosing) emitPoint(callbacks, stats);
+    }
+    else if (name == "ele" || name == "time") {
+        if (inPoint && !closing && !selfClosing) {
+            capture = name == "ele" ? Capture::ELEVATION : Capture::TIME;
+            captureText.clear();
+        }
+    }
+    else if (name == "trkseg") {
+        if (closing) segmentOpen = false;
+        else if (!selfClosing) beginSegment();
+    }
+    else if (name == "trk" || name == "rte") {
+        // Routes have no segments, their points open one implicitly
+        segmentOpen = false;
+        if (!closing) {
+            if (trackIndex < 0) trackIndex = 0;
+            else ++trackIndex;
+            segmentIndex = -1;
+            ++stats.tracks;
+        }
+    }
+}
+
+GpxReader::Stats GpxReader::read(const std::string& path, const Callbacks& callbacks) {
+    Stats stats;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        std::cerr << "ERROR: Failed to open GPX file: " << path << std::endl;
+        return stats;
+    }
+
+    inPoint = false;
+    segmentOpen = false;
+    trackIndex = -1;
+    segmentIndex = -1;
+    capture = Capture::NONE;
+    captureText.clear();
+    captureText.reserve(MAX_CAPTURE);
+
+    std::vector<char> buffer(bufferSize);
+    size_t filled = 0;
+    bool endOfFile = false;
+    bool inComment = false;
+    bool failed = false;
+
+    while (!failed) {
+        if (!endOfFile) {
+            size_t readBytes = std::fread(buffer.data() + filled, 1, bufferSize - filled, file);
+            filled += readBytes;
+            stats.bytes += readBytes;
+            endOfFile = readBytes == 0;
+        }
+
+        const char* cursor = buffer.data();
+        const char* end = buffer.data() + filled;
+
+        while (cursor < end) {
+            if (inComment) {
+                std::string_view rest(cursor, end - cursor);
+                size_t close = rest.find("-->");
+                if (close == std::string_view::npos) {
+                    // Keep two bytes in case the terminator straddles the refill
+                    cursor = std::max(cursor, end - 2);
+                    break;
+                }
+                cursor += close + 3;
+                inComment = false;
+                continue;
+            }
+
+            const char* tagStart = static_cast<const char*>(std::memchr(cursor, '<', end - cursor));
+            const char* textEnd = tagStart ? tagStart : end;
+
+            // Character data only matters inside ele and time
+            if (capture != Capture::NONE && captureText.size() < MAX_CAPTURE) {
+                size_t take = std::min<size_t>(textEnd - cursor, MAX_CAPTURE - captureText.size());
+                captureText.append(cursor, take);
+            }
+
+            if (!tagStart) {
+                cursor = end;
+                break;
+            }
+
+            if (end - tagStart < 4) {
+                cursor = tagStart;
+                break;
+            }
+
+            if (tagStart[1] == '!' && tagStart[2] == '-' && tagStart[3] == '-') {
+                inComment = true;
+                cursor = tagStart + 4;
+                continue;
+            }
+
+            const char* tagEnd = static_cast<const char*>(std::memchr(tagStart, '>', end - tagStart));
+            if (!tagEnd) {
+                cursor = tagStart;
+                break;
+            }
+
+            handleTag(tagStart + 1, tagEnd, callbacks, stats);
+            cursor = tagEnd + 1;
+        }
+
+        if (endOfFile) break;
+
+        // Carry the unfinished tag over to the front of the buffer
+        size_t remaining = static_cast<size_t>(end - cursor);
+        if (remaining == bufferSize) {
+            std::cerr << "ERROR: GPX tag larger than the " << bufferSize << " byte read buffer in " << path << std::endl;
+            failed = true;
+            break;
+        }
+        std::memmove(buffer.data(), cursor, remaining);
+        filled = remaining;
+    }
+
+    std::fclose(file);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    stats.seconds = std::chrono::duration<double>(end - start).count();
+    stats.success = !failed;
+    return stats;
+}
+
+bool GpxReader::loadPath(const std::string& path, std::vector<glm::vec3>& points, std::vector<double>* times,
+    glm::dvec2* origin) {
+    points.clear();
+    if (times) times->clear();
+
+    // Local equirectangular projection around the origin, accurate for hiking-sized areas
+    bool haveOrigin = origin && !std::isnan(origin->x) && !std::isnan(origin->y);
+    double originLatitude = haveOrigin ? origin->x : 0.0;
+    double originLongitude = haveOrigin ? origin->y : 0.0;
+    double longitudeScale = EARTH_RADIUS * DEGREES_TO_RADIANS * std::cos(originLatitude * DEGREES_TO_RADIANS);
+
+    GpxReader::Callbacks callbacks;
+    callbacks.onPoint = [&](const TrackPoint& point) {
+        if (!haveOrigin) {
+            haveOrigin = true;
+            originLatitude = point.latitude;
+            originLongitude = point.longitude;
+            longitudeScale = EARTH_RADIUS * DEGREES_TO_RADIANS * std::cos(originLatitude * DEGREES_TO_RADIANS);
+            if (origin) *origin = glm::dvec2(originLatitude, originLongitude);
+        }
+
+        // Segments and tracks are joined in file order into one path
+        double east = (point.longitude - originLongitude) * longitudeScale;
+        double north = (point.latitude - originLatitude) * EARTH_RADIUS * DEGREES_TO_RADIANS;
+        points.emplace_back(static_cast<float>(east), point.elevation, static_cast<float>(-north));
+
+        if (times) times->push_back(point.hasTime ? point.time : std::numeric_limits<double>::quiet_NaN());
+    };
+
+    GpxReader reader;
+    Stats stats = reader.read(path, callbacks);
+    if (!stats.success) return false;
+
+    double megabytes = static_cast<double>(stats.bytes) / (1024.0 * 1024.0);
+    std::cout << "INFO: GPX " << path << ": " << stats.tracks << " track(s), " << stats.segments << " segment(s), "
+        << stats.points << " points, " << megabytes << " MB in " << stats.seconds * 1000.0 << " ms ("
+        << (stats.seconds > 0.0 ? megabytes / stats.seconds : 0.0) << " MB/s)." << std::endl;
+
+    return !points.empty();
+}
@@ -0,0 +1,72 @@
+// GpxReader.h
+
+#ifndef GPX_READER_H
+#define GPX_READER_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Single-pass streaming GPX reader. The file is read through one fixed-size buffer and scanned
+// for the few elements that matter (trk, trkseg, trkpt, rte, rtept, ele, time); nothing else is
+// kept, so memory use does not depend on the file size.
+class GpxReader {
+public:
+    struct TrackPoint {
+        double latitude = 0.0;     // Degrees
+        double longitude = 0.0;    // Degrees
+        float elevation = 0.0f;    // Metres
+        double time = 0.0;         // Seconds since the Unix epoch
+        bool hasElevation = false;
+        bool hasTime = false;
+    };
+
+    struct Callbacks {
+        std::function<void(int track, int segment)> onSegmentBegin; // Called before the segment's first point
+        std::function<void(const TrackPoint& point)> onPoint;
+    };
+
+    struct Stats {
+        bool success = false;
+        size_t bytes = 0;
+        int tracks = 0;
+        int segments = 0;
+        size_t points = 0;
+        double seconds = 0.0;
+    };
+
+    explicit GpxReader(size_t bufferSize = 1 << 20);
+
+    Stats read(const std::string& path, const Callbacks& callbacks);
+
+    // Reads every segment of every track into one path in Hiker's coordinate space: X east and
+    // Z south in metres around the first point, Y the elevation. Timestamps go to times if given.
+    // Files that must share one frame pass the same origin (latitude, longitude in degrees); a NaN
+    // origin is set from the first point read.
+    static bool loadPath(const std::string& path, std::vector<glm::vec3>& points, std::vector<double>* times = nullptr,
+        glm::dvec2* origin = nullptr);
+
+    static bool isGpxFile(const std::string& path);
+
+private:
+    enum class Capture { NONE, ELEVATION, TIME };
+
+    void handleTag(const char* begin, const char* end, const Callbacks& callbacks, Stats& stats);
+    void finishCapture();
+    void emitPoint(const Callbacks& callbacks, Stats& stats);
+
+    size_t bufferSize;
+
+    // Parser state, persists across buffer refills
+    bool inPoint;
+    bool segmentOpen;
+    int trackIndex;
+    int segmentIndex;
+    Capture capture;
+    std::string captureText;  // Bounded to MAX_CAPTURE characters
+    TrackPoint currentPoint;
+};
+
+#endif // GPX_READER_H
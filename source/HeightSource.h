@@ -0,0 +1,24 @@
+// HeightSource.h
+
+#ifndef HEIGHT_SOURCE_H
+#define HEIGHT_SOURCE_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Anything that can answer world-space height queries: the loaded heightmap or a procedural world.
+class HeightSource {
+public:
+    virtual ~HeightSource() = default;
+    virtual float getHeightAtPosition(float x, float z) const = 0;
+
+    // Batched query: sets y of every point to the height at its x/z plus heightOffset.
+    // Implementations may override this with a faster, parallel version.
+    virtual void drapePoints(glm::vec3* points, size_t count, float heightOffset) const {
+        for (size_t i = 0; i < count; ++i) {
+            points[i].y = getHeightAtPosition(points[i].x, points[i].z) + heightOffset;
+        }
+    }
+};
+
+#endif // HEIGHT_SOURCE_H
@@ -1,14 +1,75 @@
 // Hiker.cpp
 #include "Hiker.h"
+#include "GpxReader.h"
+#include "PathLoader.h"
+#include "TrackFile.h"
+#include "PathResampler.h"
+#include "MappedFile.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
-#include <fstream>
 #include <algorithm>
+#include <cfloat>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+namespace {
+    constexpr float PATH_PIXEL_TOLERANCE = 0.5f; // Allowed on-screen deviation of the simplified path
+    constexpr float PATH_WIDTH_PIXELS = 4.0f;
+
+    // Most live points the published path may lag behind, and how long at most
+    constexpr size_t TAIL_PUBLISH_POINTS = 256;
+    constexpr double TAIL_PUBLISH_SECONDS = 1.0;
+
+    // Times at the fractional input indices PathResampler reports for its output points
+    std::vector<double> timesAtParameters(const std::vector<double>& times, const std::vector<float>& parameters) {
+        std::vector<double> result(parameters.size());
+        for (size_t i = 0; i < parameters.size(); ++i) {
+            size_t index = std::min(static_cast<size_t>(parameters[i]), times.size() - 1);
+            size_t next = std::min(index + 1, times.size() - 1);
+            double t = parameters[i] - static_cast<double>(index);
+            result[i] = times[index] + (times[next] - times[index]) * t;
+        }
+        return result;
+    }
+
+    // Times for a refinement of path that only inserts points on its segments, as drapePolyline
+    // does, interpolated by horizontal distance along each segment
+    std::vector<double> timesAlong(const std::vector<glm::vec3>& path, const std::vector<double>& times,
+        const std::vector<glm::vec3>& refined) {
+        std::vector<double> result(refined.size());
+        if (path.size() < 2) {
+            std::fill(result.begin(), result.end(), times.empty() ? 0.0 : times[0]);
+            return result;
+        }
+
+        auto horizontal = [](const glm::vec3& a, const glm::vec3& b) {
+            return static_cast<double>(glm::length(glm::vec2(b.x - a.x, b.z - a.z)));
+        };
+        size_t segment = 0;
+        double segmentStart = 0.0;
+        double segmentLength = horizontal(path[0], path[1]);
+        double travelled = 0.0;
+        for (size_t j = 0; j < refined.size(); ++j) {
+            if (j > 0) travelled += horizontal(refined[j - 1], refined[j]);
+            while (segment + 2 < path.size() && travelled > segmentStart + segmentLength) {
+                segmentStart += segmentLength;
+                ++segment;
+                segmentLength = horizontal(path[segment], path[segment + 1]);
+            }
+            double t = segmentLength > 0.0 ? std::clamp((travelled - segmentStart) / segmentLength, 0.0, 1.0) : 0.0;
+            result[j] = times[segment] + (times[segment + 1] - times[segment]) * t;
+        }
+        return result;
+    }
+}
 
 Hiker::Hiker(const std::string& pathFile)
-    : pathFile(pathFile), pathVAO(0), pathVBO(0), currentPosition(glm::vec3(0.0f)),
+    : pathFile(pathFile), drapeMode(DrapeMode::EXACT),
+    currentPosition(glm::vec3(0.0f)),
     progress(0.0f), currentPathIndex(0),
-    horizontalScale(1.0f), heightScale(1.0f), terrainRef(nullptr) {
+    horizontalScale(1.0f), heightScale(1.0f), terrainRef(nullptr),
+    tailOffset(0), tailOrigin(0.0f), tailLastPlaced(0.0f), tailFollowing(false) {
 }
 
 void Hiker::setScales(float hScale, float vScale) {
@@ -20,34 +81,63 @@ void Hiker::setTerrain(const Terrain* terrain) {
     terrainRef = terrain;
 }
 
-bool Hiker::loadPathData(const Terrain& terrain) {
-    std::ifstream file(pathFile);
-    if (!file.is_open()) {
-        std::cerr << "ERROR: Failed to open path file: " << pathFile << std::endl;
+void Hiker::setDrapeMode(DrapeMode mode) {
+    drapeMode = mode;
+}
+
+bool Hiker::setPath(std::vector<glm::vec3> points, const Terrain& terrain) {
+    if (points.empty()) {
+        std::cerr << "ERROR: Cannot use an empty path." << std::endl;
         return false;
     }
 
-    float x, y, z;
-    pathPoints.clear();
+    // Already in world space, e.g. from the route planner, so only draped
+    drapePath(terrain, points);
+    currentPosition = points[0];
+    pathData.store(PathData::create(std::move(points)));
+    return true;
+}
 
-    // Load raw path points
-    while (file >> x >> y >> z) {
-        pathPoints.emplace_back(x, y, z);
+bool Hiker::loadPathData(const Terrain& terrain) {
+    std::vector<glm::vec3> pathPoints;
+    std::vector<double> times;
+
+    // Load raw path points, GPX tracks are projected to metres around their first point and keep
+    // their timestamps for playback at the recorded pace
+    if (GpxReader::isGpxFile(pathFile)) {
+        if (!GpxReader::loadPath(pathFile, pathPoints, &times)) {
+            std::cerr << "ERROR: Failed to read GPX track: " << pathFile << std::endl;
+            return false;
+        }
+    }
+    else if (TrackFile::isTrackFile(pathFile)) {
+        if (!TrackFile::load(pathFile, pathPoints)) {
+            std::cerr << "ERROR: Failed to read track file: " << pathFile << std::endl;
+            return false;
+        }
+    }
+    else {
+        PathLoader::Result result = PathLoader::load(pathFile, pathPoints);
+        if (!result.success) {
+            std::cerr << "ERROR: Failed to open path file: " << pathFile << std::endl;
+            return false;
+        }
     }
-    file.close();
 
     if (pathPoints.empty()) {
         std::cerr << "ERROR: No path points loaded from file: " << pathFile << std::endl;
         return false;
     }
 
-    validatePath(terrain);
+    validatePath(terrain, pathPoints, times.empty() ? nullptr : &times);
     currentPosition = pathPoints[0];
-    setupPathVAO();
+
+    // Built completely before it is published, readers only ever see a finished path
+    pathData.store(PathData::create(std::move(pathPoints), times));
     return true;
 }
 
-void Hiker::validatePath(const Terrain& terrain) {
+void Hiker::validatePath(const Terrain& terrain, std::vector<glm::vec3>& pathPoints, std::vector<double>* times) const {
     if (pathPoints.empty()) return;
 
     // Find min and max of path points
@@ -82,97 +172,219 @@ void Hiker::validatePath(const Terrain& terrain) {
         // Scale to terrain size
         point.x = point.x * terrainWidth - terrainWidth * 0.5f;
         point.z = point.z * terrainDepth - terrainDepth * 0.5f;
+    }
+
+    drapePath(terrain, pathPoints, times);
+}
 
-        // Update Y position based on terrain height
-        float terrainHeight = terrain.getHeightAtPosition(point.x, point.z);
-        point.y = terrainHeight + 0.5f; // Slight offset above terrain
+void Hiker::drapePath(const Terrain& terrain, std::vector<glm::vec3>& pathPoints, std::vector<double>* times) const {
+    if (times && times->size() != pathPoints.size()) times = nullptr;
+
+    // One sample per heightmap cell along the trail, however densely or sparsely it was recorded
+    PathResampler::Options options;
+    options.spacing = terrain.getHorizontalScale();
+    std::vector<float> sourceParameters;
+    pathPoints = PathResampler::resample(pathPoints, options, times ? &sourceParameters : nullptr);
+    if (times) *times = timesAtParameters(*times, sourceParameters);
+
+    // Slight offset above terrain. Exact draping also adds the grid crossings between samples, so the
+    // depth-tested line lies on the rendered triangles instead of cutting through ridges.
+    if (drapeMode == DrapeMode::EXACT) {
+        std::vector<glm::vec3> draped = terrain.drapePolyline(pathPoints, 0.5f);
+        if (times) *times = timesAlong(pathPoints, *times, draped);
+        pathPoints = std::move(draped);
+    }
+    else {
+        terrain.drapePoints(pathPoints.data(), pathPoints.size(), 0.5f);
     }
+}
 
-    
-    std::vector<glm::vec3> smoothedPath; //stored smooth version of the path
-    for (size_t i = 0; i < pathPoints.size() - 1; ++i) {
-        glm::vec3 start = pathPoints[i];
-        glm::vec3 end = pathPoints[i + 1];
-        smoothedPath.push_back(start);
+bool Hiker::startTailFollow(const Terrain& terrain) {
+    stopTailFollow();
+    if (GpxReader::isGpxFile(pathFile) || TrackFile::isTrackFile(pathFile)) {
+        std::cerr << "ERROR: Tail-follow needs an \"x y z\" text path file: " << pathFile << std::endl;
+        return false;
+    }
+    if (!tailWatcher.open(pathFile)) return false;
 
-        int segments = 5; // Number of intermediate points
-        for (int j = 1; j < segments; ++j) {
-            float t = static_cast<float>(j) / segments;
-            glm::vec3 intermediatePoint = glm::mix(start, end, t);
+    // Everything up to the last complete line starts the live path
+    std::vector<glm::vec3> pathPoints;
+    MappedFile file;
+    if (file.open(pathFile)) {
+        tailOffset = PathLoader::parseLines(file.data(), file.size(), pathPoints);
+    }
+    file.close();
+    if (pathPoints.size() < 2) {
+        std::cerr << "ERROR: Tail-follow needs at least two points to start from: " << pathFile << std::endl;
+        tailWatcher.close();
+        return false;
+    }
 
-            // Update Y position based on terrain height
-            float terrainHeight = terrain.getHeightAtPosition(intermediatePoint.x, intermediatePoint.z);
-            intermediatePoint.y = terrainHeight + 0.5f;
-            smoothedPath.push_back(intermediatePoint);
-        }
+    // Stretching the path over the terrain like validatePath would change with every append, so a
+    // followed file keeps its own units and only its starting extent is centred on the terrain
+    glm::vec2 minPoint(FLT_MAX);
+    glm::vec2 maxPoint(-FLT_MAX);
+    for (const auto& point : pathPoints) {
+        minPoint = glm::min(minPoint, glm::vec2(point.x, point.z));
+        maxPoint = glm::max(maxPoint, glm::vec2(point.x, point.z));
     }
-    smoothedPath.push_back(pathPoints.back());
-    pathPoints = std::move(smoothedPath);
+    tailOrigin = (minPoint + maxPoint) * 0.5f;
+    placeTailPoints(pathPoints);
+    tailLastPlaced = pathPoints.back();
+    drapePath(terrain, pathPoints);
+
+    currentPosition = pathPoints[0];
+    pathData.store(PathData::create(std::move(pathPoints)));
+
+    tailPoints.assign(1, pathData.load()->getPoints().back());
+    tailRenderer.setPoints(tailPoints.data(), tailPoints.size());
+    tailPublishTime = std::chrono::steady_clock::now();
+    tailFollowing = true;
+
+    std::cout << "INFO: Following " << pathFile << " from byte " << tailOffset << " with "
+        << (tailWatcher.usesNotifications() ? "change notifications." : "size polling.") << std::endl;
+    return true;
+}
+
+void Hiker::stopTailFollow() {
+    // Live points are kept, the path simply stops growing
+    if (tailFollowing && tailPoints.size() > 1) publishTail();
+    tailWatcher.close();
+    tailRenderer.cleanup();
+    tailPoints.clear();
+    tailOffset = 0;
+    tailFollowing = false;
+}
+
+bool Hiker::isTailFollowing() const {
+    return tailFollowing;
 }
 
-void Hiker::setupPathVAO() {
-    if (pathVAO != 0) {
-        glDeleteVertexArrays(1, &pathVAO);
-        glDeleteBuffers(1, &pathVBO);
+bool Hiker::updateTailFollow(const Terrain& terrain) {
+    if (!tailFollowing) return false;
+    if (!tailWatcher.poll()) return publishTailIfDue();
+
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(pathFile, error);
+    if (error || size == tailOffset) return publishTailIfDue();
+    if (size < tailOffset) {
+        std::cout << "INFO: " << pathFile << " was truncated, following it from the start again." << std::endl;
+        return startTailFollow(terrain);
+    }
+
+    // Only the appended bytes are read; a line still being written is read again next time
+    std::ifstream file(pathFile, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(tailOffset));
+    std::string appended(static_cast<size_t>(size - tailOffset), '\0');
+    file.read(appended.data(), static_cast<std::streamsize>(appended.size()));
+    appended.resize(static_cast<size_t>(file.gcount()));
+
+    std::vector<glm::vec3> points;
+    size_t malformed = 0;
+    tailOffset += PathLoader::parseLines(appended.data(), appended.size(), points, &malformed);
+    if (malformed > 0) {
+        std::cerr << "ERROR: Skipped " << malformed << " malformed appended line(s) in " << pathFile << std::endl;
     }
+    if (points.empty()) return publishTailIfDue();
+
+    // The new piece starts at the previous last point, so resampling and draping continue the line
+    // and its first draped point repeats the last live one
+    placeTailPoints(points);
+    points.insert(points.begin(), tailLastPlaced);
+    tailLastPlaced = points.back();
+    drapePath(terrain, points);
+
+    tailPoints.insert(tailPoints.end(), points.begin() + 1, points.end());
+    tailRenderer.appendPoints(points.data() + 1, points.size() - 1);
+    return publishTailIfDue();
+}
 
-    glGenVertexArrays(1, &pathVAO); //The VAO will record how the vertex data is structured and used.
-    glGenBuffers(1, &pathVBO); //The VBO will hold the actual path point data.
+bool Hiker::publishTailIfDue() {
+    // Rebuilding the PathData costs its full length, so a short path waits until that has doubled;
+    // a long one is rebuilt at a bounded rate instead, so the published path never falls far behind
+    if (tailPoints.size() < 2) return false;
+    const size_t pending = tailPoints.size() - 1;
 
-    glBindVertexArray(pathVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, pathVBO); //Transfer the path data from the CPU to the GPU
-    glBufferData(GL_ARRAY_BUFFER, pathPoints.size() * sizeof(glm::vec3), pathPoints.data(), GL_STATIC_DRAW);
+    const size_t published = pathData.load()->getPointCount();
+    const double waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - tailPublishTime).count();
+    if (pending < std::min(published, TAIL_PUBLISH_POINTS) && waited < TAIL_PUBLISH_SECONDS) return false;
 
-    // Position attribute
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    publishTail();
+    return true;
+}
 
-    glBindVertexArray(0);
+void Hiker::placeTailPoints(std::vector<glm::vec3>& points) const {
+    for (auto& point : points) {
+        point.x -= tailOrigin.x;
+        point.z -= tailOrigin.y;
+    }
 }
 
+void Hiker::publishTail() {
+    PathData::Ptr published = pathData.load();
+    std::vector<glm::vec3> points;
+    points.reserve(published->getPointCount() + tailPoints.size() - 1);
+    points.insert(points.end(), published->getPoints().begin(), published->getPoints().end());
+    points.insert(points.end(), tailPoints.begin() + 1, tailPoints.end());
+    pathData.store(PathData::create(std::move(points)));
+
+    tailPoints.erase(tailPoints.begin(), tailPoints.end() - 1);
+    tailRenderer.setPoints(tailPoints.data(), tailPoints.size());
+    tailPublishTime = std::chrono::steady_clock::now();
+}
 
 void Hiker::resetPath() {
-    if (!pathPoints.empty()) {
+    PathData::Ptr path = pathData.load();
+    if (path && !path->isEmpty()) {
         currentPathIndex = 0;
         progress = 0.0f;
-        currentPosition = pathPoints[0];
+        currentPosition = path->getPoints()[0];
     }
 }
 
 
 void Hiker::renderPath(const glm::mat4& view, const glm::mat4& projection, Shader& shader) {
-    shader.use();
-    shader.setMat4("view", view);
-    shader.setMat4("projection", projection);
-    shader.setMat4("model", glm::mat4(1.0f));
-
-    glDisable(GL_DEPTH_TEST); //Disables depth testing so the path is always visible
-
-    // Draw path
-    glLineWidth(4.0f);
-    shader.setVec3("pathColor", glm::vec3(1.0f, 0.0f, 0.0f)); // Red color
-    glBindVertexArray(pathVAO);
-    glDrawArrays(GL_LINE_STRIP, 0, static_cast<GLsizei>(pathPoints.size()));
-
-    glEnable(GL_DEPTH_TEST); //ensuring normal depth behavior for other objects in the scene.
-    glLineWidth(1.0f); // avoid affecting future OpenGL line rendering.
-    glBindVertexArray(0);
+    PathData::Ptr path = pathData.load();
+    if (!path || path->getHierarchy().levels.empty()) return;
+
+    // World-space error that stays under the pixel tolerance at the closest point of the path
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glm::vec3 cameraPosition = glm::vec3(glm::inverse(view)[3]);
+    glm::vec3 closest = glm::clamp(cameraPosition, path->getBoundsMin(), path->getBoundsMax());
+    float distance = std::max(glm::length(closest - cameraPosition), 1e-3f);
+    float pixelsPerUnit = projection[1][1] * 0.5f * static_cast<float>(viewport[3]) / distance;
+    const PathSimplifier::Level& level = PathSimplifier::selectLevel(path->getHierarchy(), PATH_PIXEL_TOLERANCE / pixelsPerUnit);
+
+    // Drawn with depth testing, the renderer's bias keeps it above the terrain it is draped on
+    PolylineRenderer::Style style;
+    style.color = glm::vec4(1.0f, 0.0f, 0.0f, 0.8f); // Red color
+    style.width = PATH_WIDTH_PIXELS;
+    path->getRenderer().draw(shader, view, projection, style, level.offset, level.count);
+
+    // Points appended since the last publish, unsimplified since they are few
+    if (tailPoints.size() >= 2) {
+        tailRenderer.draw(shader, view, projection, style);
+    }
 }
 
 void Hiker::cleanup() {
-    if (pathVAO != 0) {
-        glDeleteVertexArrays(1, &pathVAO);
-        glDeleteBuffers(1, &pathVBO);
-        pathVAO = 0;
-        pathVBO = 0;
-    }
-    pathPoints.clear();
+    // The GPU buffers go with the last reference, here unless the character still holds one
+    pathData.store(nullptr);
+    tailWatcher.close();
+    tailRenderer.cleanup();
+    tailPoints.clear();
+    tailFollowing = false;
 }
 
 glm::vec3 Hiker::getPosition() const {
     return currentPosition;
 }
 
-const std::vector<glm::vec3>& Hiker::getPathPoints() const {
-    return pathPoints;
+const std::string& Hiker::getPathFile() const {
+    return pathFile;
+}
+
+PathData::Ptr Hiker::getPathData() const {
+    return pathData.load();
 }
@@ -2,19 +2,49 @@
 #ifndef HIKER_H
 #define HIKER_H
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <glm/glm.hpp>
 #include "Terrain.h"
 #include "Shader.h"
+#include "PathData.h"
+#include "FileWatcher.h"
+#include "PolylineRenderer.h"
 
 class Hiker {
 public:
+    enum class DrapeMode {
+        SAMPLED,  // Heights at the resampled points only, segments may cut through ridges
+        EXACT     // Extra vertices at every grid edge and diagonal crossing, on the mesh surface
+    };
+
     Hiker(const std::string& pathFile);
 
+    // Loads, fits and drapes the path file, then publishes it with one pointer swap; holders of the
+    // previous PathData keep using it until they let go
     bool loadPathData(const Terrain& terrain);
+
+    // Replaces the path with world-space points, e.g. a planned route, draped like a loaded one
+    bool setPath(std::vector<glm::vec3> points, const Terrain& terrain);
     void setScales(float hScale, float vScale);
     void setTerrain(const Terrain* terrain);
+    void setDrapeMode(DrapeMode mode);  // Takes effect on the next loadPathData
+
+    // Tail-follow for a text path file that a logger keeps appending to. Following starts from the
+    // file's current contents, centred on the terrain at their own scale; afterwards only the bytes
+    // appended since the last update are parsed, draped and added to a growing live line on the GPU.
+    // The live points are folded into a new PathData once they are as many as the published path
+    // holds, but at the latest every TAIL_PUBLISH_POINTS points or TAIL_PUBLISH_SECONDS, so the
+    // character and route statistics never lag the live line by more than that.
+    bool startTailFollow(const Terrain& terrain);
+    void stopTailFollow();
+    bool isTailFollowing() const;
+
+    // Reads what was appended since the last call; returns true when a longer PathData was published
+    bool updateTailFollow(const Terrain& terrain);
 
     //void moveForward(float deltaTime);
     //void moveBackward(float deltaTime);
@@ -24,22 +54,43 @@ public:
     void cleanup();
 
     glm::vec3 getPosition() const;
-    const std::vector<glm::vec3>& getPathPoints() const;
+    const std::string& getPathFile() const;
+
+    // Current path, shared rather than copied; null before the first successful load
+    PathData::Ptr getPathData() const;
 
 private:
-    void validatePath(const Terrain& terrain);
-    void setupPathVAO();
+    // times, if given, holds a timestamp per point and is resampled and draped along with them
+    void validatePath(const Terrain& terrain, std::vector<glm::vec3>& pathPoints, std::vector<double>* times = nullptr) const;
+    void placeTailPoints(std::vector<glm::vec3>& points) const;
+    void publishTail();
+    bool publishTailIfDue();
+    void drapePath(const Terrain& terrain, std::vector<glm::vec3>& pathPoints, std::vector<double>* times = nullptr) const;
 
     std::string pathFile;
-    std::vector<glm::vec3> pathPoints;
-    GLuint pathVAO;
-    GLuint pathVBO;
+    DrapeMode drapeMode;
+
+    // Points, distances, simplification levels, statistics and GPU buffers of the loaded path.
+    // Atomic so a path loaded elsewhere can be swapped in while other code holds the old one.
+    std::atomic<PathData::Ptr> pathData;
     glm::vec3 currentPosition;
     float progress;
     size_t currentPathIndex;
     float horizontalScale;
     float heightScale;
     const Terrain* terrainRef;
+
+    // Tail-follow state: the bytes parsed so far, which end after the last complete line, the file
+    // position placed at the terrain centre, the last placed point before draping, the draped
+    // points not yet in pathData, starting with its last one, and when pathData was last replaced
+    FileWatcher tailWatcher;
+    uint64_t tailOffset;
+    glm::vec2 tailOrigin;
+    glm::vec3 tailLastPlaced;
+    std::vector<glm::vec3> tailPoints;
+    std::chrono::steady_clock::time_point tailPublishTime;
+    PolylineRenderer tailRenderer;
+    bool tailFollowing;
 };
 
 #endif // HIKER_H
@@ -7,14 +7,41 @@
 #include <GLFW/glfw3.h>
 
 #include "Skybox.h"
+#include "PathLoader.h"
+#include "TrackFile.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
 #include <cmath>
 #include <algorithm>
+#include <utility>
+
+namespace {
+    constexpr float VERTICAL_FOV_DEGREES = 50.0f; // Wider Field of View for better coverage
+    constexpr float NEAR_PLANE = 0.1f;
+    constexpr int SHADOW_MAP_RESOLUTION = 2048;
+    constexpr int SHADOW_CASCADES = 4;
+    constexpr int SHADOW_TEXTURE_UNIT = 3;
+    const char* const TRAIL_NETWORK_DIRECTORY = "data/trails";
+    constexpr int HIKER_ROUTE_ID = -1;  // Path ID of the hiker's route in the segment index, trails use their TrailSet IDs
+    const char* const ROUTE_HIERARCHY_FILE = "data/terrain.routes";
+    constexpr int ISOCHRONE_TEXTURE_UNIT = 4;
+    constexpr float ISOCHRONE_BAND_SECONDS = 300.0f;  // The bundled DEM is crossed in well under an hour on foot
+    constexpr int ISOCHRONE_BAND_COUNT = 3;
+    constexpr float TRAIL_GRAPH_MERGE_CELLS = 3.0f;   // Recordings within three grid cells are one trail
+    constexpr float TRAIL_GRAPH_SNAP_CELLS = 10.0f;   // Clicks further than this from the network plan on the grid
+    constexpr float TERRAIN_CORRIDOR_RADIUS = 100.0f;  // World units either side of the route kept at full resolution
+    constexpr int TERRAIN_CORRIDOR_STEP = 8;            // Grid cells per coarse quad outside the corridor
+}
 
 HikingSimulator::HikingSimulator()
     : terrain(),
     hiker("data/hiker_path.txt"),
+    showTrailGraph(false),
+    planStart(0.0f),
+    hasPlanStart(false),
+    showIsochrones(false),
+    isochronesStale(true),
+    useTerrainCorridor(false),
     animatedCharacter(),
     lighting(glm::vec3(1000.0f, 1000.0f, 1000.0f), glm::vec3(1.0f, 0.95f, 0.8f)),
     width(0),
@@ -38,7 +65,149 @@ HikingSimulator::HikingSimulator()
     yaw(-90.0f),
     pitch(0.0f),
     rainParticleSystem(15000), // Initialize with max 2000 particles
-    isRaining(false) {
+    isRaining(false),
+    useProceduralTerrain(false),
+    shadowTileRevision(0) {
+}
+
+void HikingSimulator::buildSegmentIndex() {
+    std::vector<SegmentIndex::PathRef> paths;
+
+    // The index copies segment end points, the route only has to live through the build
+    PathData::Ptr route = hiker.getPathData();
+    if (route) paths.push_back({ route->getPoints().data(), route->getPointCount(), HIKER_ROUTE_ID });
+
+    for (int id = 0; id < trailSet.getTrailIdLimit(); ++id) {
+        const std::vector<glm::vec3>& points = trailSet.getTrailPoints(id);
+        if (!points.empty()) paths.push_back({ points.data(), points.size(), id });
+    }
+
+    segmentIndex.build(paths);
+    segmentIndex.benchmark(10000);
+}
+
+void HikingSimulator::buildTrailGraph() {
+    std::vector<const std::vector<glm::vec3>*> tracks;
+    for (int id = 0; id < trailSet.getTrailIdLimit(); ++id) {
+        if (trailSet.isTrailActive(id)) tracks.push_back(&trailSet.getTrailPoints(id));
+    }
+    if (tracks.empty()) return;
+
+    // Vertices one grid cell apart, like the trails' own resampling
+    TrailGraph::Options options;
+    options.cellSize = terrain.getHorizontalScale();
+    options.mergeRadius = options.cellSize * TRAIL_GRAPH_MERGE_CELLS;
+    trailGraph.build(tracks, options);
+    trailGraphSet.loadGraph(trailGraph, terrain);
+}
+
+bool HikingSimulator::pickTerrain(GLFWwindow* window, glm::vec3& hit) const {
+    double cursorX, cursorY;
+    int windowSizeX, windowSizeY;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+    glfwGetWindowSize(window, &windowSizeX, &windowSizeY);
+    if (windowSizeX <= 0 || windowSizeY <= 0) return false;
+
+    // Cursor to normalized device coordinates, then back through the camera to a world-space ray
+    float ndcX = static_cast<float>(2.0 * cursorX / windowSizeX - 1.0);
+    float ndcY = static_cast<float>(1.0 - 2.0 * cursorY / windowSizeY);
+    glm::mat4 inverseViewProjection = glm::inverse(projectionMatrix * viewMatrix);
+    glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+
+    return terrain.raycast(origin, direction, glm::length(direction), hit);
+}
+
+void HikingSimulator::updateRouteHierarchy() {
+    // Heights are copied on every call so erosion edits are always taken into account; the cached
+    // hierarchy is loaded once and then only clusters whose heights differ are rebuilt and saved
+    routePlanner.setTerrain(terrain);
+    if (routeHierarchy.isEmpty()) {
+        routeHierarchy.load(ROUTE_HIERARCHY_FILE);
+    }
+    if (routeHierarchy.update(routePlanner) > 0) {
+        routeHierarchy.save(ROUTE_HIERARCHY_FILE);
+    }
+}
+
+void HikingSimulator::planRouteTo(const glm::vec3& goal) {
+    // While the merged network is shown, routes follow its trails when both ends are close to one
+    RoutePlanner::Result result;
+    if (showTrailGraph && !trailGraph.isEmpty()) {
+        result = trailGraph.plan(planStart, goal, terrain.getHorizontalScale() * TRAIL_GRAPH_SNAP_CELLS);
+        if (result.found) std::cout << "INFO: Route follows the trail network." << std::endl;
+    }
+    if (!result.found) {
+        updateRouteHierarchy();
+        result = routeHierarchy.isEmpty()
+            ? routePlanner.plan(planStart, goal)
+            : routeHierarchy.plan(routePlanner, planStart, goal);
+    }
+    if (!result.found) {
+        std::cerr << "ERROR: No walkable route between the selected points." << std::endl;
+        return;
+    }
+
+    std::cout << "INFO: Planned route: " << result.points.size() << " grid vertices, "
+        << result.duration / 60.0 << " min walking, " << result.expanded << " vertices expanded in "
+        << result.milliseconds << " ms." << std::endl;
+
+    // A planned route replaces the followed file
+    if (hiker.isTailFollowing()) hiker.stopTailFollow();
+
+    if (hiker.setPath(std::move(result.points), terrain)) {
+        animatedCharacter.loadPathData(hiker.getPathData());
+        animatedCharacter.resetHike();
+        buildSegmentIndex();
+        updateIsochrones();
+        updateTerrainCorridor();
+    }
+}
+
+void HikingSimulator::extendRoute() {
+    // The published path only grew at its end, so the character keeps its distance along it
+    float travelled = animatedCharacter.getDistanceTravelled();
+    animatedCharacter.loadPathData(hiker.getPathData());
+    animatedCharacter.seekToDistance(travelled);
+    buildSegmentIndex();
+    updateTerrainCorridor();
+}
+
+void HikingSimulator::updateTerrainCorridor() {
+    // Off and staying off: the full mesh is already in place
+    if (!useTerrainCorridor && !terrain.isCorridorEnabled()) return;
+
+    std::vector<glm::vec3> path;
+    PathData::Ptr route = hiker.getPathData();
+    if (useTerrainCorridor && route) path = route->getPoints();
+
+    // An empty path puts the full mesh back; a new mesh is new static shadow geometry
+    if (terrain.setCorridor(path, TERRAIN_CORRIDOR_RADIUS, TERRAIN_CORRIDOR_STEP)) {
+        shadowMap.invalidateStaticCasters();
+    }
+}
+
+void HikingSimulator::updateIsochrones() {
+    // Solving takes a while on large grids, so a hidden overlay is only marked for the next toggle
+    isochronesStale = !showIsochrones;
+    if (!showIsochrones) return;
+
+    // The route's first point is the trailhead
+    std::vector<glm::vec3> seeds;
+    PathData::Ptr route = hiker.getPathData();
+    if (route && !route->isEmpty()) seeds.push_back(route->getPoints().front());
+
+    isochrones.setBands(ISOCHRONE_BAND_SECONDS, ISOCHRONE_BAND_COUNT);
+    isochrones.compute(terrain, seeds);
+}
+
+const HeightSource& HikingSimulator::getActiveHeightSource() const {
+    if (useProceduralTerrain) {
+        return proceduralTerrain;
+    }
+    return terrain;
 }
 
 void HikingSimulator::setWindowDimensions(int width, int height) {
@@ -84,10 +253,16 @@ bool HikingSimulator::initialize() {
         std::cout << "INFO: Hiker path loaded successfully." << std::endl;
     }
 
+    // The trail network is optional, every path file in the directory becomes one trail
+    trailSet.loadDirectory(TRAIL_NETWORK_DIRECTORY, terrain);
+    buildTrailGraph();
+    buildSegmentIndex();
+    updateRouteHierarchy();
+
     // Load shaders
-    pathShader = std::make_unique<Shader>("shaders/hikerVert.glsl", "shaders/hikerFrag.glsl");
-    if (!pathShader || !pathShader->isLoaded()) {
-        std::cerr << "ERROR: Failed to load path shader during initialization." << std::endl;
+    polylineShader = std::make_unique<Shader>("shaders/polylineVert.glsl", "shaders/polylineFrag.glsl");
+    if (!polylineShader || !polylineShader->isLoaded()) {
+        std::cerr << "ERROR: Failed to load polyline shader during initialization." << std::endl;
         return false;
     }
 
@@ -97,14 +272,15 @@ bool HikingSimulator::initialize() {
         return false;
     }
 
-    traceShader = std::make_unique<Shader>("shaders/traceVert.glsl", "shaders/traceFrag.glsl");
-    if (!traceShader || !traceShader->isLoaded()) {
-        std::cerr << "ERROR: Failed to load trace shader during initialization." << std::endl;
-        return false;
+    // Shadows are optional, the terrain shader falls back to unshadowed lighting
+    if (shadowMap.initialize(SHADOW_MAP_RESOLUTION, SHADOW_CASCADES)) {
+        float terrainExtent = std::max(width, height) * terrain.getHorizontalScale();
+        shadowMap.setShadowDistance(terrainExtent);
+        shadowMap.setCasterExtent(terrainExtent + terrain.getMaxHeight());
     }
 
     setupMatrices();
-    animatedCharacter.loadPathData(hiker.getPathPoints());
+    animatedCharacter.loadPathData(hiker.getPathData());
     lastFrameTime = static_cast<float>(glfwGetTime());
 
     std::cout << "INFO: HikingSimulator initialized successfully." << std::endl;
@@ -151,7 +327,7 @@ void HikingSimulator::updateViewMatrix() {
         glm::vec3 desiredPosition = characterPos - forwardDir * cameraDistance + glm::vec3(0.0f, cameraHeight, 0.0f);
 
         // Ensure the camera stays above the terrain
-        float terrainHeightAtCamera = terrain.getHeightAtPosition(desiredPosition.x, desiredPosition.z);
+        float terrainHeightAtCamera = getActiveHeightSource().getHeightAtPosition(desiredPosition.x, desiredPosition.z);
         desiredPosition.y = std::max(desiredPosition.y, terrainHeightAtCamera + 2.0f); 
 
         cameraPosition = desiredPosition;
@@ -173,14 +349,14 @@ void HikingSimulator::updateViewMatrix() {
 //Defines how the 3D scene is projected onto a 2D screen
 void HikingSimulator::updateProjectionMatrix() {
     float aspectRatio = windowWidth / windowHeight;
-    float verticalFOV = 50.0f;  // Wider Field of View for better coverage
+    float verticalFOV = VERTICAL_FOV_DEGREES;
     float hScale = terrain.getHorizontalScale();
     float viewDistance = std::max(width * hScale, height * hScale);
 
     projectionMatrix = glm::perspective(
         glm::radians(verticalFOV),//Converts the field of view from degrees to radians
         aspectRatio,
-        0.1f, //0.1f ensures nearby objects are rendered without clipping.
+        NEAR_PLANE, //0.1f ensures nearby objects are rendered without clipping.
         viewDistance * 3.0f //camera can see beyond the terrains maximum extent.
     );
 }
@@ -232,6 +408,251 @@ void HikingSimulator::processInput(GLFWwindow* window, float deltaTime) {
         rainTogglePressed = false; // Reset when the key is released
     }
 
+    // Run a batch of erosion iterations with 'E' key
+    static bool erosionPressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
+        if (!erosionPressed) {
+            erosionPressed = true;
+            erosion.run(terrain, 50);
+            shadowMap.invalidateStaticCasters();
+            updateRouteHierarchy();
+            updateIsochrones();
+        }
+    }
+    else {
+        erosionPressed = false;
+    }
+
+    // Toggle the procedural world with 'P' key
+    static bool proceduralTogglePressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS) {
+        if (!proceduralTogglePressed) {
+            proceduralTogglePressed = true;
+            useProceduralTerrain = !useProceduralTerrain;
+            shadowMap.invalidateStaticCasters();
+
+            if (useProceduralTerrain) {
+                proceduralTerrain.setHeightScale(terrain.getHeightScale());
+                proceduralTerrain.setCellSize(terrain.getHorizontalScale());
+                proceduralTerrain.benchmark();
+            }
+            else {
+                proceduralTerrain.cleanup();
+            }
+        }
+    }
+    else {
+        proceduralTogglePressed = false;
+    }
+
+    // Compare the mapped path loader against the ifstream one with 'L' key, then convert the path
+    // to the binary track format and time its decoder
+    static bool loaderBenchmarkPressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) {
+        if (!loaderBenchmarkPressed) {
+            loaderBenchmarkPressed = true;
+            PathLoader::benchmark(hiker.getPathFile());
+            TrackFile::benchmark(hiker.getPathFile());
+        }
+    }
+    else {
+        loaderBenchmarkPressed = false;
+    }
+
+    // Report the trail closest to the camera with 'N' key
+    static bool nearestPressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS) {
+        if (!nearestPressed) {
+            nearestPressed = true;
+            SegmentIndex::Hit hit;
+            if (segmentIndex.findNearest(glm::vec2(cameraPosition.x, cameraPosition.z), hit)) {
+                int path = segmentIndex.getSegmentPath(hit.segment);
+                std::cout << "INFO: Nearest trail: " << (path == HIKER_ROUTE_ID ? "hiker route" : trailSet.getTrailName(path))
+                    << ", segment " << segmentIndex.getSegmentStartIndex(hit.segment) << ", " << hit.distance
+                    << " units away." << std::endl;
+            }
+        }
+    }
+    else {
+        nearestPressed = false;
+    }
+
+    // Report distance, climb and time left to the end of the route with 'I' key
+    static bool routeInfoPressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) {
+        if (!routeInfoPressed) {
+            routeInfoPressed = true;
+            // Segments count along the path the character walks, which may predate a reload
+            PathData::Ptr route = animatedCharacter.getPathData();
+            if (route && !route->getStats().isEmpty()) {
+                const RouteStats& stats = route->getStats();
+                RouteStats::Summary remaining = stats.getRange(animatedCharacter.getCurrentSegment(), stats.getPointCount() - 1);
+                std::cout << "INFO: Remaining: " << RouteStats::format(remaining) << std::endl;
+            }
+        }
+    }
+    else {
+        routeInfoPressed = false;
+    }
+
+    // Seek the character a tenth of the trail back or forward with '[' and ']' keys
+    static bool seekPressed = false;
+    bool seekBack = glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS;
+    bool seekForward = glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS;
+
+    if (seekBack || seekForward) {
+        if (!seekPressed) {
+            seekPressed = true;
+            float step = animatedCharacter.getPathLength() * 0.1f * (seekForward ? 1.0f : -1.0f);
+            animatedCharacter.seekToDistance(animatedCharacter.getDistanceTravelled() + step);
+        }
+    }
+    else {
+        seekPressed = false;
+    }
+
+    // Plan a route with left clicks on the terrain while the cursor is free: the first click sets
+    // the start, the second the goal
+    static bool planClickPressed = false;
+
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS && !isMouseEnabled && !useProceduralTerrain) {
+        if (!planClickPressed) {
+            planClickPressed = true;
+            glm::vec3 picked;
+            if (pickTerrain(window, picked)) {
+                if (!hasPlanStart) {
+                    planStart = picked;
+                    hasPlanStart = true;
+                    std::cout << "INFO: Route start set, click the goal." << std::endl;
+                }
+                else {
+                    hasPlanStart = false;
+                    planRouteTo(picked);
+                }
+            }
+        }
+    }
+    else {
+        planClickPressed = false;
+    }
+
+    // Time the route planner on the terrain and on larger generated DEMs with 'B' key
+    static bool plannerBenchmarkPressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS) {
+        if (!plannerBenchmarkPressed) {
+            plannerBenchmarkPressed = true;
+            routePlanner.setTerrain(terrain);
+            routePlanner.benchmark(10);
+        }
+    }
+    else {
+        plannerBenchmarkPressed = false;
+    }
+
+    // Toggle the walking-time bands from the trailhead with 'H' key
+    static bool isochroneTogglePressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS) {
+        if (!isochroneTogglePressed) {
+            isochroneTogglePressed = true;
+            showIsochrones = !showIsochrones;
+            if (showIsochrones && isochronesStale) {
+                updateIsochrones();
+            }
+        }
+    }
+    else {
+        isochroneTogglePressed = false;
+    }
+
+    // Switch between the recorded trails and the merged trail network with 'G' key
+    static bool trailGraphTogglePressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS) {
+        if (!trailGraphTogglePressed) {
+            trailGraphTogglePressed = true;
+            showTrailGraph = !showTrailGraph && !trailGraph.isEmpty();
+            std::cout << "INFO: Showing " << (showTrailGraph ? "merged trail network." : "recorded trails.") << std::endl;
+        }
+    }
+    else {
+        trailGraphTogglePressed = false;
+    }
+
+    // Toggle full-resolution terrain only around the route with 'C' key
+    static bool corridorTogglePressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) {
+        if (!corridorTogglePressed) {
+            corridorTogglePressed = true;
+            useTerrainCorridor = !useTerrainCorridor;
+            updateTerrainCorridor();
+            std::cout << "INFO: Terrain mesh: " << terrain.getTriangleCount() << " triangles." << std::endl;
+        }
+    }
+    else {
+        corridorTogglePressed = false;
+    }
+
+    // Replay a timestamped recording at its real pace with 'K' key: off, 1x, 10x, 100x, 1000x
+    static bool playbackRatePressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) {
+        if (!playbackRatePressed) {
+            playbackRatePressed = true;
+            float rate = animatedCharacter.getPlaybackRate();
+            rate = rate <= 0.0f ? 1.0f : (rate >= 1000.0f ? 0.0f : rate * 10.0f);
+            animatedCharacter.setPlaybackRate(rate);
+            if (rate <= 0.0f) {
+                std::cout << "INFO: Walking at the slope-adjusted speed." << std::endl;
+            }
+            else if (!animatedCharacter.isTimedPlayback()) {
+                std::cout << "INFO: The path has no timestamps; walking at the slope-adjusted speed." << std::endl;
+            }
+            else {
+                std::cout << "INFO: Replaying the recording at " << rate << "x." << std::endl;
+            }
+        }
+    }
+    else {
+        playbackRatePressed = false;
+    }
+
+    // Follow the path file live while a logger appends to it with 'F' key
+    static bool tailFollowPressed = false;
+
+    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS) {
+        if (!tailFollowPressed) {
+            tailFollowPressed = true;
+            if (hiker.isTailFollowing()) {
+                hiker.stopTailFollow();
+                extendRoute();
+                std::cout << "INFO: Stopped following " << hiker.getPathFile() << "." << std::endl;
+            }
+            else if (hiker.startTailFollow(terrain)) {
+                // Refitted onto the terrain, so the hike starts over
+                animatedCharacter.loadPathData(hiker.getPathData());
+                animatedCharacter.resetHike();
+                buildSegmentIndex();
+                updateIsochrones();
+                updateTerrainCorridor();
+            }
+        }
+    }
+    else {
+        tailFollowPressed = false;
+    }
+
+    if (hiker.isTailFollowing() && hiker.updateTailFollow(terrain)) {
+        extendRoute();
+    }
+
     // Other controls
     if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
         animatedCharacter.resetHike();
@@ -243,7 +664,7 @@ void HikingSimulator::processInput(GLFWwindow* window, float deltaTime) {
     }
 
     // Update positions
-    animatedCharacter.updatePosition(deltaTime, terrain);
+    animatedCharacter.updatePosition(deltaTime, getActiveHeightSource());
 
     updateViewMatrix();
 }
@@ -296,6 +717,11 @@ void HikingSimulator::render(float deltaTime) {
         updateViewMatrix();
     }
 
+    if (useProceduralTerrain) {
+        proceduralTerrain.update(cameraPosition);
+    }
+    renderShadows();
+
     // allow the skybox to render correctly even at maximum depth.
     glDepthFunc(GL_LEQUAL);
     glm::mat4 skyboxView = glm::mat4(glm::mat3(viewMatrix)); // Remove translation
@@ -316,6 +742,7 @@ void HikingSimulator::render(float deltaTime) {
 
     // Set light properties
     terrainShader.setVec3("light.position", lighting.getPosition());
+    terrainShader.setVec3("sunDirection", lighting.getDirection());
     terrainShader.setVec3("light.color", glm::vec3(1.0f));
     terrainShader.setVec3("light.ambient", glm::vec3(0.3f));
     terrainShader.setVec3("light.diffuse", glm::vec3(0.7f));
@@ -334,24 +761,27 @@ void HikingSimulator::render(float deltaTime) {
     terrainShader.setMat4("view", viewMatrix);
     terrainShader.setMat4("projection", projectionMatrix);
 
+    shadowMap.apply(terrainShader, SHADOW_TEXTURE_UNIT);
+    isochrones.apply(terrainShader, ISOCHRONE_TEXTURE_UNIT, showIsochrones && !useProceduralTerrain);
+
     // Render terrain
-    terrain.render(modelMatrix, viewMatrix, projectionMatrix, cameraPosition);
+    if (useProceduralTerrain) {
+        proceduralTerrain.render(modelMatrix, viewMatrix, projectionMatrix, cameraPosition, terrainShader);
+    }
+    else {
+        terrain.render(modelMatrix, viewMatrix, projectionMatrix, cameraPosition);
+    }
 
     // Disable face culling for transparent objects
     glDisable(GL_CULL_FACE);
 
     // Render path
-    if (pathShader && pathShader->isLoaded()) {
+    if (polylineShader && polylineShader->isLoaded()) {
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-        pathShader->use();
-        pathShader->setMat4("model", modelMatrix);
-        pathShader->setMat4("view", viewMatrix);
-        pathShader->setMat4("projection", projectionMatrix);
-        pathShader->setVec3("pathColor", glm::vec3(1.0f, 0.0f, 0.0f));
-
-        hiker.renderPath(viewMatrix, projectionMatrix, *pathShader);
+        (showTrailGraph ? trailGraphSet : trailSet).render(viewMatrix, projectionMatrix, *polylineShader);
+        hiker.renderPath(viewMatrix, projectionMatrix, *polylineShader);
 
         glDisable(GL_BLEND);
     }
@@ -381,26 +811,53 @@ void HikingSimulator::render(float deltaTime) {
 
 
     // Render the trace
-    if (traceShader && traceShader->isLoaded()) {
+    if (polylineShader && polylineShader->isLoaded()) {
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-        animatedCharacter.renderTrace(viewMatrix, projectionMatrix, *traceShader);
+        animatedCharacter.renderTrace(viewMatrix, projectionMatrix, *polylineShader);
 
         glDisable(GL_BLEND);
     }
 
     // Update and render rain particle system if rain effect is active
     if (isRaining) {
-        rainParticleSystem.update(deltaTime, cameraPosition, terrain);
+        rainParticleSystem.update(deltaTime, cameraPosition, getActiveHeightSource());
         rainParticleSystem.render(viewMatrix, projectionMatrix);
         std::cout << "INFO: Rendering rain particles." << std::endl;
     }
 }
 
+void HikingSimulator::renderShadows() {
+    // Streamed tiles change the static geometry, so the cached terrain depth has to follow
+    if (useProceduralTerrain && proceduralTerrain.getTileRevision() != shadowTileRevision) {
+        shadowTileRevision = proceduralTerrain.getTileRevision();
+        shadowMap.invalidateStaticCasters();
+    }
+
+    shadowMap.render(viewMatrix, glm::radians(VERTICAL_FOV_DEGREES), windowWidth / windowHeight, NEAR_PLANE,
+        lighting.getDirection(),
+        [this](Shader& depthShader) {
+            if (useProceduralTerrain) {
+                proceduralTerrain.renderDepth(depthShader);
+            }
+            else {
+                terrain.renderDepth(depthShader);
+            }
+        },
+        [this](Shader& depthShader) {
+            animatedCharacter.renderDepth(depthShader);
+        });
+}
+
 void HikingSimulator::cleanup() {
     terrain.cleanup();
+    shadowMap.cleanup();
+    isochrones.cleanup();
+    proceduralTerrain.cleanup();
     hiker.cleanup();
+    trailSet.cleanup();
+    trailGraphSet.cleanup();
     animatedCharacter.cleanup();
     rainParticleSystem.cleanup();
     Skybox::getInstance().cleanup();
@@ -13,6 +13,15 @@
 #include "Lighting.h"
 #include "AnimatedCharacter.h"
 #include "ParticleSystem.h"
+#include "HydraulicErosion.h"
+#include "ProceduralTerrain.h"
+#include "CascadedShadowMap.h"
+#include "TrailSet.h"
+#include "TrailGraph.h"
+#include "SegmentIndex.h"
+#include "RoutePlanner.h"
+#include "RouteHierarchy.h"
+#include "IsochroneMap.h"
 
 class HikingSimulator {
 public:
@@ -28,6 +37,38 @@ public:
 private:
     Terrain terrain;
     Hiker hiker;
+    TrailSet trailSet;  // Regional trail network drawn around the hiker's route
+    SegmentIndex segmentIndex;  // Every segment of the route and the network, for nearest-trail queries
+    void buildSegmentIndex();
+
+    // The network's overlapping recordings merged into shared sections; shown instead of the raw
+    // trails, routes are planned along it
+    TrailGraph trailGraph;
+    TrailSet trailGraphSet;
+    bool showTrailGraph;
+    void buildTrailGraph();
+
+    // Routes planned between two clicked terrain points replace the loaded path
+    RoutePlanner routePlanner;
+    RouteHierarchy routeHierarchy;  // Cached next to the terrain, rebuilt per cluster when heights change
+    glm::vec3 planStart;
+    bool hasPlanStart;
+    bool pickTerrain(GLFWwindow* window, glm::vec3& hit) const;
+    void planRouteTo(const glm::vec3& goal);
+    void updateRouteHierarchy();
+
+    // Walking-time bands from the trailhead, solved only while they are shown
+    IsochroneMap isochrones;
+    bool showIsochrones;
+    bool isochronesStale;
+    void updateIsochrones();
+
+    // Full-resolution terrain only along the route, for DEMs too large to draw whole
+    bool useTerrainCorridor;
+    void updateTerrainCorridor();
+
+    // Picks up a longer path published by the hiker's tail-follow without restarting the hike
+    void extendRoute();
     AnimatedCharacter animatedCharacter;
     Lighting lighting;
     float width, height;
@@ -64,10 +105,23 @@ private:
     ParticleSystem rainParticleSystem;
     bool isRaining;
 
+    // Terrain aging
+    HydraulicErosion erosion;
+
+    // Unbounded noise world for load tests, replaces the heightmap while enabled
+    ProceduralTerrain proceduralTerrain;
+    bool useProceduralTerrain;
+
+    const HeightSource& getActiveHeightSource() const;
+
+    // Sun shadows; the terrain depth is cached per cascade and only the character is redrawn every frame
+    CascadedShadowMap shadowMap;
+    unsigned int shadowTileRevision;
+    void renderShadows();
+
     // Shader pointers
-    std::unique_ptr<Shader> pathShader;
+    std::unique_ptr<Shader> polylineShader; // Thick lines for the path and the trace
     std::unique_ptr<Shader> characterShader;
-    std::unique_ptr<Shader> traceShader;
 
     void toggleRain();
 };
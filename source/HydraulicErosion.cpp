@@ -0,0 +1,403 @@
+// HydraulicErosion.cpp
+
+#include "HydraulicErosion.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EROSION_USE_SSE 1
+#endif
+
+namespace {
+    constexpr int TILE_ROWS = 32;           // Rows per work item handed to the pool
+    constexpr int UPDATE_BAND_ROWS = 64;    // Rows per dirty rectangle sent back to the terrain
+    constexpr float MIN_DEPTH = 1e-4f;
+    constexpr float CHANGE_EPSILON = 1e-4f;
+}
+
+HydraulicErosion::HydraulicErosion()
+    : width(0), height(0), cellSize(1.0f), lastIterationsPerSecond(0.0f) {
+}
+
+void HydraulicErosion::setParameters(const Parameters& params) {
+    parameters = params;
+}
+
+const HydraulicErosion::Parameters& HydraulicErosion::getParameters() const {
+    return parameters;
+}
+
+float HydraulicErosion::getLastIterationsPerSecond() const {
+    return lastIterationsPerSecond;
+}
+
+void HydraulicErosion::reset() {
+    std::fill(water.begin(), water.end(), 0.0f);
+    std::fill(sediment.begin(), sediment.end(), 0.0f);
+    std::fill(fluxLeft.begin(), fluxLeft.end(), 0.0f);
+    std::fill(fluxRight.begin(), fluxRight.end(), 0.0f);
+    std::fill(fluxTop.begin(), fluxTop.end(), 0.0f);
+    std::fill(fluxBottom.begin(), fluxBottom.end(), 0.0f);
+    std::fill(velocityX.begin(), velocityX.end(), 0.0f);
+    std::fill(velocityZ.begin(), velocityZ.end(), 0.0f);
+}
+
+void HydraulicErosion::initialize(const Terrain& terrain) {
+    width = terrain.getWidth();
+    height = terrain.getHeight();
+
+    size_t cellCount = static_cast<size_t>(width) * height;
+    bedrock.assign(cellCount, 0.0f);
+    water.assign(cellCount, 0.0f);
+    sediment.assign(cellCount, 0.0f);
+    sedimentNext.assign(cellCount, 0.0f);
+    capacity.assign(cellCount, 0.0f);
+    fluxLeft.assign(cellCount, 0.0f);
+    fluxRight.assign(cellCount, 0.0f);
+    fluxTop.assign(cellCount, 0.0f);
+    fluxBottom.assign(cellCount, 0.0f);
+    velocityX.assign(cellCount, 0.0f);
+    velocityZ.assign(cellCount, 0.0f);
+}
+
+bool HydraulicErosion::run(Terrain& terrain, int iterations) {
+    const std::vector<float>& heights = terrain.getHeights();
+    if (heights.empty() || terrain.getWidth() < 3 || terrain.getHeight() < 3) {
+        std::cerr << "ERROR: Erosion needs a loaded terrain!" << std::endl;
+        return false;
+    }
+
+    if (terrain.getWidth() != width || terrain.getHeight() != height) {
+        initialize(terrain);
+    }
+
+    // Always start from the current terrain; water and sediment carry over between runs
+    std::copy(heights.begin(), heights.end(), bedrock.begin());
+    cellSize = terrain.getHorizontalScale();
+
+    ThreadPool& pool = ThreadPool::getInstance();
+    auto runPass = [&](void (HydraulicErosion::*pass)(int, int)) {
+        pool.parallelFor(0, static_cast<size_t>(height), [this, pass](size_t rowBegin, size_t rowEnd) {
+            (this->*pass)(static_cast<int>(rowBegin), static_cast<int>(rowEnd));
+        }, TILE_ROWS);
+    };
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        runPass(&HydraulicErosion::computeOutflow);
+        runPass(&HydraulicErosion::updateWaterAndVelocity);
+        runPass(&HydraulicErosion::erodeAndDeposit);
+        runPass(&HydraulicErosion::transportSediment);
+        sediment.swap(sedimentNext);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    lastIterationsPerSecond = seconds > 0.0 ? static_cast<float>(iterations / seconds) : 0.0f;
+
+    std::cout << "INFO: Erosion ran " << iterations << " iterations in " << seconds * 1000.0 << " ms ("
+        << lastIterationsPerSecond << " it/s, " << pool.getThreadCount() << " workers)" << std::endl;
+
+    applyChanges(terrain);
+    return true;
+}
+
+// Pass 1: accelerate the outflow through the four pipes from the surface height differences,
+// then scale it down so a cell never sends away more water than it holds.
+void HydraulicErosion::computeOutflowCell(int x, int z) {
+    const Parameters& p = parameters;
+    int i = z * width + x;
+
+    float surface = bedrock[i] + water[i];
+    float fluxScale = p.timeStep * p.pipeArea * p.gravity / cellSize;
+
+    // Rain is uniform, so it does not change the surface differences; only the own depth needs it
+    float fL = x > 0 ? std::max(0.0f, fluxLeft[i] + fluxScale * (surface - bedrock[i - 1] - water[i - 1])) : 0.0f;
+    float fR = x < width - 1 ? std::max(0.0f, fluxRight[i] + fluxScale * (surface - bedrock[i + 1] - water[i + 1])) : 0.0f;
+    float fT = z > 0 ? std::max(0.0f, fluxTop[i] + fluxScale * (surface - bedrock[i - width] - water[i - width])) : 0.0f;
+    float fB = z < height - 1 ? std::max(0.0f, fluxBottom[i] + fluxScale * (surface - bedrock[i + width] - water[i + width])) : 0.0f;
+
+    float outVolume = (fL + fR + fT + fB) * p.timeStep;
+    float available = (water[i] + p.timeStep * p.rainRate) * cellSize * cellSize;
+    float k = outVolume > 0.0f ? std::min(1.0f, available / outVolume) : 0.0f;
+
+    fluxLeft[i] = fL * k;
+    fluxRight[i] = fR * k;
+    fluxTop[i] = fT * k;
+    fluxBottom[i] = fB * k;
+}
+
+void HydraulicErosion::computeOutflow(int rowBegin, int rowEnd) {
+    for (int z = rowBegin; z < rowEnd; ++z) {
+        if (z == 0 || z == height - 1) {
+            for (int x = 0; x < width; ++x) computeOutflowCell(x, z);
+            continue;
+        }
+
+        computeOutflowCell(0, z);
+        int x = 1;
+
+#ifdef EROSION_USE_SSE
+        const Parameters& p = parameters;
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 tiny = _mm_set1_ps(1e-12f);
+        const __m128 fluxScale = _mm_set1_ps(p.timeStep * p.pipeArea * p.gravity / cellSize);
+        const __m128 timeStep = _mm_set1_ps(p.timeStep);
+        const __m128 rain = _mm_set1_ps(p.timeStep * p.rainRate);
+        const __m128 cellArea = _mm_set1_ps(cellSize * cellSize);
+
+        const float* b = bedrock.data();
+        const float* d = water.data();
+
+        for (; x + 4 <= width - 1; x += 4) {
+            int i = z * width + x;
+
+            __m128 surface = _mm_add_ps(_mm_loadu_ps(b + i), _mm_loadu_ps(d + i));
+            __m128 left = _mm_add_ps(_mm_loadu_ps(b + i - 1), _mm_loadu_ps(d + i - 1));
+            __m128 right = _mm_add_ps(_mm_loadu_ps(b + i + 1), _mm_loadu_ps(d + i + 1));
+            __m128 top = _mm_add_ps(_mm_loadu_ps(b + i - width), _mm_loadu_ps(d + i - width));
+            __m128 bottom = _mm_add_ps(_mm_loadu_ps(b + i + width), _mm_loadu_ps(d + i + width));
+
+            __m128 fL = _mm_max_ps(zero, _mm_add_ps(_mm_loadu_ps(&fluxLeft[i]), _mm_mul_ps(fluxScale, _mm_sub_ps(surface, left))));
+            __m128 fR = _mm_max_ps(zero, _mm_add_ps(_mm_loadu_ps(&fluxRight[i]), _mm_mul_ps(fluxScale, _mm_sub_ps(surface, right))));
+            __m128 fT = _mm_max_ps(zero, _mm_add_ps(_mm_loadu_ps(&fluxTop[i]), _mm_mul_ps(fluxScale, _mm_sub_ps(surface, top))));
+            __m128 fB = _mm_max_ps(zero, _mm_add_ps(_mm_loadu_ps(&fluxBottom[i]), _mm_mul_ps(fluxScale, _mm_sub_ps(surface, bottom))));
+
+            // When nothing flows out all fluxes are zero, so clamping the divisor is enough
+            __m128 outVolume = _mm_mul_ps(_mm_add_ps(_mm_add_ps(fL, fR), _mm_add_ps(fT, fB)), timeStep);
+            __m128 available = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(d + i), rain), cellArea);
+            __m128 k = _mm_min_ps(one, _mm_div_ps(available, _mm_max_ps(outVolume, tiny)));
+
+            _mm_storeu_ps(&fluxLeft[i], _mm_mul_ps(fL, k));
+            _mm_storeu_ps(&fluxRight[i], _mm_mul_ps(fR, k));
+            _mm_storeu_ps(&fluxTop[i], _mm_mul_ps(fT, k));
+            _mm_storeu_ps(&fluxBottom[i], _mm_mul_ps(fB, k));
+        }
+#endif
+
+        for (; x < width; ++x) computeOutflowCell(x, z);
+    }
+}
+
+// Pass 2: move the water along the pipes, derive the velocity field and the sediment capacity.
+void HydraulicErosion::updateWaterAndVelocityCell(int x, int z) {
+    const Parameters& p = parameters;
+    int i = z * width + x;
+
+    float fromLeft = x > 0 ? fluxRight[i - 1] : 0.0f;
+    float fromRight = x < width - 1 ? fluxLeft[i + 1] : 0.0f;
+    float fromTop = z > 0 ? fluxBottom[i - width] : 0.0f;
+    float fromBottom = z < height - 1 ? fluxTop[i + width] : 0.0f;
+
+    float inflow = fromLeft + fromRight + fromTop + fromBottom;
+    float outflow = fluxLeft[i] + fluxRight[i] + fluxTop[i] + fluxBottom[i];
+
+    float depthBefore = water[i] + p.timeStep * p.rainRate;
+    float depthAfter = std::max(0.0f, depthBefore + p.timeStep * (inflow - outflow) / (cellSize * cellSize));
+    float averageDepth = 0.5f * (depthBefore + depthAfter);
+
+    float throughX = 0.5f * (fromLeft - fluxLeft[i] + fluxRight[i] - fromRight);
+    float throughZ = 0.5f * (fromTop - fluxTop[i] + fluxBottom[i] - fromBottom);
+
+    float u = averageDepth > MIN_DEPTH ? throughX / (cellSize * averageDepth) : 0.0f;
+    float v = averageDepth > MIN_DEPTH ? throughZ / (cellSize * averageDepth) : 0.0f;
+
+    water[i] = depthAfter;
+    velocityX[i] = u;
+    velocityZ[i] = v;
+
+    // Local tilt from central differences (one-sided at the border)
+    int xl = std::max(x - 1, 0), xr = std::min(x + 1, width - 1);
+    int zt = std::max(z - 1, 0), zb = std::min(z + 1, height - 1);
+    float gradX = (bedrock[z * width + xr] - bedrock[z * width + xl]) / ((xr - xl) * cellSize);
+    float gradZ = (bedrock[zb * width + x] - bedrock[zt * width + x]) / ((zb - zt) * cellSize);
+    float gradient2 = gradX * gradX + gradZ * gradZ;
+    float sinTilt = std::sqrt(gradient2 / (1.0f + gradient2));
+
+    float speed = std::sqrt(u * u + v * v);
+    float depthFactor = std::min(1.0f, depthAfter / p.erosionDepth);
+    capacity[i] = p.sedimentCapacity * std::max(sinTilt, p.minTilt) * speed * depthFactor;
+}
+
+void HydraulicErosion::updateWaterAndVelocity(int rowBegin, int rowEnd) {
+    for (int z = rowBegin; z < rowEnd; ++z) {
+        if (z == 0 || z == height - 1) {
+            for (int x = 0; x < width; ++x) updateWaterAndVelocityCell(x, z);
+            continue;
+        }
+
+        updateWaterAndVelocityCell(0, z);
+        int x = 1;
+
+#ifdef EROSION_USE_SSE
+        const Parameters& p = parameters;
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 minDepth = _mm_set1_ps(MIN_DEPTH);
+        const __m128 rain = _mm_set1_ps(p.timeStep * p.rainRate);
+        const __m128 volumeToDepth = _mm_set1_ps(p.timeStep / (cellSize * cellSize));
+        const __m128 invCell = _mm_set1_ps(1.0f / cellSize);
+        const __m128 invTwoCells = _mm_set1_ps(0.5f / cellSize);
+        const __m128 capacityScale = _mm_set1_ps(p.sedimentCapacity);
+        const __m128 minTilt = _mm_set1_ps(p.minTilt);
+        const __m128 invErosionDepth = _mm_set1_ps(1.0f / p.erosionDepth);
+
+        const float* b = bedrock.data();
+
+        for (; x + 4 <= width - 1; x += 4) {
+            int i = z * width + x;
+
+            __m128 fL = _mm_loadu_ps(&fluxLeft[i]);
+            __m128 fR = _mm_loadu_ps(&fluxRight[i]);
+            __m128 fT = _mm_loadu_ps(&fluxTop[i]);
+            __m128 fB = _mm_loadu_ps(&fluxBottom[i]);
+            __m128 fromLeft = _mm_loadu_ps(&fluxRight[i - 1]);
+            __m128 fromRight = _mm_loadu_ps(&fluxLeft[i + 1]);
+            __m128 fromTop = _mm_loadu_ps(&fluxBottom[i - width]);
+            __m128 fromBottom = _mm_loadu_ps(&fluxTop[i + width]);
+
+            __m128 inflow = _mm_add_ps(_mm_add_ps(fromLeft, fromRight), _mm_add_ps(fromTop, fromBottom));
+            __m128 outflow = _mm_add_ps(_mm_add_ps(fL, fR), _mm_add_ps(fT, fB));
+
+            __m128 depthBefore = _mm_add_ps(_mm_loadu_ps(&water[i]), rain);
+            __m128 depthAfter = _mm_max_ps(zero, _mm_add_ps(depthBefore, _mm_mul_ps(volumeToDepth, _mm_sub_ps(inflow, outflow))));
+            __m128 averageDepth = _mm_mul_ps(half, _mm_add_ps(depthBefore, depthAfter));
+
+            __m128 throughX = _mm_mul_ps(half, _mm_sub_ps(_mm_add_ps(fromLeft, fR), _mm_add_ps(fL, fromRight)));
+            __m128 throughZ = _mm_mul_ps(half, _mm_sub_ps(_mm_add_ps(fromTop, fB), _mm_add_ps(fT, fromBottom)));
+
+            // Dry cells get zero velocity; the mask also hides the division by a tiny depth
+            __m128 wet = _mm_cmpgt_ps(averageDepth, minDepth);
+            __m128 invDepth = _mm_div_ps(invCell, _mm_max_ps(averageDepth, minDepth));
+            __m128 u = _mm_and_ps(wet, _mm_mul_ps(throughX, invDepth));
+            __m128 v = _mm_and_ps(wet, _mm_mul_ps(throughZ, invDepth));
+
+            _mm_storeu_ps(&water[i], depthAfter);
+            _mm_storeu_ps(&velocityX[i], u);
+            _mm_storeu_ps(&velocityZ[i], v);
+
+            __m128 gradX = _mm_mul_ps(invTwoCells, _mm_sub_ps(_mm_loadu_ps(b + i + 1), _mm_loadu_ps(b + i - 1)));
+            __m128 gradZ = _mm_mul_ps(invTwoCells, _mm_sub_ps(_mm_loadu_ps(b + i + width), _mm_loadu_ps(b + i - width)));
+            __m128 gradient2 = _mm_add_ps(_mm_mul_ps(gradX, gradX), _mm_mul_ps(gradZ, gradZ));
+            __m128 sinTilt = _mm_sqrt_ps(_mm_div_ps(gradient2, _mm_add_ps(one, gradient2)));
+
+            __m128 speed = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(u, u), _mm_mul_ps(v, v)));
+            __m128 depthFactor = _mm_min_ps(one, _mm_mul_ps(depthAfter, invErosionDepth));
+            __m128 cap = _mm_mul_ps(_mm_mul_ps(capacityScale, _mm_max_ps(sinTilt, minTilt)), _mm_mul_ps(speed, depthFactor));
+            _mm_storeu_ps(&capacity[i], cap);
+        }
+#endif
+
+        for (; x < width; ++x) updateWaterAndVelocityCell(x, z);
+    }
+}
+
+// Pass 3: dissolve soil where the flow can carry more than it does, deposit where it carries too much.
+void HydraulicErosion::erodeAndDepositCell(int index) {
+    float difference = capacity[index] - sediment[index];
+    float amount = difference > 0.0f ? parameters.dissolveRate * difference : parameters.depositRate * difference;
+    bedrock[index] -= amount;
+    sediment[index] += amount;
+}
+
+void HydraulicErosion::erodeAndDeposit(int rowBegin, int rowEnd) {
+    // Purely per cell, so the whole tile is one contiguous range
+    int i = rowBegin * width;
+    int end = rowEnd * width;
+
+#ifdef EROSION_USE_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 dissolveRate = _mm_set1_ps(parameters.dissolveRate);
+    const __m128 depositRate = _mm_set1_ps(parameters.depositRate);
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 s = _mm_loadu_ps(&sediment[i]);
+        __m128 difference = _mm_sub_ps(_mm_loadu_ps(&capacity[i]), s);
+        __m128 eroding = _mm_cmpgt_ps(difference, zero);
+        __m128 rate = _mm_or_ps(_mm_and_ps(eroding, dissolveRate), _mm_andnot_ps(eroding, depositRate));
+        __m128 amount = _mm_mul_ps(rate, difference);
+
+        _mm_storeu_ps(&bedrock[i], _mm_sub_ps(_mm_loadu_ps(&bedrock[i]), amount));
+        _mm_storeu_ps(&sediment[i], _mm_add_ps(s, amount));
+    }
+#endif
+
+    for (; i < end; ++i) erodeAndDepositCell(i);
+}
+
+// Pass 4: carry the suspended sediment along the velocity field (semi-Lagrangian) and evaporate.
+void HydraulicErosion::transportSediment(int rowBegin, int rowEnd) {
+    const Parameters& p = parameters;
+    float stepCells = p.timeStep / cellSize;
+    float evaporation = std::max(0.0f, 1.0f - p.evaporationRate * p.timeStep);
+    float maxX = static_cast<float>(width - 1);
+    float maxZ = static_cast<float>(height - 1);
+
+    for (int z = rowBegin; z < rowEnd; ++z) {
+        for (int x = 0; x < width; ++x) {
+            int i = z * width + x;
+
+            float sourceX = glm::clamp(x - velocityX[i] * stepCells, 0.0f, maxX);
+            float sourceZ = glm::clamp(z - velocityZ[i] * stepCells, 0.0f, maxZ);
+
+            int x0 = static_cast<int>(sourceX);
+            int z0 = static_cast<int>(sourceZ);
+            int x1 = std::min(x0 + 1, width - 1);
+            int z1 = std::min(z0 + 1, height - 1);
+            float fx = sourceX - x0;
+            float fz = sourceZ - z0;
+
+            float s0 = glm::mix(sediment[z0 * width + x0], sediment[z0 * width + x1], fx);
+            float s1 = glm::mix(sediment[z1 * width + x0], sediment[z1 * width + x1], fx);
+            sedimentNext[i] = glm::mix(s0, s1, fz);
+
+            water[i] *= evaporation;
+        }
+    }
+}
+
+void HydraulicErosion::applyChanges(Terrain& terrain) const {
+    // Bounding box of the changed cells per band of rows, found in parallel
+    struct Region { int x0, z0, x1, z1; };
+    int bandCount = (height + UPDATE_BAND_ROWS - 1) / UPDATE_BAND_ROWS;
+    std::vector<Region> regions(bandCount, Region{ width, height, 0, 0 });
+    const std::vector<float>& current = terrain.getHeights();
+
+    ThreadPool::getInstance().parallelFor(0, static_cast<size_t>(bandCount), [&](size_t bandBegin, size_t bandEnd) {
+        for (size_t band = bandBegin; band < bandEnd; ++band) {
+            Region& region = regions[band];
+            int zBegin = static_cast<int>(band) * UPDATE_BAND_ROWS;
+            int zEnd = std::min(zBegin + UPDATE_BAND_ROWS, height);
+
+            for (int z = zBegin; z < zEnd; ++z) {
+                for (int x = 0; x < width; ++x) {
+                    int i = z * width + x;
+                    if (std::abs(bedrock[i] - current[i]) > CHANGE_EPSILON) {
+                        region.x0 = std::min(region.x0, x);
+                        region.x1 = std::max(region.x1, x + 1);
+                        region.z0 = std::min(region.z0, z);
+                        region.z1 = std::max(region.z1, z + 1);
+                    }
+                }
+            }
+        }
+    });
+
+    // GL uploads stay on the calling (context) thread
+    int updatedBands = 0;
+    for (const Region& region : regions) {
+        if (region.x0 >= region.x1) continue;
+        terrain.updateHeightRegion(bedrock, region.x0, region.z0, region.x1, region.z1);
+        ++updatedBands;
+    }
+    terrain.finishHeightUpdate();
+
+    std::cout << "INFO: Erosion updated " << updatedBands << " of " << bandCount << " terrain bands." << std::endl;
+}
@@ -0,0 +1,72 @@
+// HydraulicErosion.h
+
+#ifndef HYDRAULIC_EROSION_H
+#define HYDRAULIC_EROSION_H
+
+#include <vector>
+#include "Terrain.h"
+
+// Grid-based hydraulic erosion (virtual-pipe shallow water plus sediment transport) over Terrain heights.
+// Every iteration runs as a sequence of row-tiled passes on the shared ThreadPool; the pass boundaries act
+// as the halo exchange, since each pass only reads neighbour cells written by the previous one.
+class HydraulicErosion {
+public:
+    struct Parameters {
+        float timeStep = 0.02f;          // Simulation step in seconds
+        float rainRate = 0.01f;          // Water added per cell and second
+        float gravity = 9.81f;
+        float pipeArea = 1.0f;           // Cross-section of the virtual pipes between cells
+        float sedimentCapacity = 0.5f;   // Kc: how much sediment moving water can carry
+        float dissolveRate = 0.3f;       // Ks: fraction of the capacity deficit picked up per step
+        float depositRate = 0.3f;        // Kd: fraction of the surplus dropped per step
+        float evaporationRate = 0.02f;   // Ke: fraction of water lost per second
+        float minTilt = 0.05f;           // Keeps flat cells from having zero capacity
+        float erosionDepth = 0.5f;       // Water depth at which capacity reaches its full value
+    };
+
+    HydraulicErosion();
+
+    void setParameters(const Parameters& params);
+    const Parameters& getParameters() const;
+
+    // Runs the given number of iterations and pushes the changed height regions back into the terrain
+    bool run(Terrain& terrain, int iterations);
+
+    // Drops the water and sediment carried over between runs
+    void reset();
+
+    float getLastIterationsPerSecond() const;
+
+private:
+    void initialize(const Terrain& terrain);
+    void computeOutflow(int rowBegin, int rowEnd);
+    void updateWaterAndVelocity(int rowBegin, int rowEnd);
+    void erodeAndDeposit(int rowBegin, int rowEnd);
+    void transportSediment(int rowBegin, int rowEnd);
+    void applyChanges(Terrain& terrain) const;
+
+    void computeOutflowCell(int x, int z);
+    void updateWaterAndVelocityCell(int x, int z);
+    void erodeAndDepositCell(int index);
+
+    Parameters parameters;
+    int width;
+    int height;
+    float cellSize;
+    float lastIterationsPerSecond;
+
+    // Structure-of-arrays state so the inner loops stream through contiguous rows
+    std::vector<float> bedrock;
+    std::vector<float> water;
+    std::vector<float> sediment;
+    std::vector<float> sedimentNext;
+    std::vector<float> capacity;
+    std::vector<float> fluxLeft;
+    std::vector<float> fluxRight;
+    std::vector<float> fluxTop;
+    std::vector<float> fluxBottom;
+    std::vector<float> velocityX;
+    std::vector<float> velocityZ;
+};
+
+#endif // HYDRAULIC_EROSION_H
@@ -0,0 +1,265 @@
+// IsochroneMap.cpp
+
+#include "IsochroneMap.h"
+#include "AnimatedCharacter.h"
+#include "Terrain.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace {
+    constexpr float DEFAULT_BASE_SPEED = 5.0f / 3.6f;  // 5 km/h with world units as metres
+    constexpr float DEFAULT_BAND_INTERVAL = 3600.0f;
+    constexpr int DEFAULT_BAND_COUNT = 3;
+    constexpr int MAX_SWEEPS = 256;                     // Guards against pathological terrain, real grids settle far sooner
+    constexpr float UNREACHED = std::numeric_limits<float>::infinity();
+
+    // Upwind quadrant of the 16-neighbour stencil, mirrored per sweep direction. The four
+    // quadrants share the axis steps and together cover every neighbour and knight move.
+    constexpr int UPWIND_COUNT = 5;
+    constexpr int UPWIND_X[UPWIND_COUNT] = { 1, 0, 1, 1, 2 };
+    constexpr int UPWIND_Z[UPWIND_COUNT] = { 0, 1, 1, 2, 1 };
+}
+
+IsochroneMap::IsochroneMap()
+    : baseSpeed(DEFAULT_BASE_SPEED),
+    bandInterval(DEFAULT_BAND_INTERVAL),
+    bandCount(DEFAULT_BAND_COUNT),
+    width(0),
+    depth(0),
+    cellSize(1.0f),
+    origin(0.0f),
+    blocksX(0),
+    blocksZ(0),
+    timeTexture(0),
+    textureWidth(0),
+    textureDepth(0) {
+}
+
+IsochroneMap::~IsochroneMap() {
+    cleanup();
+}
+
+void IsochroneMap::setBaseSpeed(float speed) {
+    baseSpeed = std::max(speed, 1e-3f);
+}
+
+void IsochroneMap::setBands(float interval, int count) {
+    bandInterval = std::max(interval, 1e-3f);
+    bandCount = std::max(count, 1);
+}
+
+bool IsochroneMap::compute(const Terrain& terrain, const std::vector<glm::vec3>& seeds) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    // Same placement as the terrain mesh, which is centred on the origin
+    width = terrain.getWidth();
+    depth = terrain.getHeight();
+    cellSize = terrain.getHorizontalScale();
+    origin = glm::vec2(-width * cellSize * 0.5f, -depth * cellSize * 0.5f);
+    if (width <= 0 || depth <= 0) return false;
+    heights = terrain.getHeights();
+    times.assign(static_cast<size_t>(width) * depth, UNREACHED);
+
+    blocksX = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    blocksZ = (depth + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    const size_t blockCount = static_cast<size_t>(blocksX) * blocksZ;
+    blockChanged = std::vector<std::atomic<int>>(blockCount);
+    for (auto& changed : blockChanged) changed.store(-1, std::memory_order_relaxed);
+    for (auto& swept : blockSwept) swept.assign(blockCount, 0);
+
+    // Seed blocks count as changed in sweep 0, which pulls them and their neighbours into the first sweep
+    size_t seeded = 0;
+    for (const auto& seed : seeds) {
+        int x = static_cast<int>(std::lround((seed.x - origin.x) / cellSize));
+        int z = static_cast<int>(std::lround((seed.z - origin.y) / cellSize));
+        if (x < 0 || x >= width || z < 0 || z >= depth) continue;
+
+        times[static_cast<size_t>(z) * width + x] = 0.0f;
+        blockChanged[static_cast<size_t>(z / BLOCK_SIZE) * blocksX + x / BLOCK_SIZE].store(0, std::memory_order_relaxed);
+        ++seeded;
+    }
+    if (seeded == 0) {
+        std::cerr << "ERROR: No isochrone seed lies on the terrain." << std::endl;
+        return false;
+    }
+
+    // Cycle through the four sweep orders until four in a row leave every time unchanged
+    ThreadPool& pool = ThreadPool::getInstance();
+    std::atomic<size_t> blocksSwept(0);
+    int sweep = 0;
+    int quietSweeps = 0;
+
+    while (quietSweeps < 4 && sweep < MAX_SWEEPS) {
+        const int direction = sweep % 4;
+        const int stepX = (direction & 1) ? -1 : 1;
+        const int stepZ = (direction & 2) ? -1 : 1;
+        std::atomic<bool> changed(false);
+
+        // Blocks on one anti-diagonal, counted in sweep order, only read blocks of earlier diagonals
+        for (int wave = 0; wave < blocksX + blocksZ - 1; ++wave) {
+            const int first = std::max(0, wave - (blocksZ - 1));
+            const int last = std::min(wave, blocksX - 1);
+
+            pool.parallelFor(static_cast<size_t>(first), static_cast<size_t>(last) + 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    int orderX = static_cast<int>(i);
+                    int orderZ = wave - orderX;
+                    int blockX = stepX > 0 ? orderX : blocksX - 1 - orderX;
+                    int blockZ = stepZ > 0 ? orderZ : blocksZ - 1 - orderZ;
+                    if (!needsSweep(blockX, blockZ, direction)) continue;
+
+                    size_t block = static_cast<size_t>(blockZ) * blocksX + blockX;
+                    blockSwept[direction][block] = sweep;
+                    blocksSwept.fetch_add(1, std::memory_order_relaxed);
+
+                    if (sweepBlock(blockX, blockZ, stepX, stepZ)) {
+                        blockChanged[block].store(sweep, std::memory_order_relaxed);
+                        changed.store(true, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+
+        quietSweeps = changed.load() ? 0 : quietSweeps + 1;
+        ++sweep;
+    }
+
+    size_t reached = std::count_if(times.begin(), times.end(), [](float t) { return t != UNREACHED; });
+    upload();
+
+    double milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    std::cout << "INFO: Isochrones: " << seeded << " seed(s), " << sweep << " sweeps, "
+        << blocksSwept.load() << " of " << sweep * blockCount << " block sweeps run, "
+        << reached << " of " << times.size() << " vertices reached in " << milliseconds << " ms." << std::endl;
+    if (sweep >= MAX_SWEEPS) {
+        std::cerr << "ERROR: Isochrone sweeps stopped before converging." << std::endl;
+    }
+    return true;
+}
+
+bool IsochroneMap::needsSweep(int blockX, int blockZ, int direction) const {
+    // The stencil reaches two vertices, so only this block and its eight neighbours can feed it.
+    // If none changed since this block's last sweep in the same order, sweeping again is a no-op.
+    const int lastSwept = blockSwept[direction][static_cast<size_t>(blockZ) * blocksX + blockX];
+
+    for (int z = std::max(blockZ - 1, 0); z <= std::min(blockZ + 1, blocksZ - 1); ++z) {
+        for (int x = std::max(blockX - 1, 0); x <= std::min(blockX + 1, blocksX - 1); ++x) {
+            if (blockChanged[static_cast<size_t>(z) * blocksX + x].load(std::memory_order_relaxed) >= lastSwept) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool IsochroneMap::sweepBlock(int blockX, int blockZ, int stepX, int stepZ) {
+    // Per-step run lengths of the upwind quadrant
+    float runs[UPWIND_COUNT];
+    float inverseRuns[UPWIND_COUNT];
+    for (int k = 0; k < UPWIND_COUNT; ++k) {
+        runs[k] = cellSize * std::sqrt(static_cast<float>(UPWIND_X[k] * UPWIND_X[k] + UPWIND_Z[k] * UPWIND_Z[k]));
+        inverseRuns[k] = 1.0f / runs[k];
+    }
+
+    const int x0 = blockX * BLOCK_SIZE;
+    const int z0 = blockZ * BLOCK_SIZE;
+    const int x1 = std::min(x0 + BLOCK_SIZE, width);
+    const int z1 = std::min(z0 + BLOCK_SIZE, depth);
+    bool changed = false;
+
+    // Gauss-Seidel order: every upwind vertex inside the block is updated before it is read
+    for (int row = 0; row < z1 - z0; ++row) {
+        const int z = stepZ > 0 ? z0 + row : z1 - 1 - row;
+
+        for (int column = 0; column < x1 - x0; ++column) {
+            const int x = stepX > 0 ? x0 + column : x1 - 1 - column;
+            const size_t index = static_cast<size_t>(z) * width + x;
+            const float height = heights[index];
+            float best = times[index];
+
+            for (int k = 0; k < UPWIND_COUNT; ++k) {
+                const int fromX = x - stepX * UPWIND_X[k];
+                const int fromZ = z - stepZ * UPWIND_Z[k];
+                if (fromX < 0 || fromX >= width || fromZ < 0 || fromZ >= depth) continue;
+
+                // Steps cost time, so a neighbour that is already no earlier cannot help
+                const size_t from = static_cast<size_t>(fromZ) * width + fromX;
+                const float fromTime = times[from];
+                if (fromTime >= best) continue;
+
+                // The step is walked from the neighbour towards this vertex, so its rise decides the speed
+                float slope = (height - heights[from]) * inverseRuns[k];
+                float candidate = fromTime + runs[k] / (baseSpeed * AnimatedCharacter::slopeSpeedMultiplier(slope));
+                best = std::min(best, candidate);
+            }
+
+            if (best < times[index]) {
+                times[index] = best;
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+float IsochroneMap::getTimeAt(const glm::vec3& position) const {
+    if (times.empty()) return UNREACHED;
+
+    int x = std::clamp(static_cast<int>(std::lround((position.x - origin.x) / cellSize)), 0, width - 1);
+    int z = std::clamp(static_cast<int>(std::lround((position.z - origin.y) / cellSize)), 0, depth - 1);
+    return times[static_cast<size_t>(z) * width + x];
+}
+
+const std::vector<float>& IsochroneMap::getTimes() const {
+    return times;
+}
+
+void IsochroneMap::upload() {
+    // One texel per grid vertex, like the splat weights; unreached vertices keep their infinity,
+    // which the shader's band test rejects
+    if (timeTexture != 0 && (textureWidth != width || textureDepth != depth)) {
+        glDeleteTextures(1, &timeTexture);
+        timeTexture = 0;
+    }
+
+    if (timeTexture == 0) {
+        glGenTextures(1, &timeTexture);
+        glBindTexture(GL_TEXTURE_2D, timeTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, depth, 0, GL_RED, GL_FLOAT, times.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        textureWidth = width;
+        textureDepth = depth;
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, timeTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, depth, GL_RED, GL_FLOAT, times.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void IsochroneMap::apply(Shader& shader, int textureUnit, bool enabled) const {
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_2D, timeTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.setInt("isochroneMap", textureUnit);
+    shader.setInt("useIsochrones", enabled && timeTexture != 0 ? 1 : 0);
+    shader.setFloat("isochroneInterval", bandInterval);
+    shader.setInt("isochroneBandCount", bandCount);
+}
+
+void IsochroneMap::cleanup() {
+    if (timeTexture) glDeleteTextures(1, &timeTexture);
+    timeTexture = 0;
+    textureWidth = 0;
+    textureDepth = 0;
+}
@@ -0,0 +1,76 @@
+// IsochroneMap.h
+
+#ifndef ISOCHRONE_MAP_H
+#define ISOCHRONE_MAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <atomic>
+#include <vector>
+#include "Shader.h"
+
+class Terrain;
+
+// Walking time from a set of seed points to every terrain vertex, shaded on the terrain as bands
+// of equal time. Times come from a fast-sweeping solver on the 16-neighbour grid stencil: each of
+// the four sweep orders relaxes a vertex from its upwind quadrant, and the cost of a step is its run
+// at the character's slope-dependent speed for that step's own rise, so uphill and downhill differ.
+// A sweep runs over 32x32 blocks in anti-diagonal waves; blocks on one wave never read each other,
+// so they go to the thread pool, and blocks whose neighbourhood is unchanged are skipped.
+class IsochroneMap {
+public:
+    IsochroneMap();
+    ~IsochroneMap();
+
+    // Speed on level ground in world units per second, scaled by AnimatedCharacter::slopeSpeedMultiplier
+    void setBaseSpeed(float speed);
+
+    // Shading covers count bands of interval seconds each, e.g. 3 bands of 3600 for 1h/2h/3h
+    void setBands(float interval, int count);
+
+    // Solves from the seeds, which snap to the closest grid vertex, and uploads the time texture.
+    // Must run on the GL thread; returns false when no seed lies on the terrain.
+    bool compute(const Terrain& terrain, const std::vector<glm::vec3>& seeds);
+
+    // Seconds from the closest seed to the grid vertex closest to the position, infinity if unreached
+    float getTimeAt(const glm::vec3& position) const;
+    const std::vector<float>& getTimes() const;
+
+    // Binds the time texture to textureUnit and sets the isochrone uniforms; the shader must be in use
+    void apply(Shader& shader, int textureUnit, bool enabled) const;
+
+    void cleanup();
+
+private:
+    static constexpr int BLOCK_SIZE = 32;
+
+    // Relaxes one block in the sweep order (stepX, stepZ); returns whether any time decreased
+    bool sweepBlock(int blockX, int blockZ, int stepX, int stepZ);
+    bool needsSweep(int blockX, int blockZ, int direction) const;
+    void upload();
+
+    float baseSpeed;
+    float bandInterval;
+    int bandCount;
+
+    // Grid copied from the terrain at the last compute
+    std::vector<float> heights;
+    std::vector<float> times;
+    int width;
+    int depth;
+    float cellSize;
+    glm::vec2 origin;
+
+    // Block bookkeeping: the sweep in which each block last changed, and in which it was last swept
+    // in each of the four directions. Changes are written while neighbouring blocks are read.
+    int blocksX;
+    int blocksZ;
+    std::vector<std::atomic<int>> blockChanged;
+    std::vector<int> blockSwept[4];
+
+    GLuint timeTexture;
+    int textureWidth;
+    int textureDepth;
+};
+
+#endif // ISOCHRONE_MAP_H
@@ -17,6 +17,8 @@ public:
     // Inline getters
     glm::vec3 getPosition() const { return position; }
     glm::vec3 getColor() const { return color; }
+    // Direction towards the light, treating it as a sun infinitely far away
+    glm::vec3 getDirection() const { return glm::normalize(position); }
 
     // Shader application
     void apply(Shader& shader) const;
@@ -35,7 +35,7 @@ void ParticleSystem::init() {
     glBindVertexArray(0);
 }
 
-void ParticleSystem::update(float deltaTime, const glm::vec3& cameraPos, const Terrain& terrain) {
+void ParticleSystem::update(float deltaTime, const glm::vec3& cameraPos, const HeightSource& terrain) {
     // Add new particles
     unsigned int newParticles = maxParticles / 20; // Determine the number of new particles to spawn (5% of maxParticles)
     for (unsigned int i = 0; i < newParticles; ++i) {
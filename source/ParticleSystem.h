@@ -6,13 +6,13 @@
 #include <vector>
 #include "Particle.h"
 #include "Shader.h"
-#include "Terrain.h" // Assuming you have a Terrain class
+#include "HeightSource.h"
 
 class ParticleSystem {
 public:
     ParticleSystem(unsigned int maxParticles);
 
-    void update(float deltaTime, const glm::vec3& cameraPos, const Terrain& terrain);
+    void update(float deltaTime, const glm::vec3& cameraPos, const HeightSource& terrain);
     void render(const glm::mat4& view, const glm::mat4& projection);
 
     void cleanup();
@@ -0,0 +1,90 @@
+// PathData.cpp
+
+#include "PathData.h"
+#include <cfloat>
+#include <iostream>
+#include <utility>
+
+PathData::PathData()
+    : boundsMin(glm::vec3(0.0f)), boundsMax(glm::vec3(0.0f)) {
+}
+
+PathData::~PathData() {
+    renderer.cleanup();
+}
+
+PathData::Ptr PathData::create(std::vector<glm::vec3> points, const std::vector<double>& times) {
+    // The constructor is private, so no make_shared
+    std::shared_ptr<PathData> data(new PathData());
+
+    data->arcLength.build(std::move(points));
+    const std::vector<glm::vec3>& stored = data->arcLength.getPoints();
+    if (stored.empty()) return data;
+
+    data->boundsMin = glm::vec3(FLT_MAX);
+    data->boundsMax = glm::vec3(-FLT_MAX);
+    for (const auto& point : stored) {
+        data->boundsMin = glm::min(data->boundsMin, point);
+        data->boundsMax = glm::max(data->boundsMax, point);
+    }
+
+    data->stats.compute(stored);
+    std::cout << "INFO: Route: " << RouteStats::format(data->stats.getSummary()) << std::endl;
+
+    data->timeTable.build(times, data->arcLength);
+    if (!data->timeTable.isEmpty()) {
+        std::cout << "INFO: Recorded pace: " << data->timeTable.getDuration() / 60.0 << " min over the route." << std::endl;
+    }
+
+    // Rank the vertices once; every level's indices go into one index list
+    data->hierarchy = PathSimplifier::buildHierarchy(stored);
+    if (!data->hierarchy.levels.empty()) {
+        std::cout << "INFO: Path simplification: " << data->hierarchy.levels.size() << " levels, "
+            << stored.size() << " to " << data->hierarchy.levels.back().count << " vertices." << std::endl;
+    }
+
+    // Points and levels go to buffer textures that the polyline shader expands into thick segments
+    data->renderer.setPoints(stored.data(), stored.size());
+    data->renderer.setIndices(data->hierarchy.indices.data(), data->hierarchy.indices.size());
+    return data;
+}
+
+bool PathData::isEmpty() const {
+    return arcLength.isEmpty();
+}
+
+size_t PathData::getPointCount() const {
+    return arcLength.getPointCount();
+}
+
+const std::vector<glm::vec3>& PathData::getPoints() const {
+    return arcLength.getPoints();
+}
+
+const ArcLengthTable& PathData::getArcLength() const {
+    return arcLength;
+}
+
+const PathSimplifier::Hierarchy& PathData::getHierarchy() const {
+    return hierarchy;
+}
+
+const RouteStats& PathData::getStats() const {
+    return stats;
+}
+
+const TimeTable& PathData::getTimeTable() const {
+    return timeTable;
+}
+
+const PolylineRenderer& PathData::getRenderer() const {
+    return renderer;
+}
+
+glm::vec3 PathData::getBoundsMin() const {
+    return boundsMin;
+}
+
+glm::vec3 PathData::getBoundsMax() const {
+    return boundsMax;
+}
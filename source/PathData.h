@@ -0,0 +1,57 @@
+// PathData.h
+
+#ifndef PATH_DATA_H
+#define PATH_DATA_H
+
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ArcLengthTable.h"
+#include "PathSimplifier.h"
+#include "PolylineRenderer.h"
+#include "RouteStats.h"
+#include "TimeTable.h"
+
+// Everything derived from one loaded path: the points, their cumulative distances, simplification
+// levels, route statistics and the GPU buffers the polyline shader reads. It is built once and never
+// changed afterwards, so the hiker, the animated character and any query structure share a single
+// copy through shared pointers, and loading a new path swaps one pointer instead of rewriting data.
+// The GPU buffers are released with the last reference, which has to be dropped on the GL thread.
+class PathData {
+public:
+    using Ptr = std::shared_ptr<const PathData>;
+
+    // Takes the draped points over; must run on the GL thread because it uploads the buffers.
+    // times, if given, holds the recorded timestamp of each point in seconds.
+    static Ptr create(std::vector<glm::vec3> points, const std::vector<double>& times = {});
+
+    ~PathData();
+    PathData(const PathData&) = delete;
+    PathData& operator=(const PathData&) = delete;
+
+    bool isEmpty() const;
+    size_t getPointCount() const;
+    const std::vector<glm::vec3>& getPoints() const;
+
+    const ArcLengthTable& getArcLength() const;
+    const PathSimplifier::Hierarchy& getHierarchy() const;
+    const RouteStats& getStats() const;
+    const TimeTable& getTimeTable() const;        // Empty unless the path was recorded with timestamps
+    const PolylineRenderer& getRenderer() const;  // Points plus every simplification level's indices
+
+    glm::vec3 getBoundsMin() const;
+    glm::vec3 getBoundsMax() const;
+
+private:
+    PathData();
+
+    ArcLengthTable arcLength;  // Owns the points, the only CPU copy of them
+    PathSimplifier::Hierarchy hierarchy;
+    RouteStats stats;
+    TimeTable timeTable;
+    PolylineRenderer renderer;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+};
+
+#endif // PATH_DATA_H
@@ -0,0 +1,255 @@
+// PathLoader.cpp
+
+#include "PathLoader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    constexpr size_t PARALLEL_THRESHOLD_BYTES = 1 << 20;  // Smaller files are parsed on the calling thread
+    constexpr size_t MIN_CHUNK_BYTES = 256 << 10;
+
+    inline const char* skipBlanks(const char* cursor, const char* end) {
+        while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == ',')) ++cursor;
+        return cursor;
+    }
+
+    // from_chars rejects a leading '+', which some exporters write, but accepts "nan" and "inf",
+    // which would reach draping, RouteStats and the GPU as coordinates
+    inline const char* parseFloat(const char* cursor, const char* end, float& value) {
+        if (cursor < end && *cursor == '+') ++cursor;
+        auto result = std::from_chars(cursor, end, value);
+        return result.ec == std::errc() && std::isfinite(value) ? result.ptr : nullptr;
+    }
+
+    void logResult(const char* loaderName, const std::string& path, const PathLoader::Result& result, size_t pointCount) {
+        double megabytes = static_cast<double>(result.bytes) / (1024.0 * 1024.0);
+        double throughput = result.seconds > 0.0 ? megabytes / result.seconds : 0.0;
+
+        std::cout << "INFO: " << loaderName << " loaded " << pointCount << " path points from " << path
+            << " in " << result.seconds * 1000.0 << " ms (" << throughput << " MB/s)." << std::endl;
+    }
+}
+
+void PathLoader::parseChunk(const char* data, Chunk& chunk, glm::vec3* output) {
+    const char* cursor = data + chunk.begin;
+    const char* chunkEnd = data + chunk.end;
+    size_t line = chunk.firstLine;
+
+    while (cursor < chunkEnd) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', chunkEnd - cursor));
+        if (lineEnd == nullptr) lineEnd = chunkEnd;
+
+        // Tolerate Windows line endings
+        const char* contentEnd = lineEnd;
+        if (contentEnd > cursor && contentEnd[-1] == '\r') --contentEnd;
+
+        const char* field = skipBlanks(cursor, contentEnd);
+        if (field < contentEnd && *field != '#') {
+            glm::vec3 point;
+            bool valid = true;
+
+            for (int axis = 0; axis < 3 && valid; ++axis) {
+                field = parseFloat(skipBlanks(field, contentEnd), contentEnd, point[axis]);
+                valid = field != nullptr;
+            }
+
+            // Trailing garbage makes the line malformed as well
+            if (valid && skipBlanks(field, contentEnd) != contentEnd) valid = false;
+
+            if (valid) {
+                output[chunk.outputOffset + chunk.parsedCount++] = point;
+            }
+            else {
+                ++chunk.malformedCount;
+                if (chunk.malformedLines.size() < MAX_REPORTED_LINES) {
+                    chunk.malformedLines.push_back(line + 1);
+                }
+            }
+        }
+
+        cursor = lineEnd + 1;
+        ++line;
+    }
+}
+
+PathLoader::Result PathLoader::load(const std::string& path, std::vector<glm::vec3>& points) {
+    Result result;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    points.clear();
+
+    MappedFile file;
+    if (!file.open(path)) {
+        return result;
+    }
+
+    const char* data = file.data();
+    const size_t size = file.size();
+    result.bytes = size;
+
+    // Split at line boundaries; every chunk but the last ends right after a newline
+    std::vector<Chunk> chunks;
+    size_t chunkCount = 1;
+    if (size >= PARALLEL_THRESHOLD_BYTES) {
+        size_t byWorkers = static_cast<size_t>(ThreadPool::getInstance().getThreadCount()) * 4;
+        chunkCount = std::max<size_t>(1, std::min(byWorkers, size / MIN_CHUNK_BYTES));
+    }
+
+    size_t chunkBegin = 0;
+    for (size_t i = 1; i <= chunkCount && chunkBegin < size; ++i) {
+        size_t chunkEnd = size;
+        if (i < chunkCount) {
+            chunkEnd = std::max(chunkBegin, size * i / chunkCount);
+            const void* newline = std::memchr(data + chunkEnd, '\n', size - chunkEnd);
+            chunkEnd = newline ? static_cast<size_t>(static_cast<const char*>(newline) - data) + 1 : size;
+        }
+
+        Chunk chunk;
+        chunk.begin = chunkBegin;
+        chunk.end = chunkEnd;
+        chunks.push_back(chunk);
+        chunkBegin = chunkEnd;
+    }
+
+    // Pass 1: count lines per chunk, which bounds the points each chunk can produce
+    ThreadPool& pool = ThreadPool::getInstance();
+    pool.parallelFor(0, chunks.size(), [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            Chunk& chunk = chunks[i];
+            chunk.lineCount = static_cast<size_t>(std::count(data + chunk.begin, data + chunk.end, '\n'));
+            if (chunk.end > chunk.begin && data[chunk.end - 1] != '\n') ++chunk.lineCount;
+        }
+    });
+
+    size_t totalLines = 0;
+    for (auto& chunk : chunks) {
+        chunk.firstLine = totalLines;
+        chunk.outputOffset = totalLines;
+        totalLines += chunk.lineCount;
+    }
+    result.lineCount = totalLines;
+
+    // Pass 2: parse every chunk straight into its slice of the presized buffer
+    points.resize(totalLines);
+    glm::vec3* output = points.data();
+    pool.parallelFor(0, chunks.size(), [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            parseChunk(data, chunks[i], output);
+        }
+    });
+
+    // Pass 3: close the gaps left by blank, comment and malformed lines
+    size_t written = 0;
+    for (const auto& chunk : chunks) {
+        if (chunk.outputOffset != written) {
+            std::copy(points.begin() + chunk.outputOffset, points.begin() + chunk.outputOffset + chunk.parsedCount,
+                points.begin() + written);
+        }
+        written += chunk.parsedCount;
+
+        result.malformedLineCount += chunk.malformedCount;
+        for (size_t line : chunk.malformedLines) {
+            if (result.malformedLines.size() < MAX_REPORTED_LINES) result.malformedLines.push_back(line);
+        }
+    }
+    points.resize(written);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.success = true;
+
+    if (result.malformedLineCount > 0) {
+        std::cerr << "ERROR: " << result.malformedLineCount << " malformed line(s) in " << path << ", first at line(s):";
+        for (size_t line : result.malformedLines) {
+            std::cerr << " " << line;
+        }
+        std::cerr << std::endl;
+    }
+
+    return result;
+}
+
+size_t PathLoader::parseLines(const char* data, size_t size, std::vector<glm::vec3>& points, size_t* malformedCount) {
+    const char* lastNewline = nullptr;
+    for (size_t i = size; i > 0; --i) {
+        if (data[i - 1] == '\n') {
+            lastNewline = data + i - 1;
+            break;
+        }
+    }
+    if (lastNewline == nullptr) return 0;
+
+    Chunk chunk;
+    chunk.end = static_cast<size_t>(lastNewline - data) + 1;
+    chunk.lineCount = static_cast<size_t>(std::count(data, data + chunk.end, '\n'));
+    chunk.outputOffset = points.size();
+
+    points.resize(points.size() + chunk.lineCount);
+    parseChunk(data, chunk, points.data());
+    points.resize(chunk.outputOffset + chunk.parsedCount);
+
+    if (malformedCount) *malformedCount += chunk.malformedCount;
+    return chunk.end;
+}
+
+PathLoader::Result PathLoader::loadWithStream(const std::string& path, std::vector<glm::vec3>& points) {
+    Result result;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    points.clear();
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Failed to open path file: " << path << std::endl;
+        return result;
+    }
+    result.bytes = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+
+    float x, y, z;
+    while (file >> x >> y >> z) {
+        points.emplace_back(x, y, z);
+    }
+
+    // The stream stops at the first bad token, so only count what it actually consumed
+    file.clear();
+    std::streamoff consumed = file.tellg();
+    if (consumed >= 0) result.bytes = static_cast<size_t>(consumed);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.lineCount = points.size();
+    result.success = true;
+    return result;
+}
+
+void PathLoader::benchmark(const std::string& path) {
+    std::vector<glm::vec3> streamPoints;
+    std::vector<glm::vec3> mappedPoints;
+
+    Result streamResult = loadWithStream(path, streamPoints);
+    Result mappedResult = load(path, mappedPoints);
+
+    if (!streamResult.success || !mappedResult.success) {
+        std::cerr << "ERROR: Path loader benchmark could not read " << path << std::endl;
+        return;
+    }
+
+    logResult("ifstream loader", path, streamResult, streamPoints.size());
+    logResult("Mapped loader", path, mappedResult, mappedPoints.size());
+
+    if (streamPoints.size() != mappedPoints.size()) {
+        std::cerr << "ERROR: Path loaders disagree on point count (" << streamPoints.size()
+            << " vs " << mappedPoints.size() << ")." << std::endl;
+    }
+    else if (mappedResult.seconds > 0.0) {
+        std::cout << "INFO: Mapped loader speedup: " << streamResult.seconds / mappedResult.seconds << "x" << std::endl;
+    }
+}
@@ -0,0 +1,57 @@
+// PathLoader.h
+
+#ifndef PATH_LOADER_H
+#define PATH_LOADER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Loads "x y z" path files. The file is memory-mapped and parsed in place with std::from_chars,
+// which is locale-independent and allocation-free; large files are split at line boundaries and
+// parsed on the ThreadPool straight into one presized point buffer.
+class PathLoader {
+public:
+    struct Result {
+        bool success = false;
+        size_t lineCount = 0;
+        size_t malformedLineCount = 0;
+        std::vector<size_t> malformedLines; // 1-based line numbers, capped at MAX_REPORTED_LINES
+        size_t bytes = 0;
+        double seconds = 0.0;
+    };
+
+    static constexpr size_t MAX_REPORTED_LINES = 16;
+
+    // One point per line: blank lines and lines starting with '#' are skipped, anything else must hold
+    // exactly three finite numbers. Unlike loadWithStream, a point may not span lines or share one.
+    static Result load(const std::string& path, std::vector<glm::vec3>& points);
+
+    // Parses the complete lines of data[0, size) onto the end of points and returns the bytes they
+    // span, so a line still being written stays for the next call. Runs on the calling thread, for
+    // the few lines a logger appends at a time.
+    static size_t parseLines(const char* data, size_t size, std::vector<glm::vec3>& points, size_t* malformedCount = nullptr);
+
+    // The previous ifstream loader, kept as the baseline for benchmark()
+    static Result loadWithStream(const std::string& path, std::vector<glm::vec3>& points);
+
+    // Loads the file with both loaders and logs their throughput in MB/s
+    static void benchmark(const std::string& path);
+
+private:
+    struct Chunk {
+        size_t begin = 0;        // Byte range, starts at a line start and ends after a newline
+        size_t end = 0;
+        size_t firstLine = 0;    // 0-based line number of the first line in the chunk
+        size_t lineCount = 0;
+        size_t outputOffset = 0; // First slot of the presized buffer owned by this chunk
+        size_t parsedCount = 0;
+        size_t malformedCount = 0;
+        std::vector<size_t> malformedLines;
+    };
+
+    static void parseChunk(const char* data, Chunk& chunk, glm::vec3* output);
+};
+
+#endif // PATH_LOADER_H
@@ -0,0 +1,92 @@
+// PathResampler.cpp
+
+#include "PathResampler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    inline float horizontalDistance(const glm::vec3& a, const glm::vec3& b) {
+        return glm::length(glm::vec2(b.x - a.x, b.z - a.z));
+    }
+
+    // Angle between the incoming and outgoing XZ directions at points[i]
+    float turnAngle(const std::vector<glm::vec3>& points, size_t i) {
+        if (i == 0 || i + 1 >= points.size()) return 0.0f;
+
+        glm::vec2 incoming(points[i].x - points[i - 1].x, points[i].z - points[i - 1].z);
+        glm::vec2 outgoing(points[i + 1].x - points[i].x, points[i + 1].z - points[i].z);
+        float lengths = glm::length(incoming) * glm::length(outgoing);
+        if (lengths <= 1e-12f) return 0.0f;
+
+        return std::acos(glm::clamp(glm::dot(incoming, outgoing) / lengths, -1.0f, 1.0f));
+    }
+}
+
+std::vector<glm::vec3> PathResampler::resample(const std::vector<glm::vec3>& points, const Options& options,
+    std::vector<float>* sourceParameters) {
+    std::vector<glm::vec3> output;
+    if (sourceParameters) sourceParameters->clear();
+    if (points.empty()) return output;
+
+    const float spacing = std::max(options.spacing, 1e-4f);
+    const float minSpacing = glm::clamp(options.minSpacing, 1e-4f, spacing);
+
+    // Reserve for the straight case; refinement around turns may add a few more
+    float totalLength = 0.0f;
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+        totalLength += horizontalDistance(points[i], points[i + 1]);
+    }
+    output.reserve(static_cast<size_t>(totalLength / spacing) + 2);
+    if (sourceParameters) sourceParameters->reserve(output.capacity());
+
+    auto emit = [&](const glm::vec3& point, float parameter) {
+        output.push_back(point);
+        if (sourceParameters) sourceParameters->push_back(parameter);
+    };
+
+    emit(points.front(), 0.0f);
+    if (points.size() == 1) return output;
+
+    // offset is how far into the current segment the next sample falls
+    float offset = spacing;
+    float previousTurn = 0.0f;
+
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+        const glm::vec3& start = points[i];
+        const glm::vec3& end = points[i + 1];
+        float length = horizontalDistance(start, end);
+
+        float step = spacing;
+        if (options.curvatureAdaptive) {
+            // The sharper turn at either end of the segment sets its spacing
+            float nextTurn = turnAngle(points, i + 1);
+            float refinement = glm::clamp(std::max(previousTurn, nextTurn) / options.fullRefinementAngle, 0.0f, 1.0f);
+            step = glm::mix(spacing, minSpacing, refinement);
+            previousTurn = nextTurn;
+
+            // A tighter segment starts sampling sooner, never later than one spacing
+            offset = std::min(offset, step);
+        }
+
+        if (length <= 1e-6f) continue;
+
+        while (offset < length) {
+            float t = offset / length;
+            emit(glm::mix(start, end, t), static_cast<float>(i) + t);
+            offset += step;
+        }
+        offset -= length;
+    }
+
+    // Always finish exactly on the last input point
+    const glm::vec3& last = points.back();
+    if (output.size() == 1 || horizontalDistance(output.back(), last) > minSpacing * 0.1f) {
+        emit(last, static_cast<float>(points.size() - 1));
+    }
+    else {
+        output.back() = last;
+        if (sourceParameters) sourceParameters->back() = static_cast<float>(points.size() - 1);
+    }
+
+    return output;
+}
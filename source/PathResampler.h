@@ -0,0 +1,27 @@
+// PathResampler.h
+
+#ifndef PATH_RESAMPLER_H
+#define PATH_RESAMPLER_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+// Resamples a polyline at a fixed world-space spacing measured in the XZ plane, so the output
+// size follows the trail length instead of the number of recorded points. Optionally the spacing
+// shrinks around sharp turns. Y is interpolated from the input; drape the result afterwards.
+class PathResampler {
+public:
+    struct Options {
+        float spacing = 1.0f;             // Distance between output points on straight stretches
+        bool curvatureAdaptive = false;   // Shrink the spacing towards minSpacing around turns
+        float minSpacing = 0.25f;
+        float fullRefinementAngle = 0.785398f; // Turn angle (radians) at which minSpacing is reached
+    };
+
+    // sourceParameters, if given, receives for each output point the fractional input index it came
+    // from (segment index + position along the segment), for interpolating per-point input data.
+    static std::vector<glm::vec3> resample(const std::vector<glm::vec3>& points, const Options& options,
+        std::vector<float>* sourceParameters = nullptr);
+};
+
+#endif // PATH_RESAMPLER_H
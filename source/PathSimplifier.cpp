@@ -0,0 +1,119 @@
+// PathSimplifier.cpp
+
+#include "PathSimplifier.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace {
+    float distanceToSegment(const glm::vec3& point, const glm::vec3& start, const glm::vec3& end) {
+        glm::vec3 segment = end - start;
+        float lengthSquared = glm::dot(segment, segment);
+        if (lengthSquared <= 0.0f) return glm::length(point - start);
+
+        float t = glm::clamp(glm::dot(point - start, segment) / lengthSquared, 0.0f, 1.0f);
+        return glm::length(point - (start + segment * t));
+    }
+}
+
+std::vector<float> PathSimplifier::computeImportance(const std::vector<glm::vec3>& points) {
+    const size_t count = points.size();
+    std::vector<float> importance(count, 0.0f);
+    if (count == 0) return importance;
+
+    importance.front() = std::numeric_limits<float>::infinity();
+    importance.back() = std::numeric_limits<float>::infinity();
+    if (count < 3) return importance;
+
+    // Iterative Douglas-Peucker. A vertex never outranks the split that created its range,
+    // which keeps the importance monotonic: every level is a subset of the finer ones.
+    struct Range {
+        size_t first;
+        size_t last;
+        float parentImportance;
+    };
+
+    std::vector<Range> stack;
+    stack.push_back({ 0, count - 1, std::numeric_limits<float>::infinity() });
+
+    while (!stack.empty()) {
+        Range range = stack.back();
+        stack.pop_back();
+        if (range.last - range.first < 2) continue;
+
+        float maxDistance = -1.0f;
+        size_t split = range.first + 1;
+        for (size_t i = range.first + 1; i < range.last; ++i) {
+            float distance = distanceToSegment(points[i], points[range.first], points[range.last]);
+            if (distance > maxDistance) {
+                maxDistance = distance;
+                split = i;
+            }
+        }
+
+        float rank = std::min(maxDistance, range.parentImportance);
+        importance[split] = rank;
+        stack.push_back({ range.first, split, rank });
+        stack.push_back({ split, range.last, rank });
+    }
+
+    return importance;
+}
+
+PathSimplifier::Hierarchy PathSimplifier::buildHierarchy(const std::vector<glm::vec3>& points, int maxLevels) {
+    Hierarchy hierarchy;
+    const size_t count = points.size();
+    if (count == 0) return hierarchy;
+
+    std::vector<float> importance = computeImportance(points);
+
+    // Start the ladder at a small fraction of the average segment length
+    float totalLength = 0.0f;
+    for (size_t i = 0; i + 1 < count; ++i) {
+        totalLength += glm::length(points[i + 1] - points[i]);
+    }
+    float baseTolerance = count > 1 ? totalLength / static_cast<float>(count - 1) * 0.05f : 1.0f;
+    if (baseTolerance <= 0.0f) baseTolerance = 1e-3f;
+
+    // Level 0 is the full path
+    hierarchy.indices.reserve(count * 2);
+    for (size_t i = 0; i < count; ++i) {
+        hierarchy.indices.push_back(static_cast<unsigned int>(i));
+    }
+    hierarchy.levels.push_back({ 0.0f, 0, count });
+
+    float tolerance = baseTolerance;
+    for (int level = 1; level < maxLevels; ++level, tolerance *= 2.0f) {
+        size_t offset = hierarchy.indices.size();
+        for (size_t i = 0; i < count; ++i) {
+            if (importance[i] >= tolerance) {
+                hierarchy.indices.push_back(static_cast<unsigned int>(i));
+            }
+        }
+
+        size_t levelCount = hierarchy.indices.size() - offset;
+
+        // Skip levels that remove nothing, stop once only the end points are left
+        if (levelCount == hierarchy.levels.back().count) {
+            hierarchy.indices.resize(offset);
+            continue;
+        }
+        hierarchy.levels.push_back({ tolerance, offset, levelCount });
+        if (levelCount <= 2) break;
+    }
+
+    return hierarchy;
+}
+
+const PathSimplifier::Level& PathSimplifier::selectLevel(const Hierarchy& hierarchy, float maxTolerance) {
+    // An empty path has no levels; its stand-in draws nothing
+    static const Level emptyLevel{ 0.0f, 0, 0 };
+    if (hierarchy.levels.empty()) return emptyLevel;
+
+    size_t selected = 0;
+    for (size_t i = 1; i < hierarchy.levels.size(); ++i) {
+        if (hierarchy.levels[i].tolerance > maxTolerance) break;
+        selected = i;
+    }
+    return hierarchy.levels[selected];
+}
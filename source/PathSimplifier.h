@@ -0,0 +1,35 @@
+// PathSimplifier.h
+
+#ifndef PATH_SIMPLIFIER_H
+#define PATH_SIMPLIFIER_H
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Douglas-Peucker importance ranking for polylines. Every vertex gets the largest tolerance at
+// which it would still be kept; from that, index lists for a ladder of doubling tolerances are
+// concatenated into one buffer so a renderer can pick a level per frame with a single offset.
+class PathSimplifier {
+public:
+    struct Level {
+        float tolerance;  // World-space deviation allowed at this level
+        size_t offset;    // First index of the level in Hierarchy::indices
+        size_t count;     // Number of indices, a path-ordered subset of the vertices
+    };
+
+    struct Hierarchy {
+        std::vector<unsigned int> indices;
+        std::vector<Level> levels;   // Level 0 keeps every vertex, later levels are coarser
+    };
+
+    // Per-vertex Douglas-Peucker tolerance; the end points are infinitely important
+    static std::vector<float> computeImportance(const std::vector<glm::vec3>& points);
+
+    static Hierarchy buildHierarchy(const std::vector<glm::vec3>& points, int maxLevels = 16);
+
+    // Coarsest level whose tolerance is at most maxTolerance; a zero-count level for an empty hierarchy
+    static const Level& selectLevel(const Hierarchy& hierarchy, float maxTolerance);
+};
+
+#endif // PATH_SIMPLIFIER_H
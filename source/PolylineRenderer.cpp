@@ -0,0 +1,199 @@
+// PolylineRenderer.cpp
+
+#include "PolylineRenderer.h"
+#include <algorithm>
+#include <iostream>
+
+PolylineRenderer::PolylineRenderer()
+    : vao(0), pointCount(0), colorCount(0), indexCount(0), hasColors(false), hasIndices(false) {
+}
+
+bool PolylineRenderer::initialize() {
+    if (vao != 0) return true;
+
+    glGenVertexArrays(1, &vao);
+    for (BufferTexture* target : { &positions, &colors, &indices }) {
+        glGenBuffers(1, &target->buffer);
+        glGenTextures(1, &target->texture);
+    }
+
+    if (vao == 0 || positions.texture == 0) {
+        std::cerr << "ERROR: Failed to create polyline buffers." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void PolylineRenderer::grow(BufferTexture& target, GLenum format, size_t bytes, size_t keptBytes) {
+    // Headroom so a line that keeps getting longer reallocates only now and then
+    size_t capacity = bytes + bytes / 2;
+
+    if (keptBytes == 0) {
+        glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+        glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+    }
+    else {
+        // New storage would drop the contents, so they move to a fresh buffer on the GPU
+        GLuint grown = 0;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, target.buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keptBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &target.buffer);
+        target.buffer = grown;
+    }
+    target.capacity = capacity;
+
+    // The texture view has to be re-attached after the storage changed
+    glBindTexture(GL_TEXTURE_BUFFER, target.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, target.buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void PolylineRenderer::upload(BufferTexture& target, GLenum format, const void* data, size_t bytes) {
+    if (bytes > target.capacity) grow(target, format, bytes, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    if (bytes > 0) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void PolylineRenderer::append(BufferTexture& target, GLenum format, const void* data, size_t keptBytes, size_t bytes) {
+    if (keptBytes + bytes > target.capacity) grow(target, format, keptBytes + bytes, keptBytes);
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, keptBytes, bytes, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void PolylineRenderer::setPoints(const glm::vec3* points, size_t count) {
+    if (vao == 0 && !initialize()) return;
+    // Stored as single floats; RGB32F buffer textures need GL 4.0, the shader fetches three texels per point
+    upload(positions, GL_R32F, points, count * sizeof(glm::vec3));
+    pointCount = count;
+}
+
+void PolylineRenderer::appendPoints(const glm::vec3* points, size_t count) {
+    if (vao == 0 && !initialize()) return;
+    if (count == 0) return;
+    append(positions, GL_R32F, points, pointCount * sizeof(glm::vec3), count * sizeof(glm::vec3));
+    pointCount += count;
+}
+
+void PolylineRenderer::setColors(const glm::u8vec4* colorData, size_t count) {
+    if (vao == 0 && !initialize()) return;
+    upload(colors, GL_RGBA8, colorData, count * sizeof(glm::u8vec4));
+    colorCount = count;
+    hasColors = count > 0;
+}
+
+void PolylineRenderer::appendColors(const glm::u8vec4* colorData, size_t count) {
+    if (vao == 0 && !initialize()) return;
+    if (count == 0) return;
+    append(colors, GL_RGBA8, colorData, colorCount * sizeof(glm::u8vec4), count * sizeof(glm::u8vec4));
+    colorCount += count;
+    hasColors = true;
+}
+
+void PolylineRenderer::clearColors() {
+    colorCount = 0;
+    hasColors = false;
+}
+
+void PolylineRenderer::setIndices(const unsigned int* indexData, size_t count) {
+    if (vao == 0 && !initialize()) return;
+    upload(indices, GL_R32UI, indexData, count * sizeof(unsigned int));
+    indexCount = count;
+    hasIndices = count > 0;
+}
+
+void PolylineRenderer::clearIndices() {
+    indexCount = 0;
+    hasIndices = false;
+}
+
+size_t PolylineRenderer::getPointCount() const {
+    return pointCount;
+}
+
+void PolylineRenderer::applyStyle(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const Style& style) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    shader.use();
+    shader.setMat4("view", view);
+    shader.setMat4("projection", projection);
+    shader.setVec2("viewportSize", glm::vec2(static_cast<float>(viewport[2]), static_cast<float>(viewport[3])));
+    shader.setVec4("lineColor", style.color);
+    shader.setFloat("lineWidth", style.width);
+    shader.setFloat("miterLimit", style.miterLimit);
+    shader.setFloat("depthBias", style.depthBias);
+
+    // Every sampler gets its own unit, even unused ones, so no two sampler types ever share a unit
+    shader.setInt("positions", POSITION_TEXTURE_UNIT);
+    shader.setInt("colors", COLOR_TEXTURE_UNIT);
+    shader.setInt("indices", INDEX_TEXTURE_UNIT);
+    shader.setInt("stripIds", STRIP_ID_TEXTURE_UNIT);
+    shader.setInt("stripColors", STRIP_COLOR_TEXTURE_UNIT);
+}
+
+void PolylineRenderer::draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const Style& style,
+    size_t first, size_t count) const {
+    size_t available = hasIndices ? indexCount : pointCount;
+    if (vao == 0 || first >= available) return;
+    count = std::min(count, available - first);
+    if (count < 2) return;
+
+    applyStyle(shader, view, projection, style);
+    shader.setInt("packedStrips", 0);
+    shader.setInt("firstVertex", static_cast<int>(first));
+    shader.setInt("vertexCount", static_cast<int>(count));
+    shader.setInt("useColors", hasColors ? 1 : 0);
+    shader.setInt("useIndices", hasIndices ? 1 : 0);
+
+    glActiveTexture(GL_TEXTURE0 + POSITION_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, positions.texture);
+    glActiveTexture(GL_TEXTURE0 + COLOR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, colors.texture);
+    glActiveTexture(GL_TEXTURE0 + INDEX_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, indices.texture);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Depth-tested against the scene, but a translucent line must not hide what is drawn after it
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, VERTICES_PER_SEGMENT, static_cast<GLsizei>(count - 1));
+    glBindVertexArray(0);
+
+    glDepthMask(GL_TRUE);
+    if (!depthTest) glDisable(GL_DEPTH_TEST);
+}
+
+void PolylineRenderer::draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const Style& style) const {
+    draw(shader, view, projection, style, 0, hasIndices ? indexCount : pointCount);
+}
+
+void PolylineRenderer::release(BufferTexture& target) {
+    if (target.texture) glDeleteTextures(1, &target.texture);
+    if (target.buffer) glDeleteBuffers(1, &target.buffer);
+    target = BufferTexture();
+}
+
+void PolylineRenderer::cleanup() {
+    if (vao) glDeleteVertexArrays(1, &vao);
+    vao = 0;
+    release(positions);
+    release(colors);
+    release(indices);
+    pointCount = 0;
+    colorCount = 0;
+    indexCount = 0;
+    hasColors = false;
+    hasIndices = false;
+}
@@ -0,0 +1,91 @@
+// PolylineRenderer.h
+
+#ifndef POLYLINE_RENDERER_H
+#define POLYLINE_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <cstddef>
+#include "Shader.h"
+
+// Thick, depth-tested lines without glLineWidth, which core profiles clamp to one pixel.
+// Points, optional per-point colours and an optional index list live in buffer textures;
+// every segment is one instance that the vertex shader expands into a screen-space quad plus
+// a bevel triangle, looking up its neighbours for miter joins. A whole polyline of any length
+// is a single glDrawArraysInstanced call, meant for shaders/polylineVert.glsl.
+class PolylineRenderer {
+public:
+    struct Style {
+        glm::vec4 color = glm::vec4(1.0f);  // Used when no colour buffer is set, multiplied otherwise
+        float width = 4.0f;                 // Pixels
+        float miterLimit = 4.0f;            // Joins whose miter is longer than this many half widths are bevelled
+        float depthBias = 0.002f;           // Fraction of the eye distance the line is pulled towards the camera
+    };
+
+    // Sampler units of the polyline shader, above the terrain's so drawing a line never disturbs their bindings
+    static constexpr int POSITION_TEXTURE_UNIT = 5;
+    static constexpr int COLOR_TEXTURE_UNIT = 6;
+    static constexpr int INDEX_TEXTURE_UNIT = 7;
+    static constexpr int STRIP_ID_TEXTURE_UNIT = 8;
+    static constexpr int STRIP_COLOR_TEXTURE_UNIT = 9;
+
+    // Two triangles for the segment body and one for the bevel at its start
+    static constexpr GLsizei VERTICES_PER_SEGMENT = 9;
+
+    PolylineRenderer();
+
+    bool initialize();
+
+    // Replaces the vertices; the buffer only grows, so refreshing a line of similar length does not reallocate
+    void setPoints(const glm::vec3* points, size_t count);
+
+    // Adds points after the existing ones, writing only the new range; growing keeps the old points
+    // with a GPU-side copy, so a line extended a little at a time costs what it gains
+    void appendPoints(const glm::vec3* points, size_t count);
+    void setColors(const glm::u8vec4* colors, size_t count);
+    void appendColors(const glm::u8vec4* colors, size_t count);
+    void clearColors();
+
+    // Draws through an index list into the points, e.g. the levels of a PathSimplifier::Hierarchy
+    void setIndices(const unsigned int* indices, size_t count);
+    void clearIndices();
+
+    size_t getPointCount() const;
+
+    // Draws the strip of count vertices starting at first; first and count address the index list when one is set
+    void draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const Style& style,
+        size_t first, size_t count) const;
+
+    // Draws every point in order
+    void draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const Style& style) const;
+
+    void cleanup();
+
+    // Uses the shader and sets the camera, style and sampler unit uniforms shared by every polyline draw
+    static void applyStyle(Shader& shader, const glm::mat4& view, const glm::mat4& projection, const Style& style);
+
+private:
+    struct BufferTexture {
+        GLuint buffer = 0;
+        GLuint texture = 0;
+        size_t capacity = 0;   // Bytes
+    };
+
+    void upload(BufferTexture& target, GLenum format, const void* data, size_t bytes);
+    void append(BufferTexture& target, GLenum format, const void* data, size_t keptBytes, size_t bytes);
+    void grow(BufferTexture& target, GLenum format, size_t bytes, size_t keptBytes);
+    void release(BufferTexture& target);
+
+    GLuint vao;   // Empty, core profiles need one bound to draw
+    BufferTexture positions;
+    BufferTexture colors;
+    BufferTexture indices;
+    size_t pointCount;
+    size_t colorCount;
+    size_t indexCount;
+    bool hasColors;
+    bool hasIndices;
+};
+
+#endif // POLYLINE_RENDERER_H
@@ -0,0 +1,388 @@
+// ProceduralTerrain.cpp
+
+#include "ProceduralTerrain.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace {
+    constexpr size_t MAX_TILES_IN_FLIGHT = 16;
+    constexpr size_t MAX_UPLOADS_PER_FRAME = 4;
+    constexpr int REPORT_INTERVAL_TILES = 32;
+
+    double nowSeconds() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+ProceduralTerrain::ProceduralTerrain()
+    : noise(std::make_shared<FractalNoise>()),
+    completionQueue(std::make_shared<CompletionQueue>()),
+    sharedEBO(0), indexCount(0),
+    tileCells(128),
+    cellSize(1.0f),
+    heightScale(500.0f),
+    viewRadius(4),
+    tileRevision(0),
+    windowCells(0), windowWorkerSeconds(0.0), windowStartTime(0.0), windowTiles(0) {
+}
+
+void ProceduralTerrain::setNoiseParameters(const FractalNoise::Parameters& params) {
+    // Tiles still in flight keep their own reference to the old generator
+    noise = std::make_shared<FractalNoise>(params);
+    for (auto& entry : tiles) releaseTile(entry.second);
+    tiles.clear();
+    requested.clear();
+    pendingUploads.clear();
+    completionQueue = std::make_shared<CompletionQueue>();
+}
+
+void ProceduralTerrain::setHeightScale(float scale) { heightScale = scale; }
+void ProceduralTerrain::setCellSize(float size) { cellSize = size; }
+void ProceduralTerrain::setViewRadius(int tilesAround) { viewRadius = std::max(0, tilesAround); }
+
+void ProceduralTerrain::setTileCells(int cells) {
+    if (cells == tileCells || cells < 1) return;
+    tileCells = cells;
+
+    // The shared index buffer depends on the tile size
+    cleanup();
+}
+
+float ProceduralTerrain::getTileSpan() const {
+    return tileCells * cellSize;
+}
+
+ProceduralTerrain::TileKey ProceduralTerrain::tileAt(float x, float z) const {
+    float span = getTileSpan();
+    return TileKey{ static_cast<int>(std::floor(x / span)), static_cast<int>(std::floor(z / span)) };
+}
+
+size_t ProceduralTerrain::getResidentTileCount() const {
+    return tiles.size();
+}
+
+ProceduralTerrain::GeneratedTile ProceduralTerrain::generateTile(const FractalNoise& noise, TileKey key,
+    int tileCells, float cellSize, float heightScale) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // One extra sample on every side so normals at the tile border match the neighbouring tile
+    int samples = tileCells + 3;
+    int vertexCount = tileCells + 1;
+    int firstX = key.x * tileCells - 1;
+    int firstZ = key.z * tileCells - 1;
+
+    std::vector<float> apron(static_cast<size_t>(samples) * samples);
+    for (int row = 0; row < samples; ++row) {
+        noise.sampleRow(firstX * cellSize, (firstZ + row) * cellSize, cellSize, samples, &apron[static_cast<size_t>(row) * samples]);
+    }
+    for (float& h : apron) {
+        h = (h * 0.5f + 0.5f) * heightScale;
+    }
+
+    GeneratedTile tile;
+    tile.key = key;
+    tile.heights.resize(static_cast<size_t>(vertexCount) * vertexCount);
+    tile.vertexData.reserve(tile.heights.size() * 6);
+
+    for (int z = 0; z < vertexCount; ++z) {
+        for (int x = 0; x < vertexCount; ++x) {
+            int a = (z + 1) * samples + (x + 1);
+            float y = apron[a];
+            tile.heights[z * vertexCount + x] = y;
+
+            glm::vec3 normal = glm::normalize(glm::vec3(
+                apron[a - 1] - apron[a + 1],
+                2.0f * cellSize,
+                apron[a - samples] - apron[a + samples]));
+
+            // Grid index times cell size, so shared tile edges get bit-identical positions
+            tile.vertexData.push_back((firstX + 1 + x) * cellSize);
+            tile.vertexData.push_back(y);
+            tile.vertexData.push_back((firstZ + 1 + z) * cellSize);
+            tile.vertexData.push_back(normal.x);
+            tile.vertexData.push_back(normal.y);
+            tile.vertexData.push_back(normal.z);
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    tile.seconds = std::chrono::duration<double>(end - start).count();
+    return tile;
+}
+
+void ProceduralTerrain::setupIndexBuffer() {
+    // Same triangulation as Terrain, shared by every tile VAO
+    int vertexCount = tileCells + 1;
+    std::vector<GLuint> indices;
+    indices.reserve(static_cast<size_t>(tileCells) * tileCells * 6);
+
+    for (int z = 0; z < tileCells; ++z) {
+        for (int x = 0; x < tileCells; ++x) {
+            GLuint topLeft = z * vertexCount + x;
+            GLuint topRight = topLeft + 1;
+            GLuint bottomLeft = (z + 1) * vertexCount + x;
+            GLuint bottomRight = bottomLeft + 1;
+
+            indices.push_back(topLeft);
+            indices.push_back(bottomLeft);
+            indices.push_back(topRight);
+
+            indices.push_back(topRight);
+            indices.push_back(bottomLeft);
+            indices.push_back(bottomRight);
+        }
+    }
+
+    glGenBuffers(1, &sharedEBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sharedEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    indexCount = static_cast<GLsizei>(indices.size());
+}
+
+void ProceduralTerrain::uploadTile(GeneratedTile& generated) {
+    Tile tile;
+    tile.heights = std::move(generated.heights);
+
+    glGenVertexArrays(1, &tile.VAO);
+    glGenBuffers(1, &tile.VBO);
+
+    glBindVertexArray(tile.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, tile.VBO);
+    glBufferData(GL_ARRAY_BUFFER, generated.vertexData.size() * sizeof(float), generated.vertexData.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sharedEBO);
+
+    // Position attribute
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+
+    // Normal attribute
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+
+    glBindVertexArray(0);
+
+    tiles[generated.key] = std::move(tile);
+    ++tileRevision;
+}
+
+void ProceduralTerrain::releaseTile(Tile& tile) {
+    if (tile.VAO) glDeleteVertexArrays(1, &tile.VAO);
+    if (tile.VBO) glDeleteBuffers(1, &tile.VBO);
+    tile.VAO = 0;
+    tile.VBO = 0;
+    ++tileRevision;
+}
+
+void ProceduralTerrain::update(const glm::vec3& cameraPosition) {
+    if (sharedEBO == 0) {
+        setupIndexBuffer();
+    }
+
+    TileKey center = tileAt(cameraPosition.x, cameraPosition.z);
+    auto inRange = [&](const TileKey& key, int radius) {
+        return std::abs(key.x - center.x) <= radius && std::abs(key.z - center.z) <= radius;
+    };
+
+    // Collect tiles finished by the workers
+    std::vector<GeneratedTile> finished;
+    {
+        std::lock_guard<std::mutex> lock(completionQueue->mutex);
+        finished.swap(completionQueue->ready);
+    }
+    for (auto& generated : finished) {
+        windowCells += generated.heights.size();
+        windowWorkerSeconds += generated.seconds;
+        ++windowTiles;
+        pendingUploads.push_back(std::move(generated));
+    }
+    if (windowTiles >= REPORT_INTERVAL_TILES) {
+        reportThroughput();
+    }
+
+    // Upload a bounded number per frame so a fast camera does not cause a hitch
+    size_t uploads = 0;
+    while (!pendingUploads.empty() && uploads < MAX_UPLOADS_PER_FRAME) {
+        GeneratedTile generated = std::move(pendingUploads.front());
+        pendingUploads.pop_front();
+        requested.erase(generated.key);
+
+        if (inRange(generated.key, viewRadius + 1)) {
+            uploadTile(generated);
+            ++uploads;
+        }
+    }
+
+    // Evict tiles the camera has left behind (one ring of hysteresis)
+    for (auto it = tiles.begin(); it != tiles.end();) {
+        if (!inRange(it->first, viewRadius + 1)) {
+            releaseTile(it->second);
+            it = tiles.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    // Request the missing tiles, nearest first
+    std::vector<TileKey> missing;
+    for (int dz = -viewRadius; dz <= viewRadius; ++dz) {
+        for (int dx = -viewRadius; dx <= viewRadius; ++dx) {
+            TileKey key{ center.x + dx, center.z + dz };
+            if (tiles.count(key) == 0 && requested.count(key) == 0) {
+                missing.push_back(key);
+            }
+        }
+    }
+    std::sort(missing.begin(), missing.end(), [&](const TileKey& a, const TileKey& b) {
+        int da = (a.x - center.x) * (a.x - center.x) + (a.z - center.z) * (a.z - center.z);
+        int db = (b.x - center.x) * (b.x - center.x) + (b.z - center.z) * (b.z - center.z);
+        return da < db;
+    });
+
+    for (const TileKey& key : missing) {
+        if (requested.size() >= MAX_TILES_IN_FLIGHT) break;
+
+        if (windowTiles == 0 && windowCells == 0) {
+            windowStartTime = nowSeconds();
+        }
+        requested.insert(key);
+
+        std::shared_ptr<CompletionQueue> queue = completionQueue;
+        std::shared_ptr<const FractalNoise> generator = noise;
+        int cells = tileCells;
+        float spacing = cellSize;
+        float scale = heightScale;
+
+        ThreadPool::getInstance().enqueue([queue, generator, key, cells, spacing, scale]() {
+            GeneratedTile tile = generateTile(*generator, key, cells, spacing, scale);
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->ready.push_back(std::move(tile));
+        });
+    }
+}
+
+void ProceduralTerrain::reportThroughput() {
+    double wallSeconds = nowSeconds() - windowStartTime;
+    double megaCells = windowCells / 1.0e6;
+
+    std::cout << "INFO: Procedural terrain generated " << windowTiles << " tiles: "
+        << (wallSeconds > 0.0 ? megaCells / wallSeconds : 0.0) << " Mcells/s overall, "
+        << (windowWorkerSeconds > 0.0 ? megaCells / windowWorkerSeconds : 0.0) << " Mcells/s per worker ("
+        << (noise->isUsingAvx2() ? "AVX2" : "scalar") << ", " << tiles.size() << " tiles resident)" << std::endl;
+
+    windowCells = 0;
+    windowWorkerSeconds = 0.0;
+    windowTiles = 0;
+    windowStartTime = nowSeconds();
+}
+
+void ProceduralTerrain::render(const glm::mat4& model, const glm::mat4& view,
+    const glm::mat4& projection, const glm::vec3& cameraPosition, Shader& shader) {
+    if (tiles.empty()) return;
+
+    shader.use();
+    shader.setMat4("model", model);
+    shader.setMat4("view", view);
+    shader.setMat4("projection", projection);
+    shader.setVec3("viewPos", cameraPosition);
+
+    // No baked weights for noise tiles, use the altitude colouring
+    shader.setInt("useSplatting", 0);
+    shader.setInt("materials", 0);
+    shader.setInt("splatWeights", 1); // Samplers of different types may not share a unit
+    shader.setInt("useNormalMap", 0);
+    shader.setInt("normalMap", 2);
+
+    for (const auto& entry : tiles) {
+        glBindVertexArray(entry.second.VAO);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    }
+    glBindVertexArray(0);
+}
+
+void ProceduralTerrain::renderDepth(Shader& depthShader) const {
+    depthShader.setMat4("model", glm::mat4(1.0f));
+
+    for (const auto& entry : tiles) {
+        glBindVertexArray(entry.second.VAO);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    }
+    glBindVertexArray(0);
+}
+
+unsigned int ProceduralTerrain::getTileRevision() const {
+    return tileRevision;
+}
+
+float ProceduralTerrain::getHeightAtPosition(float x, float z) const {
+    TileKey key = tileAt(x, z);
+    auto it = tiles.find(key);
+    if (it == tiles.end()) {
+        // Not resident: evaluate the noise directly
+        return (noise->sample(x, z) * 0.5f + 0.5f) * heightScale;
+    }
+
+    // Bilinear interpolation inside the resident tile, matching the rendered grid
+    const std::vector<float>& heights = it->second.heights;
+    int vertexCount = tileCells + 1;
+    float localX = glm::clamp(x / cellSize - key.x * tileCells, 0.0f, static_cast<float>(tileCells));
+    float localZ = glm::clamp(z / cellSize - key.z * tileCells, 0.0f, static_cast<float>(tileCells));
+
+    int x0 = std::min(static_cast<int>(localX), tileCells - 1);
+    int z0 = std::min(static_cast<int>(localZ), tileCells - 1);
+    float fx = localX - x0;
+    float fz = localZ - z0;
+
+    float h00 = heights[z0 * vertexCount + x0];
+    float h10 = heights[z0 * vertexCount + x0 + 1];
+    float h01 = heights[(z0 + 1) * vertexCount + x0];
+    float h11 = heights[(z0 + 1) * vertexCount + x0 + 1];
+
+    return glm::mix(glm::mix(h00, h10, fx), glm::mix(h01, h11, fx), fz);
+}
+
+void ProceduralTerrain::benchmark() const {
+    const int size = 512;
+    std::vector<float> row(size);
+
+    auto measure = [&](bool avx2) {
+        FractalNoise generator(noise->getParameters());
+        generator.setUseAvx2(avx2);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int z = 0; z < size; ++z) {
+            generator.sampleRow(0.0f, z * cellSize, cellSize, size, row.data());
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        return seconds > 0.0 ? (size * size / 1.0e6) / seconds : 0.0;
+    };
+
+    std::cout << "INFO: fBm noise throughput (single thread): scalar " << measure(false) << " Mcells/s";
+    if (FractalNoise::cpuSupportsAvx2()) {
+        std::cout << ", AVX2 " << measure(true) << " Mcells/s";
+    }
+    else {
+        std::cout << ", AVX2 not supported on this CPU";
+    }
+    std::cout << std::endl;
+}
+
+void ProceduralTerrain::cleanup() {
+    for (auto& entry : tiles) releaseTile(entry.second);
+    tiles.clear();
+    requested.clear();
+    pendingUploads.clear();
+
+    // Results of tiles still in flight go to the old queue and are dropped with it
+    completionQueue = std::make_shared<CompletionQueue>();
+
+    if (sharedEBO) glDeleteBuffers(1, &sharedEBO);
+    sharedEBO = 0;
+    indexCount = 0;
+}
@@ -0,0 +1,111 @@
+// ProceduralTerrain.h
+
+#ifndef PROCEDURAL_TERRAIN_H
+#define PROCEDURAL_TERRAIN_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "FractalNoise.h"
+#include "HeightSource.h"
+#include "Shader.h"
+
+// Unbounded terrain built from fBm noise. Square tiles around the camera are generated on the
+// ThreadPool, uploaded on the render thread and evicted again once the camera moves away.
+// Tiles use the same vertex layout as Terrain, so they are drawn with the terrain shader.
+class ProceduralTerrain : public HeightSource {
+public:
+    ProceduralTerrain();
+
+    void setNoiseParameters(const FractalNoise::Parameters& params);
+    void setHeightScale(float scale);
+    void setCellSize(float size);
+    void setTileCells(int cells);
+    void setViewRadius(int tiles);
+
+    // Requests missing tiles around the camera, uploads finished ones and evicts far ones
+    void update(const glm::vec3& cameraPosition);
+    void render(const glm::mat4& model, const glm::mat4& view,
+        const glm::mat4& projection, const glm::vec3& cameraPosition, Shader& shader);
+    void renderDepth(Shader& depthShader) const;
+    void cleanup();
+
+    float getHeightAtPosition(float x, float z) const override;
+    size_t getResidentTileCount() const;
+
+    // Changes whenever a tile is uploaded or evicted, so cached renders of the tiles can be refreshed
+    unsigned int getTileRevision() const;
+
+    // Logs single-thread generation throughput of the scalar and AVX2 noise paths
+    void benchmark() const;
+
+private:
+    struct TileKey {
+        int x;
+        int z;
+        bool operator==(const TileKey& other) const { return x == other.x && z == other.z; }
+    };
+
+    struct TileKeyHash {
+        size_t operator()(const TileKey& key) const {
+            return std::hash<long long>()((static_cast<long long>(key.x) << 32) ^ static_cast<unsigned int>(key.z));
+        }
+    };
+
+    struct Tile {
+        GLuint VAO = 0;
+        GLuint VBO = 0;
+        std::vector<float> heights; // (tileCells + 1)^2 samples for height queries
+    };
+
+    struct GeneratedTile {
+        TileKey key;
+        std::vector<float> heights;
+        std::vector<float> vertexData; // Interleaved position and normal, like Terrain
+        double seconds;
+    };
+
+    // Shared with the worker tasks so they never touch the ProceduralTerrain itself
+    struct CompletionQueue {
+        std::mutex mutex;
+        std::vector<GeneratedTile> ready;
+    };
+
+    static GeneratedTile generateTile(const FractalNoise& noise, TileKey key, int tileCells,
+        float cellSize, float heightScale);
+
+    void setupIndexBuffer();
+    void uploadTile(GeneratedTile& generated);
+    void releaseTile(Tile& tile);
+    TileKey tileAt(float x, float z) const;
+    float getTileSpan() const;
+    void reportThroughput();
+
+    std::shared_ptr<FractalNoise> noise;
+    std::shared_ptr<CompletionQueue> completionQueue;
+    std::unordered_map<TileKey, Tile, TileKeyHash> tiles;
+    std::unordered_set<TileKey, TileKeyHash> requested;
+    std::deque<GeneratedTile> pendingUploads;
+
+    GLuint sharedEBO;
+    GLsizei indexCount;
+
+    int tileCells;
+    float cellSize;
+    float heightScale;
+    int viewRadius;
+    unsigned int tileRevision;
+
+    // Throughput accounting
+    unsigned long long windowCells;
+    double windowWorkerSeconds;
+    double windowStartTime;
+    int windowTiles;
+};
+
+#endif // PROCEDURAL_TERRAIN_H
@@ -0,0 +1,514 @@
+// RouteHierarchy.cpp
+
+#include "RouteHierarchy.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace {
+    constexpr char FILE_MAGIC[4] = { 'R', 'T', 'H', 'Y' };
+    constexpr uint32_t FILE_VERSION = 1;
+    constexpr uint8_t NO_PARENT = 0xFF;
+    constexpr float INFINITE_COST = std::numeric_limits<float>::infinity();
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        int32_t clusterSize;
+        int32_t entranceSpacing;
+        int32_t width;
+        int32_t depth;
+        float cellSize;
+        float maxGrade;
+        int32_t connectivity;
+        uint32_t reserved;
+        uint64_t nodeCount;
+        uint64_t clusterCount;
+        uint64_t costCount;
+    };
+
+    // Positions along a border of the given length; short borders get one entrance in the middle
+    std::vector<int> entranceOffsets(int length, int spacing) {
+        std::vector<int> offsets;
+        for (int offset = spacing / 2; offset < length; offset += spacing) {
+            offsets.push_back(offset);
+        }
+        if (offsets.empty() && length > 0) {
+            offsets.push_back(length / 2);
+        }
+        return offsets;
+    }
+
+    // Min-heap order on the cost of (cost, index) pairs
+    struct CostOrder {
+        bool operator()(const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) const {
+            return a.first > b.first;
+        }
+    };
+}
+
+void RouteHierarchy::LocalSearch::run(const RoutePlanner& planner, const ClusterBox& clusterBox, uint32_t vertex,
+    bool reverse, uint32_t stopVertex) {
+    box = clusterBox;
+    gridWidth = planner.getWidth();
+    source = vertex;
+
+    const int boxWidth = box.x1 - box.x0;
+    const int boxDepth = box.z1 - box.z0;
+    costs.assign(static_cast<size_t>(boxWidth) * boxDepth, INFINITE_COST);
+    parents.assign(costs.size(), NO_PARENT);
+    heap.clear();
+
+    const std::vector<float>& heights = planner.getHeights();
+    const int neighbourCount = static_cast<int>(planner.getConnectivity());
+    float runs[16];
+    for (int n = 0; n < neighbourCount; ++n) {
+        int dx = RoutePlanner::NEIGHBOUR_X[n];
+        int dz = RoutePlanner::NEIGHBOUR_Z[n];
+        runs[n] = planner.getCellSize() * std::sqrt(static_cast<float>(dx * dx + dz * dz));
+    }
+
+    auto localIndex = [&](int x, int z) {
+        return static_cast<size_t>(z - box.z0) * boxWidth + (x - box.x0);
+    };
+
+    int sourceZ = static_cast<int>(vertex) / gridWidth;
+    int sourceX = static_cast<int>(vertex) - sourceZ * gridWidth;
+    costs[localIndex(sourceX, sourceZ)] = 0.0f;
+    heap.push_back({ 0.0f, vertex });
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), CostOrder());
+        auto [cost, current] = heap.back();
+        heap.pop_back();
+
+        const int z = static_cast<int>(current) / gridWidth;
+        const int x = static_cast<int>(current) - z * gridWidth;
+        if (cost > costs[localIndex(x, z)]) continue;
+        if (current == stopVertex) break;
+
+        const float height = heights[current];
+        for (int n = 0; n < neighbourCount; ++n) {
+            int nx = x + RoutePlanner::NEIGHBOUR_X[n];
+            int nz = z + RoutePlanner::NEIGHBOUR_Z[n];
+            if (nx < box.x0 || nz < box.z0 || nx >= box.x1 || nz >= box.z1) continue;
+
+            // Backward searches relax the edge from the neighbour into the current vertex
+            uint32_t neighbour = static_cast<uint32_t>(nz * gridWidth + nx);
+            float rise = heights[neighbour] - height;
+            float candidate = cost + planner.edgeTime(runs[n], reverse ? -rise : rise);
+
+            size_t index = localIndex(nx, nz);
+            if (candidate < costs[index]) {
+                costs[index] = candidate;
+                parents[index] = static_cast<uint8_t>(n);
+                heap.push_back({ candidate, neighbour });
+                std::push_heap(heap.begin(), heap.end(), CostOrder());
+            }
+        }
+    }
+}
+
+float RouteHierarchy::LocalSearch::costAt(uint32_t vertex) const {
+    int z = static_cast<int>(vertex) / gridWidth;
+    int x = static_cast<int>(vertex) - z * gridWidth;
+    if (x < box.x0 || z < box.z0 || x >= box.x1 || z >= box.z1) return INFINITE_COST;
+    return costs[static_cast<size_t>(z - box.z0) * (box.x1 - box.x0) + (x - box.x0)];
+}
+
+void RouteHierarchy::LocalSearch::appendPath(uint32_t target, std::vector<uint32_t>& vertices) const {
+    // Parent directions lead back to the source; the first vertex is skipped if the route already ends there
+    size_t first = vertices.size();
+    int x = static_cast<int>(target) % gridWidth;
+    int z = static_cast<int>(target) / gridWidth;
+    while (true) {
+        vertices.push_back(static_cast<uint32_t>(z * gridWidth + x));
+        if (vertices.back() == source) break;
+
+        uint8_t parent = parents[static_cast<size_t>(z - box.z0) * (box.x1 - box.x0) + (x - box.x0)];
+        if (parent == NO_PARENT) break;
+        x -= RoutePlanner::NEIGHBOUR_X[parent];
+        z -= RoutePlanner::NEIGHBOUR_Z[parent];
+    }
+    std::reverse(vertices.begin() + first, vertices.end());
+    if (first > 0 && vertices[first - 1] == vertices[first]) {
+        vertices.erase(vertices.begin() + first);
+    }
+}
+
+RouteHierarchy::RouteHierarchy(int clusterSize, int entranceSpacing)
+    : clusterSize(std::max(clusterSize, 4)), entranceSpacing(std::max(entranceSpacing, 1)),
+    width(0), depth(0), cellSize(0.0f), maxGrade(0.0f), connectivity(0),
+    clustersX(0), clustersZ(0) {
+}
+
+void RouteHierarchy::clear() {
+    width = 0;
+    depth = 0;
+    clustersX = 0;
+    clustersZ = 0;
+    nodes.clear();
+    clusterNodeOffsets.clear();
+    clusterNodes.clear();
+    nodeSlots.clear();
+    costOffsets.clear();
+    intraCosts.clear();
+    clusterHashes.clear();
+}
+
+bool RouteHierarchy::isEmpty() const {
+    return clusterHashes.empty();
+}
+
+size_t RouteHierarchy::getClusterCount() const {
+    return clusterHashes.size();
+}
+
+size_t RouteHierarchy::getNodeCount() const {
+    return nodes.size();
+}
+
+RouteHierarchy::ClusterBox RouteHierarchy::getClusterBox(uint32_t cluster) const {
+    int cx = static_cast<int>(cluster) % clustersX;
+    int cz = static_cast<int>(cluster) / clustersX;
+    return { cx * clusterSize, cz * clusterSize,
+        std::min((cx + 1) * clusterSize, width), std::min((cz + 1) * clusterSize, depth) };
+}
+
+uint32_t RouteHierarchy::getClusterAt(uint32_t vertex) const {
+    int x = static_cast<int>(vertex) % width;
+    int z = static_cast<int>(vertex) / width;
+    return static_cast<uint32_t>((z / clusterSize) * clustersX + x / clusterSize);
+}
+
+uint64_t RouteHierarchy::hashCluster(const std::vector<float>& heights, uint32_t cluster) const {
+    // FNV-1a over the height bits, with a one-vertex halo for the edges that leave the cluster
+    ClusterBox box = getClusterBox(cluster);
+    int x0 = std::max(box.x0 - 1, 0);
+    int z0 = std::max(box.z0 - 1, 0);
+    int x1 = std::min(box.x1 + 1, width);
+    int z1 = std::min(box.z1 + 1, depth);
+
+    uint64_t hash = 14695981039346656037ull;
+    for (int z = z0; z < z1; ++z) {
+        for (int x = x0; x < x1; ++x) {
+            hash ^= std::bit_cast<uint32_t>(heights[static_cast<size_t>(z) * width + x]);
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+void RouteHierarchy::createNodes() {
+    clustersX = (width + clusterSize - 1) / clusterSize;
+    clustersZ = (depth + clusterSize - 1) / clusterSize;
+    nodes.clear();
+
+    auto addPair = [&](int ax, int az, int bx, int bz) {
+        uint32_t a = static_cast<uint32_t>(nodes.size());
+        uint32_t aVertex = static_cast<uint32_t>(az * width + ax);
+        uint32_t bVertex = static_cast<uint32_t>(bz * width + bx);
+        nodes.push_back({ aVertex, getClusterAt(aVertex), a + 1, INFINITE_COST });
+        nodes.push_back({ bVertex, getClusterAt(bVertex), a, INFINITE_COST });
+    };
+
+    // Borders between horizontally adjacent clusters, then vertically adjacent ones
+    for (int cz = 0; cz < clustersZ; ++cz) {
+        for (int cx = 0; cx + 1 < clustersX; ++cx) {
+            ClusterBox box = getClusterBox(static_cast<uint32_t>(cz * clustersX + cx));
+            for (int offset : entranceOffsets(box.z1 - box.z0, entranceSpacing)) {
+                addPair(box.x1 - 1, box.z0 + offset, box.x1, box.z0 + offset);
+            }
+        }
+    }
+    for (int cz = 0; cz + 1 < clustersZ; ++cz) {
+        for (int cx = 0; cx < clustersX; ++cx) {
+            ClusterBox box = getClusterBox(static_cast<uint32_t>(cz * clustersX + cx));
+            for (int offset : entranceOffsets(box.x1 - box.x0, entranceSpacing)) {
+                addPair(box.x0 + offset, box.z1 - 1, box.x0 + offset, box.z1);
+            }
+        }
+    }
+
+    // Group the nodes by cluster
+    size_t clusterCount = static_cast<size_t>(clustersX) * clustersZ;
+    clusterNodeOffsets.assign(clusterCount + 1, 0);
+    for (const Node& node : nodes) {
+        ++clusterNodeOffsets[node.cluster + 1];
+    }
+    for (size_t c = 0; c < clusterCount; ++c) {
+        clusterNodeOffsets[c + 1] += clusterNodeOffsets[c];
+    }
+
+    clusterNodes.assign(nodes.size(), 0);
+    nodeSlots.assign(nodes.size(), 0);
+    std::vector<uint32_t> fill(clusterNodeOffsets.begin(), clusterNodeOffsets.end() - 1);
+    for (uint32_t n = 0; n < nodes.size(); ++n) {
+        uint32_t cluster = nodes[n].cluster;
+        nodeSlots[n] = fill[cluster] - clusterNodeOffsets[cluster];
+        clusterNodes[fill[cluster]++] = n;
+    }
+
+    costOffsets.assign(clusterCount + 1, 0);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        size_t k = clusterNodeOffsets[c + 1] - clusterNodeOffsets[c];
+        costOffsets[c + 1] = costOffsets[c] + k * k;
+    }
+    intraCosts.assign(costOffsets[clusterCount], INFINITE_COST);
+}
+
+void RouteHierarchy::buildCluster(const RoutePlanner& planner, uint32_t cluster, LocalSearch& search) {
+    const ClusterBox box = getClusterBox(cluster);
+    const uint32_t first = clusterNodeOffsets[cluster];
+    const uint32_t k = clusterNodeOffsets[cluster + 1] - first;
+    const std::vector<float>& heights = planner.getHeights();
+
+    // One search per entrance gives its times to every other entrance of the cluster
+    for (uint32_t i = 0; i < k; ++i) {
+        Node& node = nodes[clusterNodes[first + i]];
+        search.run(planner, box, node.vertex, false);
+        for (uint32_t j = 0; j < k; ++j) {
+            intraCosts[costOffsets[cluster] + i * k + j] = search.costAt(nodes[clusterNodes[first + j]].vertex);
+        }
+
+        // The step across the border is a single straight edge
+        float rise = heights[nodes[node.partner].vertex] - heights[node.vertex];
+        node.partnerCost = planner.edgeTime(cellSize, rise);
+    }
+}
+
+size_t RouteHierarchy::update(const RoutePlanner& planner) {
+    if (planner.isEmpty()) return 0;
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    // A different grid or cost model invalidates every cluster
+    bool rebuildAll = width != planner.getWidth() || depth != planner.getDepth()
+        || cellSize != planner.getCellSize() || maxGrade != planner.getMaxGrade()
+        || connectivity != static_cast<int>(planner.getConnectivity()) || clusterHashes.empty();
+    if (rebuildAll) {
+        width = planner.getWidth();
+        depth = planner.getDepth();
+        cellSize = planner.getCellSize();
+        maxGrade = planner.getMaxGrade();
+        connectivity = static_cast<int>(planner.getConnectivity());
+        createNodes();
+        clusterHashes.assign(static_cast<size_t>(clustersX) * clustersZ, 0);
+    }
+
+    const size_t clusterCount = clusterHashes.size();
+    const std::vector<float>& heights = planner.getHeights();
+    std::vector<uint64_t> hashes(clusterCount);
+    ThreadPool& pool = ThreadPool::getInstance();
+    pool.parallelFor(0, clusterCount, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            hashes[c] = hashCluster(heights, static_cast<uint32_t>(c));
+        }
+    }, 16);
+
+    std::vector<uint32_t> dirty;
+    for (size_t c = 0; c < clusterCount; ++c) {
+        if (rebuildAll || hashes[c] != clusterHashes[c]) dirty.push_back(static_cast<uint32_t>(c));
+    }
+    if (dirty.empty()) return 0;
+
+    // Clusters only write their own nodes and cost matrix, so they build independently
+    pool.parallelFor(0, dirty.size(), [&](size_t begin, size_t end) {
+        LocalSearch search;
+        for (size_t i = begin; i < end; ++i) {
+            buildCluster(planner, dirty[i], search);
+        }
+    }, 1);
+    clusterHashes = std::move(hashes);
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    std::cout << "INFO: Route hierarchy: built " << dirty.size() << " of " << clusterCount << " clusters ("
+        << nodes.size() << " entrances) in "
+        << std::chrono::duration<double, std::milli>(endTime - startTime).count() << " ms." << std::endl;
+    return dirty.size();
+}
+
+RoutePlanner::Result RouteHierarchy::plan(const RoutePlanner& planner, const glm::vec3& start, const glm::vec3& goal) {
+    RoutePlanner::Result result;
+    if (clusterHashes.empty() || planner.isEmpty() || width != planner.getWidth() || depth != planner.getDepth()) return result;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    const uint32_t startVertex = planner.snapToGrid(start);
+    const uint32_t goalVertex = planner.snapToGrid(goal);
+    const uint32_t startCluster = getClusterAt(startVertex);
+    const uint32_t goalCluster = getClusterAt(goalVertex);
+
+    // Times from the start to its cluster's entrances and from the goal cluster's entrances to the goal
+    startSearch.run(planner, getClusterBox(startCluster), startVertex, false);
+    goalSearch.run(planner, getClusterBox(goalCluster), goalVertex, true);
+
+    // A* over the entrances; index goalNode stands for the goal itself
+    const uint32_t goalNode = static_cast<uint32_t>(nodes.size());
+    nodeCosts.assign(nodes.size() + 1, INFINITE_COST);
+    nodeParents.assign(nodes.size() + 1, -1);
+    nodeClosed.assign((nodes.size() + 64) / 64, 0);
+    std::vector<std::pair<float, uint32_t>> open;
+
+    auto relax = [&](uint32_t node, float cost, int32_t parent) {
+        if (cost < nodeCosts[node]) {
+            nodeCosts[node] = cost;
+            nodeParents[node] = parent;
+            float estimate = node == goalNode ? 0.0f : planner.estimateTime(nodes[node].vertex, goalVertex);
+            open.push_back({ cost + estimate, node });
+            std::push_heap(open.begin(), open.end(), CostOrder());
+        }
+    };
+
+    for (uint32_t i = clusterNodeOffsets[startCluster]; i < clusterNodeOffsets[startCluster + 1]; ++i) {
+        relax(clusterNodes[i], startSearch.costAt(nodes[clusterNodes[i]].vertex), -1);
+    }
+    if (startCluster == goalCluster) {
+        relax(goalNode, startSearch.costAt(goalVertex), -1);
+    }
+
+    while (!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), CostOrder());
+        uint32_t current = open.back().second;
+        open.pop_back();
+
+        uint64_t bit = uint64_t(1) << (current & 63);
+        if (nodeClosed[current >> 6] & bit) continue;
+        nodeClosed[current >> 6] |= bit;
+        ++result.expanded;
+
+        if (current == goalNode) {
+            result.found = true;
+            break;
+        }
+
+        const Node& node = nodes[current];
+        const float cost = nodeCosts[current];
+        const int32_t parent = static_cast<int32_t>(current);
+        if (node.cluster == goalCluster) {
+            relax(goalNode, cost + goalSearch.costAt(node.vertex), parent);
+        }
+        relax(node.partner, cost + node.partnerCost, parent);
+
+        const uint32_t first = clusterNodeOffsets[node.cluster];
+        const uint32_t k = clusterNodeOffsets[node.cluster + 1] - first;
+        const float* row = &intraCosts[costOffsets[node.cluster] + nodeSlots[current] * k];
+        for (uint32_t j = 0; j < k; ++j) {
+            if (row[j] < INFINITE_COST) relax(clusterNodes[first + j], cost + row[j], parent);
+        }
+    }
+
+    if (result.found) {
+        std::vector<uint32_t> route;
+        for (int32_t node = nodeParents[goalNode]; node >= 0; node = nodeParents[node]) {
+            route.push_back(static_cast<uint32_t>(node));
+        }
+        std::reverse(route.begin(), route.end());
+
+        // Refine: searches inside each crossed cluster, single steps across borders
+        std::vector<uint32_t> vertices;
+        if (route.empty()) {
+            startSearch.appendPath(goalVertex, vertices);
+        }
+        else {
+            startSearch.appendPath(nodes[route[0]].vertex, vertices);
+            for (size_t i = 0; i + 1 < route.size(); ++i) {
+                const Node& from = nodes[route[i]];
+                const Node& to = nodes[route[i + 1]];
+                if (from.cluster != to.cluster) {
+                    vertices.push_back(to.vertex);
+                    continue;
+                }
+                refineSearch.run(planner, getClusterBox(from.cluster), from.vertex, false, to.vertex);
+                refineSearch.appendPath(to.vertex, vertices);
+            }
+            const Node& last = nodes[route.back()];
+            refineSearch.run(planner, getClusterBox(goalCluster), last.vertex, false, goalVertex);
+            refineSearch.appendPath(goalVertex, vertices);
+        }
+
+        result.points.reserve(vertices.size());
+        for (uint32_t vertex : vertices) {
+            result.points.push_back(planner.getVertexPosition(vertex));
+        }
+        result.duration = nodeCosts[goalNode];
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    result.milliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    return result;
+}
+
+bool RouteHierarchy::save(const std::string& path) const {
+    if (clusterHashes.empty()) return false;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Failed to write route hierarchy: " << path << std::endl;
+        return false;
+    }
+
+    FileHeader header = {};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.clusterSize = clusterSize;
+    header.entranceSpacing = entranceSpacing;
+    header.width = width;
+    header.depth = depth;
+    header.cellSize = cellSize;
+    header.maxGrade = maxGrade;
+    header.connectivity = connectivity;
+    header.nodeCount = nodes.size();
+    header.clusterCount = clusterHashes.size();
+    header.costCount = intraCosts.size();
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(Node));
+    file.write(reinterpret_cast<const char*>(clusterHashes.data()), clusterHashes.size() * sizeof(uint64_t));
+    file.write(reinterpret_cast<const char*>(intraCosts.data()), intraCosts.size() * sizeof(float));
+    return file.good();
+}
+
+bool RouteHierarchy::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.version != FILE_VERSION
+        || header.clusterSize != clusterSize || header.entranceSpacing != entranceSpacing
+        || header.width <= 0 || header.depth <= 0) {
+        std::cerr << "ERROR: Route hierarchy file is not compatible: " << path << std::endl;
+        return false;
+    }
+
+    // The layout follows from the grid size; the file only has to agree with it
+    width = header.width;
+    depth = header.depth;
+    cellSize = header.cellSize;
+    maxGrade = header.maxGrade;
+    connectivity = header.connectivity;
+    createNodes();
+
+    std::vector<Node> storedNodes(nodes.size());
+    std::vector<uint64_t> storedHashes(static_cast<size_t>(clustersX) * clustersZ);
+    if (header.nodeCount != nodes.size() || header.clusterCount != storedHashes.size()
+        || header.costCount != intraCosts.size()
+        || !file.read(reinterpret_cast<char*>(storedNodes.data()), storedNodes.size() * sizeof(Node))
+        || !file.read(reinterpret_cast<char*>(storedHashes.data()), storedHashes.size() * sizeof(uint64_t))
+        || !file.read(reinterpret_cast<char*>(intraCosts.data()), intraCosts.size() * sizeof(float))) {
+        std::cerr << "ERROR: Route hierarchy file is truncated or inconsistent: " << path << std::endl;
+        clear();
+        return false;
+    }
+
+    nodes = std::move(storedNodes);
+    clusterHashes = std::move(storedHashes);
+    std::cout << "INFO: Route hierarchy loaded: " << clusterHashes.size() << " clusters, "
+        << nodes.size() << " entrances." << std::endl;
+    return true;
+}
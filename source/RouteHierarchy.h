@@ -0,0 +1,103 @@
+// RouteHierarchy.h
+
+#ifndef ROUTE_HIERARCHY_H
+#define ROUTE_HIERARCHY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "RoutePlanner.h"
+
+// HPA*-style abstraction of a RoutePlanner grid for repeated queries on large DEMs. The grid is cut
+// into square clusters; entrance vertex pairs sit at fixed spacing along every cluster border, and
+// the walking times between all entrances of a cluster are precomputed by searches confined to it.
+// A query then searches the small entrance graph and refines only the clusters the route crosses.
+// Every cluster keeps a hash of its heights plus a one-vertex halo, so update() rebuilds only what
+// changed and a hierarchy loaded from disk is checked against the terrain before it is used.
+class RouteHierarchy {
+public:
+    explicit RouteHierarchy(int clusterSize = 32, int entranceSpacing = 8);
+
+    // Builds the hierarchy for the planner's grid and cost model, or refreshes the clusters whose
+    // heights changed since the last call; returns the number of clusters (re)built
+    size_t update(const RoutePlanner& planner);
+
+    // Same snapping and result as RoutePlanner::plan; routes cross cluster borders at entrances only,
+    // so they can be slightly slower than the grid optimum
+    RoutePlanner::Result plan(const RoutePlanner& planner, const glm::vec3& start, const glm::vec3& goal);
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);  // Call update() afterwards to revalidate against the terrain
+    void clear();
+
+    bool isEmpty() const;
+    size_t getClusterCount() const;
+    size_t getNodeCount() const;
+
+private:
+    struct Node {
+        uint32_t vertex;
+        uint32_t cluster;
+        uint32_t partner;      // Entrance on the other side of the border
+        float partnerCost;     // Walking time from this vertex to the partner's
+    };
+
+    struct ClusterBox {
+        int x0, z0, x1, z1;    // Vertex range, exclusive upper bounds
+    };
+
+    // Dijkstra confined to one cluster, forward from a source or backward towards a target
+    class LocalSearch {
+    public:
+        void run(const RoutePlanner& planner, const ClusterBox& box, uint32_t vertex, bool reverse,
+            uint32_t stopVertex = UINT32_MAX);
+        float costAt(uint32_t vertex) const;
+        void appendPath(uint32_t target, std::vector<uint32_t>& vertices) const;  // Forward runs only
+
+    private:
+        ClusterBox box = { 0, 0, 0, 0 };
+        int gridWidth = 0;
+        uint32_t source = 0;
+        std::vector<float> costs;
+        std::vector<uint8_t> parents;
+        std::vector<std::pair<float, uint32_t>> heap;
+    };
+
+    ClusterBox getClusterBox(uint32_t cluster) const;
+    uint32_t getClusterAt(uint32_t vertex) const;
+    uint64_t hashCluster(const std::vector<float>& heights, uint32_t cluster) const;
+    void createNodes();
+    void buildCluster(const RoutePlanner& planner, uint32_t cluster, LocalSearch& search);
+
+    int clusterSize;
+    int entranceSpacing;
+
+    // Grid and cost model the hierarchy was built for; any change rebuilds everything
+    int width;
+    int depth;
+    float cellSize;
+    float maxGrade;
+    int connectivity;
+    int clustersX;
+    int clustersZ;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> clusterNodeOffsets;  // Nodes of cluster c are clusterNodes[offsets[c] .. offsets[c + 1])
+    std::vector<uint32_t> clusterNodes;
+    std::vector<uint32_t> nodeSlots;           // Position of each node within its cluster's list
+    std::vector<size_t> costOffsets;           // Start of each cluster's k x k matrix in intraCosts
+    std::vector<float> intraCosts;             // intraCosts[offset + i * k + j] = time from node i to node j
+    std::vector<uint64_t> clusterHashes;
+
+    // Per-query scratch
+    std::vector<float> nodeCosts;
+    std::vector<int32_t> nodeParents;
+    std::vector<uint64_t> nodeClosed;
+    LocalSearch startSearch;
+    LocalSearch goalSearch;
+    LocalSearch refineSearch;
+};
+
+#endif // ROUTE_HIERARCHY_H
@@ -0,0 +1,491 @@
+// RoutePlanner.cpp
+
+#include "RoutePlanner.h"
+#include "Terrain.h"
+#include "RouteStats.h"
+#include "FractalNoise.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+
+namespace {
+    constexpr uint8_t NO_PARENT = 0xFF;
+
+    // Pace lookup over grades in [-PACE_TABLE_GRADE, PACE_TABLE_GRADE], the widest grade limit
+    constexpr float PACE_TABLE_GRADE = 4.0f;
+    constexpr int PACE_TABLE_STEPS = 1024;  // Entries per unit of grade
+    constexpr float DEFAULT_MAX_GRADE = PACE_TABLE_GRADE;  // Only cliffs; 8-bit heightmaps make even gentle slopes step steeply
+
+    // Landmarks sit on the border, the corners first, then the edge midpoints; every vertex stores a
+    // time from and to each. Large grids get only the corners, or none, to stay within the budget.
+    constexpr int MAX_LANDMARKS = 8;
+    constexpr int LANDMARK_X_EIGHTHS[MAX_LANDMARKS] = { 0, 8, 8, 0, 4, 8, 4, 0 };
+    constexpr int LANDMARK_Z_EIGHTHS[MAX_LANDMARKS] = { 0, 0, 8, 8, 0, 4, 8, 4 };
+    constexpr size_t MAX_LANDMARK_BYTES = size_t(128) << 20;
+
+    constexpr int BENCHMARK_SIZES[] = { 2048, 4096 };
+    constexpr float BENCHMARK_HEIGHT_SCALE = 500.0f;
+}
+
+void RoutePlanner::OpenSet::clear() {
+    for (auto& bucket : buckets) bucket.clear();
+    last = 0;
+    size = 0;
+}
+
+bool RoutePlanner::OpenSet::empty() const {
+    return size == 0;
+}
+
+int RoutePlanner::OpenSet::bucketIndex(uint32_t key, uint32_t lastKey) {
+    return key == lastKey ? 0 : 32 - std::countl_zero(key ^ lastKey);
+}
+
+void RoutePlanner::OpenSet::push(float priority, uint32_t vertex) {
+    // Rounding can put a priority a hair below the last pop; the heap needs them monotonic
+    uint32_t key = std::max(std::bit_cast<uint32_t>(priority), last);
+    buckets[bucketIndex(key, last)].push_back({ key, vertex });
+    ++size;
+}
+
+uint32_t RoutePlanner::OpenSet::pop() {
+    if (buckets[0].empty()) {
+        // Lowest non-empty bucket: its minimum becomes the new last and the rest spread out below
+        int index = 1;
+        while (buckets[index].empty()) ++index;
+
+        std::vector<Entry>& bucket = buckets[index];
+        last = bucket[0].key;
+        for (const Entry& entry : bucket) {
+            last = std::min(last, entry.key);
+        }
+        for (const Entry& entry : bucket) {
+            buckets[bucketIndex(entry.key, last)].push_back(entry);
+        }
+        bucket.clear();
+    }
+
+    uint32_t vertex = buckets[0].back().vertex;
+    buckets[0].pop_back();
+    --size;
+    return vertex;
+}
+
+RoutePlanner::RoutePlanner()
+    : width(0), depth(0), cellSize(1.0f), origin(0.0f), connectivity(Connectivity::SIXTEEN),
+    maxGrade(0.0f), maxClimbRate(0.0f), maxDescentRate(0.0f), landmarkCount(0), landmarksValid(false) {
+    paceTable.resize(static_cast<size_t>(2.0f * PACE_TABLE_GRADE * PACE_TABLE_STEPS) + 1);
+    for (size_t i = 0; i < paceTable.size(); ++i) {
+        float grade = static_cast<float>(i) / PACE_TABLE_STEPS - PACE_TABLE_GRADE;
+        paceTable[i] = 1.0f / RouteStats::hikingSpeed(grade);
+    }
+    setMaxGrade(DEFAULT_MAX_GRADE);
+}
+
+void RoutePlanner::setMaxGrade(float grade) {
+    maxGrade = glm::clamp(grade, 1.0f / PACE_TABLE_STEPS, PACE_TABLE_GRADE);
+    landmarksValid = false;
+
+    // Fastest height change any walkable edge allows, for the vertical part of the heuristic
+    maxClimbRate = 0.0f;
+    maxDescentRate = 0.0f;
+    int steps = static_cast<int>(maxGrade * PACE_TABLE_STEPS);
+    int zero = static_cast<int>(PACE_TABLE_GRADE * PACE_TABLE_STEPS);
+    for (int i = 1; i <= steps; ++i) {
+        float grade = static_cast<float>(i) / PACE_TABLE_STEPS;
+        maxClimbRate = std::max(maxClimbRate, grade / paceTable[zero + i]);
+        maxDescentRate = std::max(maxDescentRate, grade / paceTable[zero - i]);
+    }
+}
+
+void RoutePlanner::setGrid(const std::vector<float>& gridHeights, int gridWidth, int gridDepth, float gridCellSize,
+    const glm::vec2& gridOrigin) {
+    // Callers refresh the grid before every plan, so unchanged heights must not cost the landmarks
+    origin = gridOrigin;
+    if (gridWidth == width && gridDepth == depth && gridCellSize == cellSize && gridHeights == heights) return;
+    landmarksValid = false;
+    landmarkTimes.clear();
+
+    heights = gridHeights;
+    width = gridWidth;
+    depth = gridDepth;
+    cellSize = gridCellSize;
+
+    size_t vertexCount = static_cast<size_t>(width) * depth;
+    costs.assign(vertexCount, 0.0f);
+    parents.assign(vertexCount, NO_PARENT);
+    closed.assign((vertexCount + 63) / 64, 0);
+    open.clear();
+}
+
+void RoutePlanner::setTerrain(const Terrain& terrain) {
+    // Same placement as the terrain mesh, which is centred on the origin
+    float scale = terrain.getHorizontalScale();
+    glm::vec2 gridOrigin(-terrain.getWidth() * scale * 0.5f, -terrain.getHeight() * scale * 0.5f);
+    setGrid(terrain.getHeights(), terrain.getWidth(), terrain.getHeight(), scale, gridOrigin);
+}
+
+void RoutePlanner::setConnectivity(Connectivity mode) {
+    if (mode != connectivity) landmarksValid = false;
+    connectivity = mode;
+}
+
+bool RoutePlanner::isEmpty() const {
+    return heights.empty();
+}
+
+uint32_t RoutePlanner::snapToGrid(const glm::vec3& position) const {
+    int x = static_cast<int>(std::lround((position.x - origin.x) / cellSize));
+    int z = static_cast<int>(std::lround((position.z - origin.y) / cellSize));
+    x = glm::clamp(x, 0, width - 1);
+    z = glm::clamp(z, 0, depth - 1);
+    return static_cast<uint32_t>(z * width + x);
+}
+
+int RoutePlanner::getWidth() const {
+    return width;
+}
+
+int RoutePlanner::getDepth() const {
+    return depth;
+}
+
+float RoutePlanner::getCellSize() const {
+    return cellSize;
+}
+
+const std::vector<float>& RoutePlanner::getHeights() const {
+    return heights;
+}
+
+RoutePlanner::Connectivity RoutePlanner::getConnectivity() const {
+    return connectivity;
+}
+
+float RoutePlanner::getMaxGrade() const {
+    return maxGrade;
+}
+
+glm::vec3 RoutePlanner::getVertexPosition(uint32_t vertex) const {
+    int z = static_cast<int>(vertex / width);
+    int x = static_cast<int>(vertex) - z * width;
+    return glm::vec3(origin.x + x * cellSize, heights[vertex], origin.y + z * cellSize);
+}
+
+float RoutePlanner::edgeTime(float run, float rise) const {
+    // Same lookup and limit test as the inner loop of plan
+    float offset = PACE_TABLE_GRADE * PACE_TABLE_STEPS + 0.5f;
+    float index = rise / run * PACE_TABLE_STEPS + offset;
+    if (index < offset - maxGrade * PACE_TABLE_STEPS || index > offset + maxGrade * PACE_TABLE_STEPS) {
+        return std::numeric_limits<float>::infinity();
+    }
+    return run * paceTable[static_cast<size_t>(index)];
+}
+
+float RoutePlanner::estimateTime(uint32_t from, uint32_t to) const {
+    glm::vec3 a = getVertexPosition(from);
+    glm::vec3 b = getVertexPosition(to);
+    float flat = glm::length(glm::vec2(b.x - a.x, b.z - a.z)) / RouteStats::hikingSpeed(-0.05f);
+    float vertical = std::max((b.y - a.y) / maxClimbRate, (a.y - b.y) / maxDescentRate);
+    float estimate = std::max(flat, vertical);
+    if (landmarksValid) estimate = std::max(estimate, landmarkBound(from, to));
+    return estimate;
+}
+
+float RoutePlanner::landmarkBound(uint32_t from, uint32_t to) const {
+    // Triangle inequality through each landmark L: time(from, to) >= time(L, to) - time(L, from) and
+    // time(from, L) - time(to, L). Unreachable pairs give infinity or NaN, which std::max skips.
+    const size_t stride = static_cast<size_t>(2 * landmarkCount);
+    const float* a = &landmarkTimes[from * stride];
+    const float* b = &landmarkTimes[to * stride];
+    float bound = 0.0f;
+    for (int k = 0; k < landmarkCount; ++k) {
+        bound = std::max(bound, b[k] - a[k]);
+        bound = std::max(bound, a[landmarkCount + k] - b[landmarkCount + k]);
+    }
+    return bound;
+}
+
+void RoutePlanner::searchAll(uint32_t source, bool reverse, std::vector<float>& times, OpenSet& queue,
+    std::vector<uint64_t>& done) const {
+    const size_t vertexCount = static_cast<size_t>(width) * depth;
+    const int neighbourCount = static_cast<int>(connectivity);
+
+    // Same per-neighbour constants and pace lookup as plan, so the tables match its edge costs exactly
+    long long neighbourStep[16];
+    float neighbourRun[16];
+    float neighbourGradeScale[16];
+    for (int n = 0; n < neighbourCount; ++n) {
+        neighbourStep[n] = static_cast<long long>(NEIGHBOUR_Z[n]) * width + NEIGHBOUR_X[n];
+        neighbourRun[n] = cellSize * std::sqrt(static_cast<float>(NEIGHBOUR_X[n] * NEIGHBOUR_X[n] + NEIGHBOUR_Z[n] * NEIGHBOUR_Z[n]));
+        neighbourGradeScale[n] = PACE_TABLE_STEPS / neighbourRun[n];
+    }
+    const float paceOffset = PACE_TABLE_GRADE * PACE_TABLE_STEPS + 0.5f;
+    const float paceFirst = paceOffset - maxGrade * PACE_TABLE_STEPS;
+    const float paceLast = paceOffset + maxGrade * PACE_TABLE_STEPS;
+    const float* pace = paceTable.data();
+
+    times.assign(vertexCount, std::numeric_limits<float>::infinity());
+    done.assign((vertexCount + 63) / 64, 0);
+    queue.clear();
+    times[source] = 0.0f;
+    queue.push(0.0f, source);
+
+    while (!queue.empty()) {
+        uint32_t vertex = queue.pop();
+        uint64_t bit = uint64_t(1) << (vertex & 63);
+        if (done[vertex >> 6] & bit) continue;
+        done[vertex >> 6] |= bit;
+
+        const int z = static_cast<int>(vertex / width);
+        const int x = static_cast<int>(vertex) - z * width;
+        const float height = heights[vertex];
+        const float time = times[vertex];
+
+        const bool interior = x >= 2 && z >= 2 && x < width - 2 && z < depth - 2;
+        for (int n = 0; n < neighbourCount; ++n) {
+            int nx = x + NEIGHBOUR_X[n];
+            int nz = z + NEIGHBOUR_Z[n];
+            if (!interior && (nx < 0 || nz < 0 || nx >= width || nz >= depth)) continue;
+
+            // Searching backwards, the edge runs from the neighbour to this vertex
+            uint32_t neighbour = static_cast<uint32_t>(vertex + neighbourStep[n]);
+            float rise = reverse ? height - heights[neighbour] : heights[neighbour] - height;
+            float index = rise * neighbourGradeScale[n] + paceOffset;
+            if (index < paceFirst || index > paceLast) continue;
+
+            float candidate = time + neighbourRun[n] * pace[static_cast<size_t>(index)];
+            if (candidate < times[neighbour]) {
+                times[neighbour] = candidate;
+                queue.push(candidate, neighbour);
+            }
+        }
+    }
+}
+
+void RoutePlanner::prepareLandmarks() {
+    if (landmarksValid || heights.empty()) return;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    const size_t vertexCount = static_cast<size_t>(width) * depth;
+    // Fewer than the four corners leave whole sides of the map without a useful bound
+    landmarkCount = MAX_LANDMARKS;
+    while (landmarkCount >= 4 && vertexCount * 2 * landmarkCount * sizeof(float) > MAX_LANDMARK_BYTES) {
+        landmarkCount /= 2;
+    }
+    if (landmarkCount < 4) landmarkCount = 0;
+    landmarksValid = true;
+    if (landmarkCount == 0) {
+        landmarkTimes.clear();
+        std::cout << "INFO: Route planner grid too large for landmarks, planning with the flat bounds only." << std::endl;
+        return;
+    }
+
+    const size_t stride = static_cast<size_t>(2 * landmarkCount);
+    landmarkTimes.assign(vertexCount * stride, std::numeric_limits<float>::infinity());
+
+    // One full search per landmark and direction; slot s of every vertex holds search s
+    ThreadPool::getInstance().parallelFor(0, stride, [&](size_t begin, size_t end) {
+        OpenSet queue;
+        std::vector<float> times;
+        std::vector<uint64_t> done;
+        for (size_t search = begin; search < end; ++search) {
+            int landmark = static_cast<int>(search % landmarkCount);
+            int x = LANDMARK_X_EIGHTHS[landmark] * (width - 1) / 8;
+            int z = LANDMARK_Z_EIGHTHS[landmark] * (depth - 1) / 8;
+            searchAll(static_cast<uint32_t>(z * width + x), search >= static_cast<size_t>(landmarkCount), times, queue, done);
+
+            float* slot = landmarkTimes.data() + search;
+            for (size_t v = 0; v < vertexCount; ++v) {
+                slot[v * stride] = times[v];
+            }
+        }
+    });
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    std::cout << "INFO: Route planner: " << landmarkCount << " landmarks ready in "
+        << std::chrono::duration<double, std::milli>(endTime - startTime).count() << " ms, "
+        << landmarkTimes.size() * sizeof(float) / (1024 * 1024) << " MB." << std::endl;
+}
+
+RoutePlanner::Result RoutePlanner::plan(const glm::vec3& start, const glm::vec3& goal) {
+    Result result;
+    if (heights.empty()) return result;
+    prepareLandmarks();
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    const uint32_t startVertex = snapToGrid(start);
+    const uint32_t goalVertex = snapToGrid(goal);
+    const int goalX = static_cast<int>(goalVertex % width);
+    const int goalZ = static_cast<int>(goalVertex / width);
+    const int neighbourCount = static_cast<int>(connectivity);
+
+    // Per-neighbour constants: index step, horizontal run and the factor from rise to pace table index
+    long long neighbourStep[16];
+    float neighbourRun[16];
+    float neighbourGradeScale[16];
+    for (int n = 0; n < neighbourCount; ++n) {
+        neighbourStep[n] = static_cast<long long>(NEIGHBOUR_Z[n]) * width + NEIGHBOUR_X[n];
+        neighbourRun[n] = cellSize * std::sqrt(static_cast<float>(NEIGHBOUR_X[n] * NEIGHBOUR_X[n] + NEIGHBOUR_Z[n] * NEIGHBOUR_Z[n]));
+        neighbourGradeScale[n] = PACE_TABLE_STEPS / neighbourRun[n];
+    }
+    const float paceOffset = PACE_TABLE_GRADE * PACE_TABLE_STEPS + 0.5f;
+    const float paceFirst = paceOffset - maxGrade * PACE_TABLE_STEPS;
+    const float paceLast = paceOffset + maxGrade * PACE_TABLE_STEPS;
+    const float* pace = paceTable.data();
+
+    // Neither the straight-line distance at the fastest pace nor the height left to climb or
+    // descend at the fastest vertical rate overestimates the remaining time, so neither does their
+    // maximum; each only grows by at most an edge's cost per edge, which keeps A* consistent.
+    // The landmark bounds are consistent too and do most of the work on steep terrain.
+    const float fastestPace = 1.0f / RouteStats::hikingSpeed(-0.05f);
+    const float goalHeight = heights[goalVertex];
+    const float climbPace = 1.0f / maxClimbRate;
+    const float descentPace = 1.0f / maxDescentRate;
+    const int landmarks = landmarkCount;
+    const size_t landmarkStride = static_cast<size_t>(2 * landmarks);
+    const float* goalTimes = landmarks > 0 ? &landmarkTimes[goalVertex * landmarkStride] : nullptr;
+    auto heuristic = [&](uint32_t vertex, int x, int z, float height) {
+        float dx = static_cast<float>(x - goalX);
+        float dz = static_cast<float>(z - goalZ);
+        float flat = std::sqrt(dx * dx + dz * dz) * cellSize * fastestPace;
+        float vertical = std::max((goalHeight - height) * climbPace, (height - goalHeight) * descentPace);
+        float estimate = std::max(flat, vertical);
+
+        if (landmarks == 0) return estimate;
+        const float* times = &landmarkTimes[vertex * landmarkStride];
+        for (int k = 0; k < landmarks; ++k) {
+            estimate = std::max(estimate, goalTimes[k] - times[k]);
+            estimate = std::max(estimate, times[landmarks + k] - goalTimes[landmarks + k]);
+        }
+        return estimate;
+    };
+
+    std::fill(costs.begin(), costs.end(), std::numeric_limits<float>::infinity());
+    std::fill(parents.begin(), parents.end(), NO_PARENT);
+    std::fill(closed.begin(), closed.end(), 0);
+    open.clear();
+
+    costs[startVertex] = 0.0f;
+    open.push(heuristic(startVertex, static_cast<int>(startVertex % width), static_cast<int>(startVertex / width), heights[startVertex]), startVertex);
+
+    while (!open.empty()) {
+        uint32_t vertex = open.pop();
+
+        // Entries are never decreased in place, a vertex may still be queued from before it was improved
+        uint64_t bit = uint64_t(1) << (vertex & 63);
+        if (closed[vertex >> 6] & bit) continue;
+        closed[vertex >> 6] |= bit;
+        ++result.expanded;
+
+        if (vertex == goalVertex) {
+            result.found = true;
+            break;
+        }
+
+        const int z = static_cast<int>(vertex / width);
+        const int x = static_cast<int>(vertex) - z * width;
+        const float height = heights[vertex];
+        const float cost = costs[vertex];
+
+        // Vertices two cells from the border can skip the bounds test for every neighbour
+        const bool interior = x >= 2 && z >= 2 && x < width - 2 && z < depth - 2;
+        for (int n = 0; n < neighbourCount; ++n) {
+            int nx = x + NEIGHBOUR_X[n];
+            int nz = z + NEIGHBOUR_Z[n];
+            if (!interior && (nx < 0 || nz < 0 || nx >= width || nz >= depth)) continue;
+
+            // Closed neighbours need no test: with a consistent heuristic their cost is already final
+            uint32_t neighbour = static_cast<uint32_t>(vertex + neighbourStep[n]);
+            // Edges steeper than the grade limit are not walkable
+            float neighbourHeight = heights[neighbour];
+            float index = (neighbourHeight - height) * neighbourGradeScale[n] + paceOffset;
+            if (index < paceFirst || index > paceLast) continue;
+
+            float candidate = cost + neighbourRun[n] * pace[static_cast<size_t>(index)];
+            if (candidate < costs[neighbour]) {
+                costs[neighbour] = candidate;
+                parents[neighbour] = static_cast<uint8_t>(n);
+                open.push(candidate + heuristic(neighbour, nx, nz, neighbourHeight), neighbour);
+            }
+        }
+    }
+
+    if (result.found) {
+        // Walk the parent directions back from the goal
+        for (uint32_t vertex = goalVertex; ; ) {
+            int x = static_cast<int>(vertex % width);
+            int z = static_cast<int>(vertex / width);
+            result.points.push_back(glm::vec3(origin.x + x * cellSize, heights[vertex], origin.y + z * cellSize));
+            if (vertex == startVertex) break;
+            vertex = static_cast<uint32_t>(vertex - neighbourStep[parents[vertex]]);
+        }
+        std::reverse(result.points.begin(), result.points.end());
+        result.duration = costs[goalVertex];
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    result.milliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    return result;
+}
+
+void RoutePlanner::timePlans(size_t planCount, const char* label) {
+    if (heights.empty() || planCount == 0) return;
+
+    // Built once per grid, reported on its own instead of inflating the first plan
+    prepareLandmarks();
+
+    // The first plan crosses the whole grid, the rest join random vertex pairs
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> randomX(0, width - 1);
+    std::uniform_int_distribution<int> randomZ(0, depth - 1);
+    auto vertexPosition = [&](int x, int z) {
+        return glm::vec3(origin.x + x * cellSize, 0.0f, origin.y + z * cellSize);
+    };
+
+    double totalMilliseconds = 0.0;
+    double worstMilliseconds = 0.0;
+    size_t totalExpanded = 0;
+    for (size_t i = 0; i < planCount; ++i) {
+        glm::vec3 start = i == 0 ? vertexPosition(0, 0) : vertexPosition(randomX(random), randomZ(random));
+        glm::vec3 goal = i == 0 ? vertexPosition(width - 1, depth - 1) : vertexPosition(randomX(random), randomZ(random));
+        Result result = plan(start, goal);
+        totalMilliseconds += result.milliseconds;
+        worstMilliseconds = std::max(worstMilliseconds, result.milliseconds);
+        totalExpanded += result.expanded;
+    }
+
+    std::cout << "INFO: Route planner on " << label << " " << width << " x " << depth << ": "
+        << totalMilliseconds / planCount << " ms mean, " << worstMilliseconds << " ms worst, "
+        << totalExpanded / planCount << " vertices expanded per plan." << std::endl;
+}
+
+void RoutePlanner::benchmark(size_t plansPerGrid) {
+    timePlans(plansPerGrid, "terrain");
+
+    // Fractal DEMs with the terrain's vertical range, planned with the same settings
+    for (int size : BENCHMARK_SIZES) {
+        FractalNoise::Parameters params;
+        params.frequency = 4.0f / size;
+        FractalNoise noise(params);
+
+        std::vector<float> dem(static_cast<size_t>(size) * size);
+        for (int z = 0; z < size; ++z) {
+            float* row = &dem[static_cast<size_t>(z) * size];
+            noise.sampleRow(0.0f, static_cast<float>(z), 1.0f, size, row);
+            for (int x = 0; x < size; ++x) {
+                row[x] = (row[x] * 0.5f + 0.5f) * BENCHMARK_HEIGHT_SCALE;
+            }
+        }
+
+        RoutePlanner planner;
+        planner.setConnectivity(connectivity);
+        planner.setGrid(dem, size, size, cellSize, glm::vec2(0.0f));
+        planner.timePlans(plansPerGrid, "fractal DEM");
+    }
+}
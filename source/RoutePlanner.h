@@ -0,0 +1,132 @@
+// RoutePlanner.h
+
+#ifndef ROUTE_PLANNER_H
+#define ROUTE_PLANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+class Terrain;
+
+// Least-time routes over a heightmap grid. A* runs on the grid vertices with 8 or 16 neighbours
+// (16 adds the knight moves, which removes most of the 45-degree zigzag), and an edge costs its
+// walking time at Tobler's hiking speed for the edge's grade. The open set is a radix heap of
+// 8-byte entries and the closed set one bit per vertex, so even large DEMs stay compact.
+// The heuristic adds landmark (ALT) bounds: exact walking times from and to a few border vertices,
+// which on steep terrain come far closer to the real remaining time than any flat-pace bound.
+class RoutePlanner {
+public:
+    enum class Connectivity {
+        EIGHT = 8,
+        SIXTEEN = 16
+    };
+
+    struct Result {
+        std::vector<glm::vec3> points;  // World-space grid vertices from start to goal, heights from the grid
+        double duration = 0.0;          // Walking time in seconds
+        size_t expanded = 0;            // Vertices taken from the open set
+        double milliseconds = 0.0;
+        bool found = false;
+    };
+
+    // Neighbour offsets: the 8 adjacent vertices first, then the 8 knight moves
+    static constexpr int NEIGHBOUR_X[16] = { 1, 1, 0, -1, -1, -1, 0, 1,   2, 1, -1, -2, -2, -1, 1, 2 };
+    static constexpr int NEIGHBOUR_Z[16] = { 0, 1, 1, 1, 0, -1, -1, -1,   1, 2, 2, 1, -1, -2, -2, -1 };
+
+    RoutePlanner();
+
+    // Copies the heights; world x of column i is origin.x + i * cellSize, likewise for z
+    void setGrid(const std::vector<float>& heights, int width, int depth, float cellSize, const glm::vec2& origin);
+    void setTerrain(const Terrain& terrain);
+    void setConnectivity(Connectivity connectivity);
+
+    // Edges steeper than this, rise over run either way, are impassable
+    void setMaxGrade(float grade);
+
+    // Start and goal snap to the closest grid vertex
+    Result plan(const glm::vec3& start, const glm::vec3& goal);
+
+    bool isEmpty() const;
+
+    // Grid and cost model, shared with searches layered on top such as RouteHierarchy
+    int getWidth() const;
+    int getDepth() const;
+    float getCellSize() const;
+    const std::vector<float>& getHeights() const;
+    Connectivity getConnectivity() const;
+    float getMaxGrade() const;
+    uint32_t snapToGrid(const glm::vec3& position) const;
+    glm::vec3 getVertexPosition(uint32_t vertex) const;
+
+    // Walking time in seconds over one edge, infinity beyond the grade limit
+    float edgeTime(float run, float rise) const;
+
+    // Lower bound on the walking time between two vertices, the same one plan uses as its heuristic;
+    // includes the landmark bounds once they are prepared
+    float estimateTime(uint32_t from, uint32_t to) const;
+
+    // Builds the landmark tables with full searches on the thread pool, unless they are current.
+    // plan calls it, so the first plan after the heights or cost model changed pays for it;
+    // setGrid with unchanged heights keeps the tables.
+    void prepareLandmarks();
+
+    // Times corner-to-corner and random plans on the current grid, then on fractal DEMs of growing size
+    void benchmark(size_t plansPerGrid);
+
+private:
+    // Radix heap over the bit patterns of non-negative float priorities, which sort like the
+    // floats themselves. A* with a consistent heuristic pops priorities in increasing order, so
+    // each entry only moves to lower buckets: pushes are O(1) and pops amortised O(log range).
+    class OpenSet {
+    public:
+        void clear();
+        bool empty() const;
+        void push(float priority, uint32_t vertex);
+        uint32_t pop();
+
+    private:
+        struct Entry {
+            uint32_t key;     // Bits of the priority
+            uint32_t vertex;
+        };
+
+        static int bucketIndex(uint32_t key, uint32_t last);
+
+        std::vector<Entry> buckets[33];  // Bucket b holds keys whose highest bit differing from last is b - 1
+        uint32_t last = 0;               // Key of the most recent pop
+        size_t size = 0;
+    };
+
+    void timePlans(size_t planCount, const char* label);
+
+    // Walking times from source to every vertex, or from every vertex to source when reverse
+    void searchAll(uint32_t source, bool reverse, std::vector<float>& times, OpenSet& queue,
+        std::vector<uint64_t>& done) const;
+    float landmarkBound(uint32_t from, uint32_t to) const;
+
+    std::vector<float> heights;
+    int width;
+    int depth;
+    float cellSize;
+    glm::vec2 origin;
+    Connectivity connectivity;
+    float maxGrade;
+    float maxClimbRate;     // Metres per second, the best any walkable grade achieves
+    float maxDescentRate;
+
+    // Per-plan scratch, kept between plans to avoid reallocating
+    std::vector<float> costs;           // Best known time from the start
+    std::vector<uint8_t> parents;       // Neighbour index the vertex was reached through
+    std::vector<uint64_t> closed;       // One bit per vertex
+    OpenSet open;
+    std::vector<float> paceTable;       // Seconds per metre of run, indexed by grade
+
+    // Per vertex: the times from each landmark, then the times to each landmark
+    std::vector<float> landmarkTimes;
+    int landmarkCount;                  // 0 when the grid is too large for the memory budget
+    bool landmarksValid;
+};
+
+#endif // ROUTE_PLANNER_H
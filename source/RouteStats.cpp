@@ -0,0 +1,340 @@
+// RouteStats.cpp
+
+#include "RouteStats.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ROUTE_STATS_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    constexpr size_t SEGMENT_CHUNK = 65536;   // Segments per parallel task
+    constexpr size_t TABLE_BLOCK = 64;        // Values per block of the range-maximum tables
+    constexpr float FLAT_RUN = 1e-4f;         // Shorter horizontal runs count as flat instead of dividing by ~0
+    constexpr float MIN_HIKING_SPEED = 0.05f; // Metres per second, keeps near-vertical steps from taking forever
+
+    struct ChunkTotals {
+        double distance = 0.0;
+        double ascent = 0.0;
+        double descent = 0.0;
+        double duration = 0.0;
+    };
+
+    // Horizontal length, rise and grade of segments [begin, end), plus their sums
+    void measureSegments(const float* xs, const float* ys, const float* zs, size_t begin, size_t end,
+        float* lengths, float* rises, float* grades, ChunkTotals& totals) {
+        size_t i = begin;
+
+#ifdef ROUTE_STATS_SSE
+        // Four segments at a time; point i + 1 is the same arrays read one float further
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 flatRun = _mm_set1_ps(FLAT_RUN);
+        __m128 distanceSum = zero;
+        __m128 ascentSum = zero;
+        __m128 descentSum = zero;
+
+        for (; i + 4 <= end; i += 4) {
+            __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i + 1), _mm_loadu_ps(xs + i));
+            __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i + 1), _mm_loadu_ps(ys + i));
+            __m128 dz = _mm_sub_ps(_mm_loadu_ps(zs + i + 1), _mm_loadu_ps(zs + i));
+
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)));
+            __m128 sloped = _mm_cmpgt_ps(length, flatRun);
+            __m128 grade = _mm_and_ps(sloped, _mm_div_ps(dy, _mm_max_ps(length, flatRun)));
+
+            _mm_storeu_ps(lengths + i, length);
+            _mm_storeu_ps(rises + i, dy);
+            _mm_storeu_ps(grades + i, grade);
+
+            distanceSum = _mm_add_ps(distanceSum, length);
+            ascentSum = _mm_add_ps(ascentSum, _mm_max_ps(dy, zero));
+            descentSum = _mm_add_ps(descentSum, _mm_max_ps(_mm_sub_ps(zero, dy), zero));
+        }
+
+        float lanes[4];
+        _mm_storeu_ps(lanes, distanceSum);
+        totals.distance += static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+        _mm_storeu_ps(lanes, ascentSum);
+        totals.ascent += static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+        _mm_storeu_ps(lanes, descentSum);
+        totals.descent += static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+        // Scalar tail, or everything without SSE
+        for (; i < end; ++i) {
+            float dx = xs[i + 1] - xs[i];
+            float dy = ys[i + 1] - ys[i];
+            float dz = zs[i + 1] - zs[i];
+            float length = std::sqrt(dx * dx + dz * dz);
+
+            lengths[i] = length;
+            rises[i] = dy;
+            grades[i] = length > FLAT_RUN ? dy / length : 0.0f;
+
+            totals.distance += length;
+            totals.ascent += std::max(dy, 0.0f);
+            totals.descent += std::max(-dy, 0.0f);
+        }
+    }
+}
+
+RouteStats::RouteStats() {
+}
+
+void RouteStats::clear() {
+    elevations.clear();
+    grades.clear();
+    cumulativeDistance.clear();
+    cumulativeAscent.clear();
+    cumulativeDescent.clear();
+    cumulativeDuration.clear();
+    maxGradeTable = BlockMaxTable();
+    minGradeTable = BlockMaxTable();
+    maxElevationTable = BlockMaxTable();
+    minElevationTable = BlockMaxTable();
+    profile.clear();
+}
+
+float RouteStats::hikingSpeed(float grade) {
+    // 6 km/h at a slight descent, falling off exponentially both ways
+    return std::max(6.0f * std::exp(-3.5f * std::abs(grade + 0.05f)) / 3.6f, MIN_HIKING_SPEED);
+}
+
+void RouteStats::compute(const std::vector<glm::vec3>& points, size_t profileSamples) {
+    clear();
+    const size_t count = points.size();
+    if (count == 0) return;
+
+    const size_t segmentCount = count - 1;
+    const size_t chunkCount = (segmentCount + SEGMENT_CHUNK - 1) / SEGMENT_CHUNK;
+    ThreadPool& pool = ThreadPool::getInstance();
+
+    // Split the points into coordinate arrays so four segments load with three unaligned reads
+    std::vector<float> xs(count), zs(count);
+    elevations.resize(count);
+    pool.parallelFor(0, count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            xs[i] = points[i].x;
+            elevations[i] = points[i].y;
+            zs[i] = points[i].z;
+        }
+    }, SEGMENT_CHUNK);
+
+    // Pass 1: per-segment values and per-chunk totals
+    std::vector<float> lengths(segmentCount), rises(segmentCount), durations(segmentCount);
+    grades.resize(segmentCount);
+    std::vector<ChunkTotals> chunkTotals(chunkCount);
+
+    pool.parallelFor(0, chunkCount, [&](size_t chunkBegin, size_t chunkEnd) {
+        for (size_t c = chunkBegin; c < chunkEnd; ++c) {
+            size_t begin = c * SEGMENT_CHUNK;
+            size_t end = std::min(begin + SEGMENT_CHUNK, segmentCount);
+            ChunkTotals& totals = chunkTotals[c];
+            measureSegments(xs.data(), elevations.data(), zs.data(), begin, end,
+                lengths.data(), rises.data(), grades.data(), totals);
+
+            // Walking time needs exp(), which has no SSE instruction
+            for (size_t i = begin; i < end; ++i) {
+                durations[i] = lengths[i] / hikingSpeed(grades[i]);
+                totals.duration += durations[i];
+            }
+        }
+    });
+
+    // Pass 2: exclusive scan over the chunk totals
+    std::vector<ChunkTotals> chunkBases(chunkCount);
+    for (size_t c = 1; c < chunkCount; ++c) {
+        chunkBases[c].distance = chunkBases[c - 1].distance + chunkTotals[c - 1].distance;
+        chunkBases[c].ascent = chunkBases[c - 1].ascent + chunkTotals[c - 1].ascent;
+        chunkBases[c].descent = chunkBases[c - 1].descent + chunkTotals[c - 1].descent;
+        chunkBases[c].duration = chunkBases[c - 1].duration + chunkTotals[c - 1].duration;
+    }
+
+    // Pass 3: prefix sums within each chunk, starting from its base
+    cumulativeDistance.resize(count);
+    cumulativeAscent.resize(count);
+    cumulativeDescent.resize(count);
+    cumulativeDuration.resize(count);
+    cumulativeDistance[0] = cumulativeAscent[0] = cumulativeDescent[0] = cumulativeDuration[0] = 0.0;
+
+    pool.parallelFor(0, chunkCount, [&](size_t chunkBegin, size_t chunkEnd) {
+        for (size_t c = chunkBegin; c < chunkEnd; ++c) {
+            size_t begin = c * SEGMENT_CHUNK;
+            size_t end = std::min(begin + SEGMENT_CHUNK, segmentCount);
+            ChunkTotals running = chunkBases[c];
+            for (size_t i = begin; i < end; ++i) {
+                running.distance += lengths[i];
+                running.ascent += std::max(rises[i], 0.0f);
+                running.descent += std::max(-rises[i], 0.0f);
+                running.duration += durations[i];
+                cumulativeDistance[i + 1] = running.distance;
+                cumulativeAscent[i + 1] = running.ascent;
+                cumulativeDescent[i + 1] = running.descent;
+                cumulativeDuration[i + 1] = running.duration;
+            }
+        }
+    });
+
+    maxGradeTable.build(grades, 1.0f);
+    minGradeTable.build(grades, -1.0f);
+    maxElevationTable.build(elevations, 1.0f);
+    minElevationTable.build(elevations, -1.0f);
+
+    buildProfile(profileSamples);
+}
+
+void RouteStats::BlockMaxTable::build(const std::vector<float>& values, float tableSign) {
+    sign = tableSign;
+    levels.clear();
+    if (values.empty()) return;
+
+    size_t blockCount = (values.size() + TABLE_BLOCK - 1) / TABLE_BLOCK;
+    levels.emplace_back(blockCount);
+    for (size_t b = 0; b < blockCount; ++b) {
+        size_t end = std::min((b + 1) * TABLE_BLOCK, values.size());
+        float best = -INFINITY;
+        for (size_t i = b * TABLE_BLOCK; i < end; ++i) best = std::max(best, sign * values[i]);
+        levels[0][b] = best;
+    }
+
+    for (size_t span = 2; span <= blockCount; span *= 2) {
+        const std::vector<float>& previous = levels.back();
+        std::vector<float> level(blockCount - span + 1);
+        for (size_t b = 0; b < level.size(); ++b) {
+            level[b] = std::max(previous[b], previous[b + span / 2]);
+        }
+        levels.push_back(std::move(level));
+    }
+}
+
+float RouteStats::BlockMaxTable::query(const std::vector<float>& values, size_t first, size_t last) const {
+    size_t firstBlock = first / TABLE_BLOCK;
+    size_t lastBlock = last / TABLE_BLOCK;
+    float best = -INFINITY;
+
+    if (firstBlock == lastBlock) {
+        for (size_t i = first; i <= last; ++i) best = std::max(best, sign * values[i]);
+        return sign * best;
+    }
+
+    // Partial blocks at both ends, then two overlapping power-of-two spans over the whole blocks between
+    for (size_t i = first; i < (firstBlock + 1) * TABLE_BLOCK; ++i) best = std::max(best, sign * values[i]);
+    for (size_t i = lastBlock * TABLE_BLOCK; i <= last; ++i) best = std::max(best, sign * values[i]);
+
+    if (lastBlock > firstBlock + 1) {
+        size_t lo = firstBlock + 1;
+        size_t blocks = lastBlock - lo;
+        size_t k = 0;
+        while ((size_t(2) << k) <= blocks) ++k;
+        best = std::max(best, std::max(levels[k][lo], levels[k][lastBlock - (size_t(1) << k)]));
+    }
+    return sign * best;
+}
+
+void RouteStats::buildProfile(size_t sampleCount) {
+    const size_t count = elevations.size();
+    sampleCount = std::clamp<size_t>(sampleCount, 1, count);
+    profile.resize(sampleCount);
+
+    const double total = cumulativeDistance.back();
+    ThreadPool::getInstance().parallelFor(0, sampleCount, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) {
+            double from = total * static_cast<double>(b) / static_cast<double>(sampleCount);
+            double to = total * static_cast<double>(b + 1) / static_cast<double>(sampleCount);
+            double centre = 0.5 * (from + to);
+
+            // Elevation at the bin centre, interpolated on the segment that contains it
+            size_t segment = static_cast<size_t>(std::upper_bound(cumulativeDistance.begin(), cumulativeDistance.end(), centre)
+                - cumulativeDistance.begin());
+            segment = std::clamp<size_t>(segment, 1, count) - 1;
+            float elevation = elevations[segment];
+            if (segment + 1 < count) {
+                double length = cumulativeDistance[segment + 1] - cumulativeDistance[segment];
+                float t = length > 0.0 ? static_cast<float>((centre - cumulativeDistance[segment]) / length) : 0.0f;
+                elevation = glm::mix(elevations[segment], elevations[segment + 1], glm::clamp(t, 0.0f, 1.0f));
+            }
+
+            ProfileSample& sample = profile[b];
+            sample.distance = static_cast<float>(centre);
+            sample.elevation = elevation;
+            sample.minElevation = elevation;
+            sample.maxElevation = elevation;
+
+            // Extremes of the points inside the bin, so narrow peaks survive the downsampling
+            auto first = std::lower_bound(cumulativeDistance.begin(), cumulativeDistance.end(), from);
+            auto last = std::upper_bound(first, cumulativeDistance.end(), to);
+            for (auto it = first; it != last; ++it) {
+                float value = elevations[it - cumulativeDistance.begin()];
+                sample.minElevation = std::min(sample.minElevation, value);
+                sample.maxElevation = std::max(sample.maxElevation, value);
+            }
+        }
+    }, 16);
+}
+
+bool RouteStats::isEmpty() const {
+    return elevations.empty();
+}
+
+size_t RouteStats::getPointCount() const {
+    return elevations.size();
+}
+
+RouteStats::Summary RouteStats::getSummary() const {
+    return isEmpty() ? Summary() : getRange(0, elevations.size() - 1);
+}
+
+RouteStats::Summary RouteStats::getRange(size_t first, size_t last) const {
+    Summary summary;
+    if (isEmpty()) return summary;
+
+    last = std::min(last, elevations.size() - 1);
+    first = std::min(first, last);
+
+    summary.distance = cumulativeDistance[last] - cumulativeDistance[first];
+    summary.ascent = cumulativeAscent[last] - cumulativeAscent[first];
+    summary.descent = cumulativeDescent[last] - cumulativeDescent[first];
+    summary.duration = cumulativeDuration[last] - cumulativeDuration[first];
+    summary.minElevation = minElevationTable.query(elevations, first, last);
+    summary.maxElevation = maxElevationTable.query(elevations, first, last);
+
+    // Segments first .. last - 1 lie between the two points
+    if (last > first) {
+        summary.maxGrade = maxGradeTable.query(grades, first, last - 1);
+        summary.minGrade = minGradeTable.query(grades, first, last - 1);
+    }
+    return summary;
+}
+
+double RouteStats::getCumulativeDistance(size_t index) const {
+    return cumulativeDistance.empty() ? 0.0 : cumulativeDistance[std::min(index, cumulativeDistance.size() - 1)];
+}
+
+double RouteStats::getCumulativeAscent(size_t index) const {
+    return cumulativeAscent.empty() ? 0.0 : cumulativeAscent[std::min(index, cumulativeAscent.size() - 1)];
+}
+
+double RouteStats::getCumulativeDescent(size_t index) const {
+    return cumulativeDescent.empty() ? 0.0 : cumulativeDescent[std::min(index, cumulativeDescent.size() - 1)];
+}
+
+const std::vector<RouteStats::ProfileSample>& RouteStats::getProfile() const {
+    return profile;
+}
+
+std::string RouteStats::format(const Summary& summary) {
+    int minutes = static_cast<int>(std::lround(summary.duration / 60.0));
+
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(2) << summary.distance / 1000.0 << " km, "
+        << std::setprecision(0) << "+" << summary.ascent << " m / -" << summary.descent << " m, "
+        << "max grade " << summary.maxGrade * 100.0f << "% / " << summary.minGrade * 100.0f << "%, "
+        << "elevation " << summary.minElevation << "-" << summary.maxElevation << " m, "
+        << minutes / 60 << " h " << std::setw(2) << std::setfill('0') << minutes % 60 << " min";
+    return text.str();
+}
@@ -0,0 +1,88 @@
+// RouteStats.h
+
+#ifndef ROUTE_STATS_H
+#define ROUTE_STATS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Distance, climb, grade and walking time of a draped route. One parallel, SSE-vectorized pass
+// turns the points into per-segment values and prefix sums, so the totals of any sub-range are
+// two lookups; extreme grades and elevations come from block sparse tables. World units are taken
+// as metres, distances are horizontal and grades are rise over horizontal run.
+class RouteStats {
+public:
+    struct Summary {
+        double distance = 0.0;
+        double ascent = 0.0;
+        double descent = 0.0;
+        double duration = 0.0;      // Seconds at Tobler's hiking speed
+        float maxGrade = 0.0f;      // Steepest climb, rise over run
+        float minGrade = 0.0f;      // Steepest descent, negative
+        float minElevation = 0.0f;
+        float maxElevation = 0.0f;
+    };
+
+    struct ProfileSample {
+        float distance = 0.0f;      // Centre of the bin along the route
+        float elevation = 0.0f;     // Interpolated at the bin centre
+        float minElevation = 0.0f;  // Extremes of the route inside the bin
+        float maxElevation = 0.0f;
+    };
+
+    RouteStats();
+
+    void compute(const std::vector<glm::vec3>& points, size_t profileSamples = 512);
+    void clear();
+
+    bool isEmpty() const;
+    size_t getPointCount() const;
+
+    Summary getSummary() const;
+
+    // Totals between points[first] and points[last], O(1) apart from the extremes
+    Summary getRange(size_t first, size_t last) const;
+
+    double getCumulativeDistance(size_t index) const;
+    double getCumulativeAscent(size_t index) const;
+    double getCumulativeDescent(size_t index) const;
+
+    // Elevation profile with a fixed number of bins over the route's distance
+    const std::vector<ProfileSample>& getProfile() const;
+
+    // Tobler's hiking function in metres per second, grade as rise over run
+    static float hikingSpeed(float grade);
+
+    // One line such as "12.4 km, +830 m / -610 m, max grade 31%, 4 h 05 min"
+    static std::string format(const Summary& summary);
+
+private:
+    // Range maximum over blocks of values; queries scan at most two partial blocks
+    struct BlockMaxTable {
+        std::vector<std::vector<float>> levels;   // levels[k][b] = max of blocks b .. b + 2^k - 1
+        float sign = 1.0f;                        // -1 turns it into a minimum table
+
+        void build(const std::vector<float>& values, float tableSign);
+        float query(const std::vector<float>& values, size_t first, size_t last) const;
+    };
+
+    void buildProfile(size_t sampleCount);
+
+    std::vector<float> elevations;          // Per point
+    std::vector<float> grades;              // Per segment
+    std::vector<double> cumulativeDistance; // Per point, from the start
+    std::vector<double> cumulativeAscent;
+    std::vector<double> cumulativeDescent;
+    std::vector<double> cumulativeDuration;
+
+    BlockMaxTable maxGradeTable;
+    BlockMaxTable minGradeTable;
+    BlockMaxTable maxElevationTable;
+    BlockMaxTable minElevationTable;
+
+    std::vector<ProfileSample> profile;
+};
+
+#endif // ROUTE_STATS_H
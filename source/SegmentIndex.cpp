@@ -0,0 +1,339 @@
+// SegmentIndex.cpp
+
+#include "SegmentIndex.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <random>
+
+namespace {
+    constexpr size_t SEGMENT_CHUNK = 16384;    // Segments per parallel task during the build
+    constexpr size_t MAX_CELLS_PER_SEGMENT = 4; // The automatic cell size keeps the grid at most this much larger than the input
+}
+
+SegmentIndex::SegmentIndex()
+    : origin(0.0f), cellSize(1.0f), inverseCellSize(1.0f), gridWidth(0), gridDepth(0) {
+}
+
+void SegmentIndex::clear() {
+    starts.clear();
+    ends.clear();
+    segmentPaths.clear();
+    segmentStartIndices.clear();
+    cellOffsets.clear();
+    cellSegments.clear();
+    gridWidth = 0;
+    gridDepth = 0;
+}
+
+void SegmentIndex::build(const std::vector<PathRef>& paths, float requestedCellSize) {
+    auto startTime = std::chrono::steady_clock::now();
+    clear();
+
+    // Global segment numbering: path p owns [pathOffsets[p], pathOffsets[p + 1])
+    std::vector<size_t> pathOffsets(paths.size() + 1, 0);
+    for (size_t p = 0; p < paths.size(); ++p) {
+        size_t segments = paths[p].count > 1 ? paths[p].count - 1 : 0;
+        pathOffsets[p + 1] = pathOffsets[p] + segments;
+    }
+    const size_t segmentCount = pathOffsets.back();
+    if (segmentCount == 0) return;
+
+    starts.resize(segmentCount);
+    ends.resize(segmentCount);
+    segmentPaths.resize(segmentCount);
+    segmentStartIndices.resize(segmentCount);
+
+    ThreadPool& pool = ThreadPool::getInstance();
+
+    // Flatten the paths and gather the bounds and total length per chunk
+    std::mutex boundsMutex;
+    glm::vec2 boundsMin(std::numeric_limits<float>::max());
+    glm::vec2 boundsMax(-std::numeric_limits<float>::max());
+    double totalLength = 0.0;
+
+    pool.parallelFor(0, segmentCount, [&](size_t begin, size_t end) {
+        glm::vec2 localMin(std::numeric_limits<float>::max());
+        glm::vec2 localMax(-std::numeric_limits<float>::max());
+        double localLength = 0.0;
+
+        size_t p = static_cast<size_t>(std::upper_bound(pathOffsets.begin(), pathOffsets.end(), begin) - pathOffsets.begin()) - 1;
+        for (size_t s = begin; s < end; ++s) {
+            while (s >= pathOffsets[p + 1]) ++p;
+            size_t local = s - pathOffsets[p];
+
+            const glm::vec3& a = paths[p].points[local];
+            const glm::vec3& b = paths[p].points[local + 1];
+            starts[s] = a;
+            ends[s] = b;
+            segmentPaths[s] = paths[p].pathId;
+            segmentStartIndices[s] = static_cast<uint32_t>(local);
+
+            localMin = glm::min(localMin, glm::min(glm::vec2(a.x, a.z), glm::vec2(b.x, b.z)));
+            localMax = glm::max(localMax, glm::max(glm::vec2(a.x, a.z), glm::vec2(b.x, b.z)));
+            localLength += glm::length(glm::vec2(b.x - a.x, b.z - a.z));
+        }
+
+        std::lock_guard<std::mutex> lock(boundsMutex);
+        boundsMin = glm::min(boundsMin, localMin);
+        boundsMax = glm::max(boundsMax, localMax);
+        totalLength += localLength;
+    }, SEGMENT_CHUNK);
+
+    // Cells about as large as a segment, but never more than a few cells per segment
+    glm::vec2 extent = glm::max(boundsMax - boundsMin, glm::vec2(1e-3f));
+    cellSize = requestedCellSize;
+    if (cellSize <= 0.0f) {
+        float averageLength = static_cast<float>(totalLength / static_cast<double>(segmentCount));
+        float areaPerSegment = std::sqrt(extent.x * extent.y / static_cast<float>(segmentCount));
+        cellSize = std::max(averageLength, areaPerSegment);
+    }
+    cellSize = std::max(cellSize, 1e-3f);
+    while ((extent.x / cellSize + 1.0f) * (extent.y / cellSize + 1.0f) >
+        static_cast<float>(segmentCount * MAX_CELLS_PER_SEGMENT + 1024)) {
+        cellSize *= 1.5f;
+    }
+
+    inverseCellSize = 1.0f / cellSize;
+    origin = boundsMin;
+    gridWidth = static_cast<int>(extent.x * inverseCellSize) + 1;
+    gridDepth = static_cast<int>(extent.y * inverseCellSize) + 1;
+    const size_t cellCount = static_cast<size_t>(gridWidth) * static_cast<size_t>(gridDepth);
+
+    // Counting sort into the cells: count, prefix sum, then scatter through atomic cursors
+    std::vector<std::atomic<uint32_t>> cursors(cellCount);
+    pool.parallelFor(0, segmentCount, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            CellRange range = segmentCells(static_cast<uint32_t>(s));
+            for (int z = range.z0; z <= range.z1; ++z) {
+                for (int x = range.x0; x <= range.x1; ++x) {
+                    cursors[static_cast<size_t>(z) * gridWidth + x].fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+    }, SEGMENT_CHUNK);
+
+    cellOffsets.resize(cellCount + 1);
+    cellOffsets[0] = 0;
+    for (size_t c = 0; c < cellCount; ++c) {
+        uint32_t count = cursors[c].load(std::memory_order_relaxed);
+        cellOffsets[c + 1] = cellOffsets[c] + count;
+        cursors[c].store(cellOffsets[c], std::memory_order_relaxed);
+    }
+    cellSegments.resize(cellOffsets.back());
+
+    pool.parallelFor(0, segmentCount, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s) {
+            CellRange range = segmentCells(static_cast<uint32_t>(s));
+            for (int z = range.z0; z <= range.z1; ++z) {
+                for (int x = range.x0; x <= range.x1; ++x) {
+                    uint32_t slot = cursors[static_cast<size_t>(z) * gridWidth + x].fetch_add(1, std::memory_order_relaxed);
+                    cellSegments[slot] = static_cast<uint32_t>(s);
+                }
+            }
+        }
+    }, SEGMENT_CHUNK);
+
+    // The scatter order depends on scheduling; sorted cells make results reproducible
+    pool.parallelFor(0, cellCount, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            std::sort(cellSegments.begin() + cellOffsets[c], cellSegments.begin() + cellOffsets[c + 1]);
+        }
+    }, 4096);
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "INFO: Segment index: " << segmentCount << " segments in " << gridWidth << " x " << gridDepth
+        << " cells of " << cellSize << ", " << cellSegments.size() << " entries, built in " << milliseconds << " ms." << std::endl;
+}
+
+SegmentIndex::CellRange SegmentIndex::cellRange(const glm::vec2& boxMin, const glm::vec2& boxMax) const {
+    CellRange range;
+    range.x0 = static_cast<int>(std::floor((boxMin.x - origin.x) * inverseCellSize));
+    range.z0 = static_cast<int>(std::floor((boxMin.y - origin.y) * inverseCellSize));
+    range.x1 = static_cast<int>(std::floor((boxMax.x - origin.x) * inverseCellSize));
+    range.z1 = static_cast<int>(std::floor((boxMax.y - origin.y) * inverseCellSize));
+
+    // Clamping keeps boxes outside the grid empty (x0 > x1) instead of snapping them onto the border
+    range.x0 = std::max(range.x0, 0);
+    range.z0 = std::max(range.z0, 0);
+    range.x1 = std::min(range.x1, gridWidth - 1);
+    range.z1 = std::min(range.z1, gridDepth - 1);
+    return range;
+}
+
+SegmentIndex::CellRange SegmentIndex::segmentCells(uint32_t segment) const {
+    glm::vec2 a(starts[segment].x, starts[segment].z);
+    glm::vec2 b(ends[segment].x, ends[segment].z);
+    return cellRange(glm::min(a, b), glm::max(a, b));
+}
+
+SegmentIndex::Hit SegmentIndex::closestPoint(uint32_t segment, const glm::vec2& position) const {
+    const glm::vec3& a = starts[segment];
+    const glm::vec3& b = ends[segment];
+    glm::vec2 direction(b.x - a.x, b.z - a.z);
+    float lengthSquared = glm::dot(direction, direction);
+
+    Hit hit;
+    hit.segment = segment;
+    hit.t = lengthSquared > 0.0f
+        ? glm::clamp(glm::dot(position - glm::vec2(a.x, a.z), direction) / lengthSquared, 0.0f, 1.0f)
+        : 0.0f;
+    hit.point = glm::mix(a, b, hit.t);
+    hit.distance = glm::length(position - glm::vec2(hit.point.x, hit.point.z));
+    return hit;
+}
+
+bool SegmentIndex::segmentCrossesBox(uint32_t segment, const glm::vec2& boxMin, const glm::vec2& boxMax) const {
+    // Liang-Barsky: clip the parameter range against each slab
+    glm::vec2 a(starts[segment].x, starts[segment].z);
+    glm::vec2 d = glm::vec2(ends[segment].x, ends[segment].z) - a;
+    float t0 = 0.0f;
+    float t1 = 1.0f;
+
+    for (int axis = 0; axis < 2; ++axis) {
+        if (std::abs(d[axis]) < 1e-12f) {
+            if (a[axis] < boxMin[axis] || a[axis] > boxMax[axis]) return false;
+            continue;
+        }
+        float inverse = 1.0f / d[axis];
+        float tNear = (boxMin[axis] - a[axis]) * inverse;
+        float tFar = (boxMax[axis] - a[axis]) * inverse;
+        if (tNear > tFar) std::swap(tNear, tFar);
+        t0 = std::max(t0, tNear);
+        t1 = std::min(t1, tFar);
+        if (t0 > t1) return false;
+    }
+    return true;
+}
+
+bool SegmentIndex::findNearest(const glm::vec2& position, Hit& hit, float maxDistance) const {
+    if (cellOffsets.empty()) return false;
+
+    int cx = std::clamp(static_cast<int>(std::floor((position.x - origin.x) * inverseCellSize)), 0, gridWidth - 1);
+    int cz = std::clamp(static_cast<int>(std::floor((position.y - origin.y) * inverseCellSize)), 0, gridDepth - 1);
+
+    Hit best;
+    bool found = false;
+    auto visit = [&](int x, int z) {
+        size_t cell = static_cast<size_t>(z) * gridWidth + x;
+        for (uint32_t i = cellOffsets[cell]; i < cellOffsets[cell + 1]; ++i) {
+            Hit candidate = closestPoint(cellSegments[i], position);
+            if (candidate.distance < best.distance ||
+                (candidate.distance == best.distance && candidate.segment < best.segment)) {
+                best = candidate;
+                found = true;
+            }
+        }
+    };
+
+    // Square rings around the start cell until nothing outside them can be closer
+    for (int r = 0;; ++r) {
+        int x0 = cx - r, x1 = cx + r, z0 = cz - r, z1 = cz + r;
+        for (int z = std::max(z0, 0); z <= std::min(z1, gridDepth - 1); ++z) {
+            if (z == z0 || z == z1) {
+                for (int x = std::max(x0, 0); x <= std::min(x1, gridWidth - 1); ++x) visit(x, z);
+            }
+            else {
+                if (x0 >= 0) visit(x0, z);
+                if (x1 < gridWidth) visit(x1, z);
+            }
+        }
+
+        // Unvisited cells lie beyond one of the ring's sides that is not on the grid border
+        float bound = std::numeric_limits<float>::infinity();
+        if (x0 > 0) bound = std::min(bound, std::max(0.0f, position.x - (origin.x + x0 * cellSize)));
+        if (x1 < gridWidth - 1) bound = std::min(bound, std::max(0.0f, origin.x + (x1 + 1) * cellSize - position.x));
+        if (z0 > 0) bound = std::min(bound, std::max(0.0f, position.y - (origin.y + z0 * cellSize)));
+        if (z1 < gridDepth - 1) bound = std::min(bound, std::max(0.0f, origin.y + (z1 + 1) * cellSize - position.y));
+
+        if (bound == std::numeric_limits<float>::infinity()) break;
+        if (found && best.distance <= bound) break;
+        if (bound > maxDistance) break;
+    }
+
+    if (!found || best.distance > maxDistance) return false;
+    hit = best;
+    return true;
+}
+
+void SegmentIndex::queryRadius(const glm::vec2& center, float radius, std::vector<Hit>& hits) const {
+    if (cellOffsets.empty() || radius < 0.0f) return;
+
+    CellRange range = cellRange(center - glm::vec2(radius), center + glm::vec2(radius));
+    for (int z = range.z0; z <= range.z1; ++z) {
+        for (int x = range.x0; x <= range.x1; ++x) {
+            size_t cell = static_cast<size_t>(z) * gridWidth + x;
+            for (uint32_t i = cellOffsets[cell]; i < cellOffsets[cell + 1]; ++i) {
+                uint32_t segment = cellSegments[i];
+                Hit hit = closestPoint(segment, center);
+                if (hit.distance > radius) continue;
+
+                // A segment is listed in every cell of its box; only the first shared cell reports it
+                CellRange cells = segmentCells(segment);
+                if (x != std::max(cells.x0, range.x0) || z != std::max(cells.z0, range.z0)) continue;
+                hits.push_back(hit);
+            }
+        }
+    }
+}
+
+void SegmentIndex::queryBox(const glm::vec2& boxMin, const glm::vec2& boxMax, std::vector<uint32_t>& segments) const {
+    if (cellOffsets.empty()) return;
+
+    CellRange range = cellRange(boxMin, boxMax);
+    for (int z = range.z0; z <= range.z1; ++z) {
+        for (int x = range.x0; x <= range.x1; ++x) {
+            size_t cell = static_cast<size_t>(z) * gridWidth + x;
+            for (uint32_t i = cellOffsets[cell]; i < cellOffsets[cell + 1]; ++i) {
+                uint32_t segment = cellSegments[i];
+                CellRange cells = segmentCells(segment);
+                if (x != std::max(cells.x0, range.x0) || z != std::max(cells.z0, range.z0)) continue;
+                if (segmentCrossesBox(segment, boxMin, boxMax)) segments.push_back(segment);
+            }
+        }
+    }
+}
+
+size_t SegmentIndex::getSegmentCount() const {
+    return starts.size();
+}
+
+int SegmentIndex::getSegmentPath(uint32_t segment) const {
+    return segmentPaths[segment];
+}
+
+uint32_t SegmentIndex::getSegmentStartIndex(uint32_t segment) const {
+    return segmentStartIndices[segment];
+}
+
+float SegmentIndex::getCellSize() const {
+    return cellSize;
+}
+
+void SegmentIndex::benchmark(size_t queryCount) const {
+    if (cellOffsets.empty() || queryCount == 0) return;
+
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<float> unitX(origin.x, origin.x + gridWidth * cellSize);
+    std::uniform_real_distribution<float> unitZ(origin.y, origin.y + gridDepth * cellSize);
+    std::vector<glm::vec2> queries(queryCount);
+    for (auto& query : queries) {
+        query = glm::vec2(unitX(random), unitZ(random));
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    double checksum = 0.0;
+    for (const auto& query : queries) {
+        Hit hit;
+        if (findNearest(query, hit)) checksum += hit.distance;
+    }
+    double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::cout << "INFO: Segment index: " << queryCount << " nearest queries, "
+        << microseconds / static_cast<double>(queryCount) << " us each (mean distance "
+        << checksum / static_cast<double>(queryCount) << ")." << std::endl;
+}
@@ -0,0 +1,81 @@
+// SegmentIndex.h
+
+#ifndef SEGMENT_INDEX_H
+#define SEGMENT_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Uniform grid over the XZ extent of path segments. Each cell lists the segments whose bounding
+// box overlaps it, stored as one compressed array (cell offsets plus segment IDs) that is filled
+// by a parallel counting sort. Queries are 2D; hits carry the closest point including height.
+// Queries only read the index, so any number of threads may run them at once.
+class SegmentIndex {
+public:
+    struct PathRef {
+        const glm::vec3* points = nullptr;
+        size_t count = 0;
+        int pathId = 0;  // Reported back with every hit, e.g. a TrailSet ID
+    };
+
+    struct Hit {
+        uint32_t segment = 0;
+        float distance = std::numeric_limits<float>::infinity(); // Horizontal distance to the query
+        float t = 0.0f;                                           // Position along the segment, 0..1
+        glm::vec3 point = glm::vec3(0.0f);                        // Closest point on the segment
+    };
+
+    SegmentIndex();
+
+    // cellSize <= 0 picks one from the segment lengths and the extent
+    void build(const std::vector<PathRef>& paths, float cellSize = 0.0f);
+    void clear();
+
+    // Closest segment within maxDistance; false if there is none
+    bool findNearest(const glm::vec2& position, Hit& hit,
+        float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    // Appends every segment within radius, each once, in no particular order
+    void queryRadius(const glm::vec2& center, float radius, std::vector<Hit>& hits) const;
+
+    // Appends the IDs of every segment crossing the box, each once
+    void queryBox(const glm::vec2& boxMin, const glm::vec2& boxMax, std::vector<uint32_t>& segments) const;
+
+    size_t getSegmentCount() const;
+    int getSegmentPath(uint32_t segment) const;
+    uint32_t getSegmentStartIndex(uint32_t segment) const;  // Index of the segment's first point in its path
+    float getCellSize() const;
+
+    // Times a batch of random nearest queries inside the bounds and logs the mean
+    void benchmark(size_t queryCount) const;
+
+private:
+    struct CellRange {
+        int x0, z0, x1, z1;  // Inclusive
+    };
+
+    CellRange cellRange(const glm::vec2& boxMin, const glm::vec2& boxMax) const;
+    CellRange segmentCells(uint32_t segment) const;
+    Hit closestPoint(uint32_t segment, const glm::vec2& position) const;
+    bool segmentCrossesBox(uint32_t segment, const glm::vec2& boxMin, const glm::vec2& boxMax) const;
+
+    // Segment end points, structure of arrays
+    std::vector<glm::vec3> starts;
+    std::vector<glm::vec3> ends;
+    std::vector<int> segmentPaths;
+    std::vector<uint32_t> segmentStartIndices;
+
+    // Grid in compressed rows: segments of cell c are cellSegments[cellOffsets[c] .. cellOffsets[c + 1])
+    std::vector<uint32_t> cellOffsets;
+    std::vector<uint32_t> cellSegments;
+    glm::vec2 origin;
+    float cellSize;
+    float inverseCellSize;
+    int gridWidth;
+    int gridDepth;
+};
+
+#endif // SEGMENT_INDEX_H
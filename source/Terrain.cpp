@@ -2,11 +2,114 @@
 #include "Terrain.h"
 #include <glad/glad.h>   // Include glad first
 #include "../Linker/include/stb/stb_image.h"
+#include "FractalNoise.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
 
+namespace {
+    constexpr int MATERIAL_LAYERS = 4;          // grass, dirt, rock, snow
+    constexpr int GENERATED_MATERIAL_SIZE = 256;
+
+    // Splat layer weights for one vertex from normalized altitude (0..1) and slope (0 flat, 1 vertical)
+    glm::vec4 materialWeights(float altitude, float slope) {
+        float snow = glm::smoothstep(0.62f, 0.78f, altitude) * (1.0f - glm::smoothstep(0.45f, 0.65f, slope));
+        float rock = glm::smoothstep(0.25f, 0.45f, slope) + glm::smoothstep(0.55f, 0.75f, altitude) * 0.5f;
+        float dirt = glm::smoothstep(0.08f, 0.2f, slope) * (1.0f - glm::smoothstep(0.3f, 0.45f, slope));
+        float grass = (1.0f - glm::smoothstep(0.4f, 0.6f, altitude)) * (1.0f - glm::smoothstep(0.12f, 0.3f, slope));
+
+        glm::vec4 weights(grass, dirt, rock, snow);
+        float total = weights.x + weights.y + weights.z + weights.w;
+        return total > 0.0f ? weights / total : glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+    }
+
+    // Seamless noise-tinted albedo layers, used when no material images are installed
+    std::vector<unsigned char> generateMaterialLayers() {
+        const glm::vec3 baseColors[MATERIAL_LAYERS] = {
+            glm::vec3(0.25f, 0.42f, 0.17f), // grass
+            glm::vec3(0.44f, 0.34f, 0.22f), // dirt
+            glm::vec3(0.46f, 0.44f, 0.41f), // rock
+            glm::vec3(0.92f, 0.94f, 0.97f)  // snow
+        };
+        const float contrast[MATERIAL_LAYERS] = { 0.45f, 0.35f, 0.6f, 0.12f };
+
+        const int size = GENERATED_MATERIAL_SIZE;
+        std::vector<unsigned char> pixels(static_cast<size_t>(size) * size * 4 * MATERIAL_LAYERS);
+
+        for (int layer = 0; layer < MATERIAL_LAYERS; ++layer) {
+            FractalNoise::Parameters params;
+            params.seed = 101u + layer * 7919u;
+            params.octaves = 5;
+            params.frequency = 1.0f / 32.0f;
+            FractalNoise noise(params);
+
+            for (int y = 0; y < size; ++y) {
+                for (int x = 0; x < size; ++x) {
+                    // Blending four shifted copies makes the noise wrap at the texture border
+                    float fx = static_cast<float>(x) / size;
+                    float fy = static_cast<float>(y) / size;
+                    float n = glm::mix(
+                        glm::mix(noise.sample(x, y), noise.sample(x - size, y), fx),
+                        glm::mix(noise.sample(x, y - size), noise.sample(x - size, y - size), fx), fy);
+
+                    glm::vec3 color = glm::clamp(baseColors[layer] * (1.0f + contrast[layer] * n), 0.0f, 1.0f);
+                    size_t offset = ((static_cast<size_t>(layer) * size + y) * size + x) * 4;
+                    pixels[offset + 0] = static_cast<unsigned char>(color.r * 255.0f);
+                    pixels[offset + 1] = static_cast<unsigned char>(color.g * 255.0f);
+                    pixels[offset + 2] = static_cast<unsigned char>(color.b * 255.0f);
+                    pixels[offset + 3] = 255;
+                }
+            }
+        }
+        return pixels;
+    }
+
+    // Appends, in increasing order, the parameters t in (0, 1) at which the segment a -> b (grid
+    // coordinates) crosses a grid line x = k or z = k or a cell diagonal x + z = k. Those are the
+    // only places where the triangulated surface under the segment changes slope.
+    void appendGridCrossings(const glm::vec2& a, const glm::vec2& b, float maxX, float maxZ,
+        std::vector<float>& crossings) {
+        // Crossings closer than a ten-thousandth of a cell are one vertex
+        const float length = glm::length(b - a);
+        if (length < 1e-6f) return;
+        const float minGap = 1e-4f / length;
+
+        size_t first = crossings.size();
+        auto addFamily = [&](float start, float end, float limit) {
+            float delta = end - start;
+            if (std::abs(delta) < 1e-12f) return;
+            float low = std::max(std::min(start, end), 0.0f);
+            float high = std::min(std::max(start, end), limit);
+            for (float k = std::floor(low) + 1.0f; k < high; k += 1.0f) {
+                crossings.push_back((k - start) / delta);
+            }
+        };
+        addFamily(a.x, b.x, maxX);
+        addFamily(a.y, b.y, maxZ);
+        addFamily(a.x + a.y, b.x + b.y, maxX + maxZ);
+
+        // Merge the three families and drop duplicates where lines meet at a grid vertex
+        std::sort(crossings.begin() + first, crossings.end());
+        size_t kept = first;
+        float previous = 0.0f;
+        for (size_t i = first; i < crossings.size(); ++i) {
+            float t = crossings[i];
+            if (t - previous < minGap || t > 1.0f - minGap) continue;
+            crossings[kept++] = t;
+            previous = t;
+        }
+        crossings.resize(kept);
+    }
+}
+
 Terrain::Terrain()
     : terrainShader("shaders/terrainVert.glsl", "shaders/terrainFrag.glsl"),
     terrainVAO(0), terrainVBO(0), terrainEBO(0),
+    materialTextureArray(0), splatWeightTexture(0), normalMapTexture(0),
+    meshIndexCount(0), corridorRadius(0.0f), corridorStep(1), corridorStale(false),
     width(0), height(0),
     heightScale(500.0f),
     horizontalScale(1.0f), 
@@ -86,6 +189,15 @@ bool Terrain::loadTerrainData(const std::string& texturePath) {
     calculateNormals();
     setupTerrainVAO();
 
+    splatWeights.assign(static_cast<size_t>(width) * height * 4, 0);
+    bakeSplatWeights(0, 0, width, height);
+    uploadSplatWeights(0, 0, width, height);
+    setupMaterials();
+
+    normalMap.assign(static_cast<size_t>(width) * height * 2, 0.0f);
+    bakeNormalMap(0, 0, width, height);
+    uploadNormalMap(0, 0, width, height);
+
     std::cout << "INFO: Terrain loaded with max height: " << maxHeight << std::endl;
     return true;
 }
@@ -134,22 +246,248 @@ void Terrain::calculateNormals() {
     }
 }
 
+glm::vec3 Terrain::computeVertexNormal(int x, int z) const {
+    // Same topology and unweighted face-normal sum as calculateNormals, restricted to the
+    // (up to) four grid quads that share the vertex at (x, z)
+    glm::vec3 sum(0.0f);
+    int vertexIndex = z * width + x;
+
+    for (int qz = z - 1; qz <= z; ++qz) {
+        for (int qx = x - 1; qx <= x; ++qx) {
+            if (qx < 0 || qz < 0 || qx >= width - 1 || qz >= height - 1) continue;
+
+            int topLeft = qz * width + qx;
+            int topRight = topLeft + 1;
+            int bottomLeft = (qz + 1) * width + qx;
+            int bottomRight = bottomLeft + 1;
+
+            const int triangles[2][3] = {
+                { topLeft, bottomLeft, topRight },
+                { topRight, bottomLeft, bottomRight }
+            };
+
+            for (const auto& tri : triangles) {
+                if (tri[0] != vertexIndex && tri[1] != vertexIndex && tri[2] != vertexIndex) continue;
+
+                glm::vec3 edge1 = vertices[tri[1]] - vertices[tri[0]];
+                glm::vec3 edge2 = vertices[tri[2]] - vertices[tri[0]];
+                sum += glm::normalize(glm::cross(edge1, edge2));
+            }
+        }
+    }
+
+    return glm::normalize(sum);
+}
+
+void Terrain::updateHeightRegion(const std::vector<float>& newHeights, int x0, int z0, int x1, int z1) {
+    if (newHeights.size() != heights.size()) {
+        std::cerr << "ERROR: Height update does not match terrain size!" << std::endl;
+        return;
+    }
+
+    x0 = glm::clamp(x0, 0, width);
+    x1 = glm::clamp(x1, 0, width);
+    z0 = glm::clamp(z0, 0, height);
+    z1 = glm::clamp(z1, 0, height);
+    if (x0 >= x1 || z0 >= z1) return;
+
+    // Copy the changed heights into the grid and the vertex positions
+    for (int z = z0; z < z1; ++z) {
+        for (int x = x0; x < x1; ++x) {
+            int index = z * width + x;
+            heights[index] = newHeights[index];
+            vertices[index].y = newHeights[index];
+            maxHeight = std::max(maxHeight, newHeights[index]);
+        }
+    }
+
+    // Normals of the ring around the region depend on the changed vertices as well
+    int nx0 = std::max(x0 - 1, 0);
+    int nz0 = std::max(z0 - 1, 0);
+    int nx1 = std::min(x1 + 1, width);
+    int nz1 = std::min(z1 + 1, height);
+
+    std::vector<float> rowData(static_cast<size_t>(nx1 - nx0) * 6);
+    const bool corridor = !corridorPath.empty();
+
+    glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
+    for (int z = nz0; z < nz1; ++z) {
+        size_t offset = 0;
+        for (int x = nx0; x < nx1; ++x) {
+            int index = z * width + x;
+            normals[index] = computeVertexNormal(x, z);
+            if (corridor) continue;
+
+            rowData[offset++] = vertices[index].x;
+            rowData[offset++] = vertices[index].y;
+            rowData[offset++] = vertices[index].z;
+            rowData[offset++] = normals[index].x;
+            rowData[offset++] = normals[index].y;
+            rowData[offset++] = normals[index].z;
+        }
+
+        // Each terrain row is contiguous in the interleaved VBO, so one sub-upload per row suffices
+        if (corridor) continue;
+        GLintptr byteOffset = static_cast<GLintptr>(z * width + nx0) * 6 * sizeof(float);
+        glBufferSubData(GL_ARRAY_BUFFER, byteOffset, rowData.size() * sizeof(float), rowData.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The corridor mesh packs only the vertices it uses, so it is rebuilt instead, once per batch
+    if (corridor) corridorStale = true;
+
+    // Altitude and slope changed, so the material weights did too
+    bakeSplatWeights(nx0, nz0, nx1, nz1);
+    uploadSplatWeights(nx0, nz0, nx1, nz1);
+    bakeNormalMap(nx0, nz0, nx1, nz1);
+    uploadNormalMap(nx0, nz0, nx1, nz1);
+}
+
+void Terrain::bakeSplatWeights(int x0, int z0, int x1, int z1) {
+    // Rows are independent, so split them across the pool
+    ThreadPool::getInstance().parallelFor(static_cast<size_t>(z0), static_cast<size_t>(z1), [&](size_t rowBegin, size_t rowEnd) {
+        for (int z = static_cast<int>(rowBegin); z < static_cast<int>(rowEnd); ++z) {
+            for (int x = x0; x < x1; ++x) {
+                int index = z * width + x;
+                float altitude = heightScale > 0.0f ? heights[index] / heightScale : 0.0f;
+                float slope = 1.0f - glm::clamp(normals[index].y, 0.0f, 1.0f);
+                glm::vec4 weights = materialWeights(altitude, slope);
+
+                unsigned char* texel = &splatWeights[static_cast<size_t>(index) * 4];
+                texel[0] = static_cast<unsigned char>(weights.x * 255.0f + 0.5f);
+                texel[1] = static_cast<unsigned char>(weights.y * 255.0f + 0.5f);
+                texel[2] = static_cast<unsigned char>(weights.z * 255.0f + 0.5f);
+                texel[3] = static_cast<unsigned char>(weights.w * 255.0f + 0.5f);
+            }
+        }
+    }, 16);
+}
+
+void Terrain::uploadSplatWeights(int x0, int z0, int x1, int z1) {
+    if (splatWeightTexture == 0) {
+        glGenTextures(1, &splatWeightTexture);
+        glBindTexture(GL_TEXTURE_2D, splatWeightTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, splatWeights.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return;
+    }
+
+    // Upload only the sub-rectangle, reading it straight out of the full-size array
+    glBindTexture(GL_TEXTURE_2D, splatWeightTexture);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, x0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, z0);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x0, z0, x1 - x0, z1 - z0, GL_RGBA, GL_UNSIGNED_BYTE, splatWeights.data());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Terrain::bakeNormalMap(int x0, int z0, int x1, int z1) {
+    ThreadPool::getInstance().parallelFor(static_cast<size_t>(z0), static_cast<size_t>(z1), [&](size_t rowBegin, size_t rowEnd) {
+        for (int z = static_cast<int>(rowBegin); z < static_cast<int>(rowEnd); ++z) {
+            // Clamp at the border, which turns the central difference into a one-sided one over a single cell
+            const int zUp = std::max(z - 1, 0);
+            const int zDown = std::min(z + 1, height - 1);
+            const float* rowUp = &heights[static_cast<size_t>(zUp) * width];
+            const float* rowDown = &heights[static_cast<size_t>(zDown) * width];
+            const float* row = &heights[static_cast<size_t>(z) * width];
+            const float spanZ = (zDown - zUp) * horizontalScale;
+            const float inverseSpanZ = spanZ > 0.0f ? 1.0f / spanZ : 0.0f;
+
+            for (int x = x0; x < x1; ++x) {
+                const int xLeft = std::max(x - 1, 0);
+                const int xRight = std::min(x + 1, width - 1);
+                const float spanX = (xRight - xLeft) * horizontalScale;
+                const float inverseSpanX = spanX > 0.0f ? 1.0f / spanX : 0.0f;
+
+                float dx = (row[xLeft] - row[xRight]) * inverseSpanX;
+                float dz = (rowUp[x] - rowDown[x]) * inverseSpanZ;
+                glm::vec3 normal = glm::normalize(glm::vec3(dx, 1.0f, dz));
+
+                size_t texel = (static_cast<size_t>(z) * width + x) * 2;
+                normalMap[texel + 0] = normal.x;
+                normalMap[texel + 1] = normal.z;
+            }
+        }
+    }, 16);
+}
+
+void Terrain::uploadNormalMap(int x0, int z0, int x1, int z1) {
+    if (normalMapTexture == 0) {
+        // Half floats keep the detail of shallow slopes that RGB8 would band
+        glGenTextures(1, &normalMapTexture);
+        glBindTexture(GL_TEXTURE_2D, normalMapTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, width, height, 0, GL_RG, GL_FLOAT, normalMap.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, normalMapTexture);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, x0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, z0);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x0, z0, x1 - x0, z1 - z0, GL_RG, GL_FLOAT, normalMap.data());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Terrain::setupMaterials() {
+    if (materialTextureArray != 0) return;
+
+    // Layer order must match the weight channels: grass, dirt, rock, snow
+    materialTextureArray = TextureLoader::loadTextureArray({
+        "textures/terrain/grass.png",
+        "textures/terrain/dirt.png",
+        "textures/terrain/rock.png",
+        "textures/terrain/snow.png"
+    });
+
+    if (materialTextureArray == 0) {
+        std::cout << "INFO: Terrain material images not found, generating procedural materials." << std::endl;
+        std::vector<unsigned char> pixels = generateMaterialLayers();
+        materialTextureArray = TextureLoader::createTextureArray(GENERATED_MATERIAL_SIZE, GENERATED_MATERIAL_SIZE,
+            MATERIAL_LAYERS, pixels.data());
+    }
+}
+
 void Terrain::setupTerrainVAO() {
+    if (corridorPath.empty()) {
+        uploadMesh(vertices, normals, indices);
+    }
+    else {
+        buildCorridorMesh();
+    }
+}
+
+void Terrain::uploadMesh(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& meshNormals,
+    const std::vector<GLuint>& meshIndices) {
 
     //Combines vertex positions and normals into a single vertexData
     std::vector<float> vertexData;
-    vertexData.reserve(vertices.size() * 6); // 3 for position, 3 for normal
+    vertexData.reserve(positions.size() * 6); // 3 for position, 3 for normal
 
-    for (size_t i = 0; i < vertices.size(); ++i) {
+    for (size_t i = 0; i < positions.size(); ++i) {
         // Position
-        vertexData.push_back(vertices[i].x);
-        vertexData.push_back(vertices[i].y);
-        vertexData.push_back(vertices[i].z);
+        vertexData.push_back(positions[i].x);
+        vertexData.push_back(positions[i].y);
+        vertexData.push_back(positions[i].z);
 
         // Normal
-        vertexData.push_back(normals[i].x);
-        vertexData.push_back(normals[i].y);
-        vertexData.push_back(normals[i].z);
+        vertexData.push_back(meshNormals[i].x);
+        vertexData.push_back(meshNormals[i].y);
+        vertexData.push_back(meshNormals[i].z);
     }
 
     //clean up previous data
@@ -171,7 +509,8 @@ void Terrain::setupTerrainVAO() {
 
     // Upload indice data for Index buffer
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrainEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshIndices.size() * sizeof(GLuint), meshIndices.data(), GL_STATIC_DRAW);
+    meshIndexCount = static_cast<GLsizei>(meshIndices.size());
 
     // Position attribute
     glEnableVertexAttribArray(0);
@@ -187,6 +526,168 @@ void Terrain::setupTerrainVAO() {
     std::cout << "INFO: Terrain VAO setup complete." << std::endl;
 }
 
+void Terrain::finishHeightUpdate() {
+    if (corridorStale && !corridorPath.empty()) buildCorridorMesh();
+    corridorStale = false;
+}
+
+bool Terrain::setCorridor(const std::vector<glm::vec3>& path, float radius, int coarseStep) {
+    // The full mesh is already uploaded; re-uploading the whole grid would only stall
+    if (path.empty() && corridorPath.empty()) return false;
+
+    corridorPath = path;
+    corridorRadius = std::max(radius, 0.0f);
+    corridorStep = std::max(coarseStep, 1);
+
+    // Before the heightmap is loaded the setting only waits for setupTerrainVAO
+    if (vertices.empty()) return false;
+    setupTerrainVAO();
+    return true;
+}
+
+bool Terrain::isCorridorEnabled() const {
+    return !corridorPath.empty();
+}
+
+size_t Terrain::getTriangleCount() const {
+    return static_cast<size_t>(meshIndexCount) / 3;
+}
+
+void Terrain::buildCorridorMesh() {
+    if (width < 2 || height < 2) return;
+    corridorStale = false;
+    const int step = corridorStep;
+
+    // Block edges every step vertices; the last block in each direction ends on the terrain edge
+    auto blockLines = [step](int size) {
+        std::vector<int> lines;
+        for (int i = 0; i < size - 1; i += step) lines.push_back(i);
+        lines.push_back(size - 1);
+        return lines;
+    };
+    const std::vector<int> xs = blockLines(width);
+    const std::vector<int> zs = blockLines(height);
+    const int blocksX = static_cast<int>(xs.size()) - 1;
+    const int blocksZ = static_cast<int>(zs.size()) - 1;
+
+    // Blocks whose rectangle lies within the radius of a point along the path, in grid units. The
+    // points are half a block apart, and the reach grows by half of that to cover the gaps.
+    std::vector<unsigned char> fine(static_cast<size_t>(blocksX) * blocksZ, 0);
+    const float originX = width * horizontalScale * 0.5f;
+    const float originZ = height * horizontalScale * 0.5f;
+    const float spacing = step * 0.5f;
+    const float reach = corridorRadius / horizontalScale + spacing * 0.5f;
+
+    auto markAround = [&](const glm::vec2& point) {
+        int bx0 = glm::clamp(static_cast<int>(std::floor((point.x - reach) / step)), 0, blocksX - 1);
+        int bx1 = glm::clamp(static_cast<int>(std::floor((point.x + reach) / step)), 0, blocksX - 1);
+        int bz0 = glm::clamp(static_cast<int>(std::floor((point.y - reach) / step)), 0, blocksZ - 1);
+        int bz1 = glm::clamp(static_cast<int>(std::floor((point.y + reach) / step)), 0, blocksZ - 1);
+        for (int bz = bz0; bz <= bz1; ++bz) {
+            for (int bx = bx0; bx <= bx1; ++bx) {
+                glm::vec2 closest(glm::clamp(point.x, static_cast<float>(xs[bx]), static_cast<float>(xs[bx + 1])),
+                    glm::clamp(point.y, static_cast<float>(zs[bz]), static_cast<float>(zs[bz + 1])));
+                if (glm::dot(closest - point, closest - point) <= reach * reach) fine[bz * blocksX + bx] = 1;
+            }
+        }
+    };
+
+    for (size_t i = 0; i < corridorPath.size(); ++i) {
+        glm::vec2 a((corridorPath[i].x + originX) / horizontalScale, (corridorPath[i].z + originZ) / horizontalScale);
+        if (i + 1 == corridorPath.size()) {
+            markAround(a);
+            break;
+        }
+        glm::vec2 b((corridorPath[i + 1].x + originX) / horizontalScale, (corridorPath[i + 1].z + originZ) / horizontalScale);
+        int samples = std::max(1, static_cast<int>(std::ceil(glm::length(b - a) / spacing)));
+        for (int k = 0; k < samples; ++k) {
+            markAround(glm::mix(a, b, static_cast<float>(k) / samples));
+        }
+    }
+
+    // Only the vertices the mesh uses are packed, in the order they are first referenced
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> meshNormals;
+    std::vector<GLuint> meshIndices;
+    std::vector<GLuint> packed(static_cast<size_t>(width) * height, UINT32_MAX);
+
+    auto vertexAt = [&](int x, int z) {
+        size_t index = static_cast<size_t>(z) * width + x;
+        if (packed[index] == UINT32_MAX) {
+            packed[index] = static_cast<GLuint>(positions.size());
+            positions.push_back(vertices[index]);
+            meshNormals.push_back(normals[index]);
+        }
+        return packed[index];
+    };
+
+    // Same split as the full grid, the diagonal runs from top right to bottom left
+    auto addQuad = [&](GLuint topLeft, GLuint topRight, GLuint bottomLeft, GLuint bottomRight) {
+        meshIndices.insert(meshIndices.end(), { topLeft, bottomLeft, topRight, topRight, bottomLeft, bottomRight });
+    };
+
+    // A skirt hangs from the fine edge (x0, z0)-(x1, z1) to the straight coarse edge between its corners.
+    // Either side can be the higher one, so both windings are drawn.
+    auto addSkirt = [&](int x0, int z0, int x1, int z1) {
+        int length = std::max(std::abs(x1 - x0), std::abs(z1 - z0));
+        int dx = (x1 - x0) / length;
+        int dz = (z1 - z0) / length;
+        float startHeight = heights[static_cast<size_t>(z0) * width + x0];
+        float endHeight = heights[static_cast<size_t>(z1) * width + x1];
+
+        GLuint previousTop = vertexAt(x0, z0);
+        GLuint previousBottom = previousTop;
+        for (int k = 1; k <= length; ++k) {
+            int x = x0 + dx * k;
+            int z = z0 + dz * k;
+            GLuint top = vertexAt(x, z);
+            GLuint bottom = top;
+            if (k < length) {
+                size_t index = static_cast<size_t>(z) * width + x;
+                bottom = static_cast<GLuint>(positions.size());
+                positions.push_back(glm::vec3(vertices[index].x, glm::mix(startHeight, endHeight, static_cast<float>(k) / length), vertices[index].z));
+                meshNormals.push_back(normals[index]);
+            }
+            meshIndices.insert(meshIndices.end(), {
+                previousTop, previousBottom, top, top, previousBottom, bottom,
+                previousTop, top, previousBottom, top, bottom, previousBottom });
+            previousTop = top;
+            previousBottom = bottom;
+        }
+    };
+    auto isCoarse = [&](int bx, int bz) {
+        return bx >= 0 && bz >= 0 && bx < blocksX && bz < blocksZ && !fine[bz * blocksX + bx];
+    };
+
+    size_t fineBlocks = 0;
+    for (int bz = 0; bz < blocksZ; ++bz) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            int x0 = xs[bx], x1 = xs[bx + 1];
+            int z0 = zs[bz], z1 = zs[bz + 1];
+            if (!fine[bz * blocksX + bx]) {
+                addQuad(vertexAt(x0, z0), vertexAt(x1, z0), vertexAt(x0, z1), vertexAt(x1, z1));
+                continue;
+            }
+
+            ++fineBlocks;
+            for (int z = z0; z < z1; ++z) {
+                for (int x = x0; x < x1; ++x) {
+                    addQuad(vertexAt(x, z), vertexAt(x + 1, z), vertexAt(x, z + 1), vertexAt(x + 1, z + 1));
+                }
+            }
+            if (isCoarse(bx, bz - 1)) addSkirt(x0, z0, x1, z0);
+            if (isCoarse(bx, bz + 1)) addSkirt(x0, z1, x1, z1);
+            if (isCoarse(bx - 1, bz)) addSkirt(x0, z0, x0, z1);
+            if (isCoarse(bx + 1, bz)) addSkirt(x1, z0, x1, z1);
+        }
+    }
+
+    uploadMesh(positions, meshNormals, meshIndices);
+    std::cout << "INFO: Terrain corridor: " << fineBlocks << " of " << blocksX * blocksZ << " blocks at full resolution, "
+        << positions.size() << " vertices and " << meshIndices.size() / 3 << " triangles against "
+        << indices.size() / 3 << " for the full grid." << std::endl;
+}
+
 void Terrain::render(const glm::mat4& model, const glm::mat4& view,
     const glm::mat4& projection, const glm::vec3& cameraPosition) {
     if (!terrainShader.isLoaded()) {
@@ -202,9 +703,36 @@ void Terrain::render(const glm::mat4& model, const glm::mat4& view,
     terrainShader.setVec3("viewPos", cameraPosition);
     terrainShader.setVec3("light.color", glm::vec3(1.0f));  // Set light color
 
+    // Material splatting inputs: layer array on unit 0, baked weights on unit 1
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, materialTextureArray);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, splatWeightTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, normalMapTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    terrainShader.setInt("useSplatting", 1);
+    terrainShader.setInt("useNormalMap", 1);
+    terrainShader.setInt("normalMap", 2);
+    terrainShader.setInt("materials", 0);
+    terrainShader.setInt("splatWeights", 1);
+    terrainShader.setFloat("materialTiling", 1.0f / 16.0f); // One material repeat every 16 world units
+    terrainShader.setVec2("terrainOrigin", glm::vec2(-width * horizontalScale * 0.5f, -height * horizontalScale * 0.5f));
+    terrainShader.setFloat("terrainCellSize", horizontalScale);
+    terrainShader.setVec2("terrainGridSize", glm::vec2(static_cast<float>(width), static_cast<float>(height)));
+
     //prepare OpenGL for vertex and indices rendaring
     glBindVertexArray(terrainVAO);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, meshIndexCount, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+void Terrain::renderDepth(Shader& depthShader) const {
+    depthShader.setMat4("model", glm::mat4(1.0f));
+
+    glBindVertexArray(terrainVAO);
+    glDrawElements(GL_TRIANGLES, meshIndexCount, GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
 }
 
@@ -244,6 +772,148 @@ float Terrain::getHeightAtPosition(float x, float z) const {
     return glm::mix(h0, h1, fz);
 }
 
+bool Terrain::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, glm::vec3& hit) const {
+    if (heights.empty() || glm::dot(direction, direction) < 1e-12f) return false;
+    glm::vec3 dir = glm::normalize(direction);
+
+    // March in half-cell steps until the ray is below the surface, then bisect the last step
+    float step = horizontalScale * 0.5f;
+    float previous = 0.0f;
+    if (origin.y < getHeightAtPosition(origin.x, origin.z)) return false;
+
+    for (float distance = step; distance <= maxDistance; distance += step) {
+        glm::vec3 point = origin + dir * distance;
+        if (point.y > getHeightAtPosition(point.x, point.z)) {
+            previous = distance;
+            continue;
+        }
+
+        float low = previous;
+        float high = distance;
+        for (int i = 0; i < 20; ++i) {
+            float middle = (low + high) * 0.5f;
+            glm::vec3 probe = origin + dir * middle;
+            if (probe.y > getHeightAtPosition(probe.x, probe.z)) low = middle;
+            else high = middle;
+        }
+        hit = origin + dir * high;
+        hit.y = getHeightAtPosition(hit.x, hit.z);
+        return true;
+    }
+    return false;
+}
+
+void Terrain::drapePoints(glm::vec3* points, size_t count, float heightOffset) const {
+    // Same bilinear lookup as getHeightAtPosition with the per-call constants hoisted out,
+    // split across the pool for long paths
+    const float originX = width * horizontalScale * 0.5f;
+    const float originZ = height * horizontalScale * 0.5f;
+    const float inverseScale = 1.0f / horizontalScale;
+    const float maxX = static_cast<float>(width - 1);
+    const float maxZ = static_cast<float>(height - 1);
+
+    ThreadPool::getInstance().parallelFor(0, count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            float localX = glm::clamp((points[i].x + originX) * inverseScale, 0.0f, maxX);
+            float localZ = glm::clamp((points[i].z + originZ) * inverseScale, 0.0f, maxZ);
+
+            int x0 = static_cast<int>(localX);
+            int z0 = static_cast<int>(localZ);
+            int x1 = glm::min(x0 + 1, width - 1);
+            int z1 = glm::min(z0 + 1, height - 1);
+            float fx = localX - x0;
+            float fz = localZ - z0;
+
+            const float* row0 = &heights[static_cast<size_t>(z0) * width];
+            const float* row1 = &heights[static_cast<size_t>(z1) * width];
+            float h0 = glm::mix(row0[x0], row0[x1], fx);
+            float h1 = glm::mix(row1[x0], row1[x1], fx);
+            points[i].y = glm::mix(h0, h1, fz) + heightOffset;
+        }
+    }, 4096);
+}
+
+float Terrain::meshHeight(float localX, float localZ) const {
+    // Height on the rendered triangles, whose diagonal runs from (x + 1, z) to (x, z + 1)
+    localX = glm::clamp(localX, 0.0f, static_cast<float>(width - 1));
+    localZ = glm::clamp(localZ, 0.0f, static_cast<float>(height - 1));
+    int x0 = std::min(static_cast<int>(localX), std::max(width - 2, 0));
+    int z0 = std::min(static_cast<int>(localZ), std::max(height - 2, 0));
+    int x1 = glm::min(x0 + 1, width - 1);
+    int z1 = glm::min(z0 + 1, height - 1);
+    float fx = localX - x0;
+    float fz = localZ - z0;
+
+    float h00 = heights[z0 * width + x0];
+    float h10 = heights[z0 * width + x1];
+    float h01 = heights[z1 * width + x0];
+    float h11 = heights[z1 * width + x1];
+
+    if (fx + fz <= 1.0f) {
+        return h00 + fx * (h10 - h00) + fz * (h01 - h00);      // Top-left triangle
+    }
+    return h11 + (1.0f - fx) * (h01 - h11) + (1.0f - fz) * (h10 - h11); // Bottom-right triangle
+}
+
+std::vector<glm::vec3> Terrain::drapePolyline(const std::vector<glm::vec3>& points, float heightOffset) const {
+    if (points.empty() || heights.empty()) return points;
+
+    const float originX = width * horizontalScale * 0.5f;
+    const float originZ = height * horizontalScale * 0.5f;
+    const float inverseScale = 1.0f / horizontalScale;
+    const float maxX = static_cast<float>(width - 1);
+    const float maxZ = static_cast<float>(height - 1);
+    auto toGrid = [&](const glm::vec3& point) {
+        return glm::vec2((point.x + originX) * inverseScale, (point.z + originZ) * inverseScale);
+    };
+
+    // Pass one counts the vertices each segment contributes (its start plus the crossings),
+    // pass two recomputes the same crossings and writes them at the prefix-summed offsets
+    const size_t segmentCount = points.size() - 1;
+    std::vector<size_t> offsets(segmentCount + 1, 0);
+    ThreadPool& pool = ThreadPool::getInstance();
+
+    pool.parallelFor(0, segmentCount, [&](size_t begin, size_t end) {
+        std::vector<float> crossings;
+        for (size_t i = begin; i < end; ++i) {
+            crossings.clear();
+            appendGridCrossings(toGrid(points[i]), toGrid(points[i + 1]), maxX, maxZ, crossings);
+            offsets[i + 1] = 1 + crossings.size();
+        }
+    }, 256);
+
+    for (size_t i = 0; i < segmentCount; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    std::vector<glm::vec3> draped(offsets[segmentCount] + 1);
+    pool.parallelFor(0, segmentCount, [&](size_t begin, size_t end) {
+        std::vector<float> crossings;
+        for (size_t i = begin; i < end; ++i) {
+            glm::vec2 a = toGrid(points[i]);
+            glm::vec2 b = toGrid(points[i + 1]);
+            crossings.clear();
+            appendGridCrossings(a, b, maxX, maxZ, crossings);
+
+            glm::vec3* out = &draped[offsets[i]];
+            out[0] = points[i];
+            out[0].y = meshHeight(a.x, a.y) + heightOffset;
+            for (size_t c = 0; c < crossings.size(); ++c) {
+                float t = crossings[c];
+                glm::vec2 grid = glm::mix(a, b, t);
+                out[c + 1] = glm::mix(points[i], points[i + 1], t);
+                out[c + 1].y = meshHeight(grid.x, grid.y) + heightOffset;
+            }
+        }
+    }, 256);
+
+    glm::vec3& last = draped.back();
+    last = points.back();
+    glm::vec2 lastGrid = toGrid(last);
+    last.y = meshHeight(lastGrid.x, lastGrid.y) + heightOffset;
+    return draped;
+}
+
 void Terrain::cleanup() {
     if (terrainVAO) {
         glDeleteVertexArrays(1, &terrainVAO);
@@ -253,6 +923,16 @@ void Terrain::cleanup() {
     terrainVAO = 0;
     terrainVBO = 0;
     terrainEBO = 0;
+    meshIndexCount = 0;
+
+    if (materialTextureArray) glDeleteTextures(1, &materialTextureArray);
+    if (splatWeightTexture) glDeleteTextures(1, &splatWeightTexture);
+    if (normalMapTexture) glDeleteTextures(1, &normalMapTexture);
+    materialTextureArray = 0;
+    splatWeightTexture = 0;
+    normalMapTexture = 0;
+    splatWeights.clear();
+    normalMap.clear();
 
     vertices.clear();
     indices.clear();
@@ -263,6 +943,7 @@ void Terrain::cleanup() {
 // Getters
 int Terrain::getWidth() const { return width; }
 int Terrain::getHeight() const { return height; }
+const std::vector<float>& Terrain::getHeights() const { return heights; }
 Shader& Terrain::getShader() { return terrainShader; }
 float Terrain::getHeightScale() const { return heightScale; }
 float Terrain::getHorizontalScale() const { return horizontalScale; }
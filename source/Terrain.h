@@ -4,13 +4,16 @@
 #include <vector>
 #include <string>
 #include "Shader.h"
+#include "HeightSource.h"
 
-class Terrain {
+class Terrain : public HeightSource {
 public:
     Terrain();
     bool loadTerrainData(const std::string& texturePath);
     void render(const glm::mat4& model, const glm::mat4& view,
     const glm::mat4& projection, const glm::vec3& cameraPosition);
+    // Draws the mesh with a depth-only shader whose matrices are already set
+    void renderDepth(Shader& depthShader) const;
     void cleanup();
 
     int getWidth() const;
@@ -18,25 +21,77 @@ public:
     float getHeightScale() const;
     float getHorizontalScale() const;
     float getMaxHeight() const;
-    float getHeightAtPosition(float x, float z) const;
+    float getHeightAtPosition(float x, float z) const override;
+    void drapePoints(glm::vec3* points, size_t count, float heightOffset) const override;
+
+    // Drapes a polyline onto the rendered triangles rather than the bilinear surface: a vertex is
+    // inserted wherever a segment crosses a grid edge or cell diagonal, so every segment of the
+    // result lies flat on one triangle and never cuts through a ridge. Segments run in parallel.
+    std::vector<glm::vec3> drapePolyline(const std::vector<glm::vec3>& points, float heightOffset) const;
+    // First point where the ray meets the surface within maxDistance, e.g. under the mouse cursor
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, glm::vec3& hit) const;
+    const std::vector<float>& getHeights() const;
     Shader& getShader();
 
+    // Copies the rectangle [x0, x1) x [z0, z1) of newHeights (a full width * height grid) into the terrain
+    // and refreshes only the affected vertices and normals on the CPU and the GPU. In corridor mode the
+    // mesh is only marked stale; finishHeightUpdate rebuilds it once after a batch of regions.
+    void updateHeightRegion(const std::vector<float>& newHeights, int x0, int z0, int x1, int z1);
+    void finishHeightUpdate();
+
     void setHeightScale(float scale);
     void setHorizontalScale(float scale);
 
+    // Corridor mode for DEMs too fine to draw whole: full-resolution triangles only in the blocks of
+    // coarseStep x coarseStep cells within radius of the path, one quad per block everywhere else,
+    // and vertical skirts from each fine block edge down or up to the coarse edge beside it, which
+    // seal the seam exactly. Triangles grow with the path's length instead of the map's area; the
+    // path must stay inside the corridor, since drapePolyline follows the full-resolution triangles.
+    // An empty path restores the full mesh. Returns whether the mesh was rebuilt, which changes the
+    // shadow casters; turning an already full mesh off again does nothing.
+    bool setCorridor(const std::vector<glm::vec3>& path, float radius, int coarseStep);
+    bool isCorridorEnabled() const;
+    size_t getTriangleCount() const;
+
 private:
+    float meshHeight(float localX, float localZ) const;  // Grid coordinates, clamped to the terrain
     void calculateNormals();
+    glm::vec3 computeVertexNormal(int x, int z) const;
     void setupTerrainVAO();
+    void uploadMesh(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& meshNormals,
+        const std::vector<GLuint>& meshIndices);
+    void buildCorridorMesh();
+
+    // Material splatting: per-texel layer weights from altitude and slope, plus the material array
+    void bakeSplatWeights(int x0, int z0, int x1, int z1);
+    void uploadSplatWeights(int x0, int z0, int x1, int z1);
+    void setupMaterials();
+
+    // Detail normals from central differences of the full-resolution heights, so shading
+    // does not depend on how finely the mesh is tessellated
+    void bakeNormalMap(int x0, int z0, int x1, int z1);
+    void uploadNormalMap(int x0, int z0, int x1, int z1);
 
     Shader terrainShader;
     GLuint terrainVAO;
     GLuint terrainVBO;
     GLuint terrainEBO;
+    GLuint materialTextureArray;
+    GLuint splatWeightTexture;
+    GLuint normalMapTexture;
 
     std::vector<glm::vec3> vertices;
     std::vector<glm::vec3> normals;
     std::vector<GLuint> indices;
     std::vector<float> heights;
+    std::vector<unsigned char> splatWeights; // RGBA8 per grid vertex: grass, dirt, rock, snow
+    std::vector<float> normalMap;            // Normal X and Z per grid vertex, Y is rebuilt in the shader
+    GLsizei meshIndexCount;                  // Indices in the EBO, the full grid or the corridor mesh
+
+    std::vector<glm::vec3> corridorPath;     // World-space path the corridor follows, empty when off
+    float corridorRadius;
+    int corridorStep;
+    bool corridorStale;                      // Heights changed since the corridor mesh was built
 
     int width;
     int height;
@@ -2,6 +2,7 @@
 
 #include "TextureLoader.h"
 #include "../Linker/include/stb/stb_image.h"
+#include <algorithm>
 #include <iostream>
 
 GLuint TextureLoader::loadTexture(const char* path) {
@@ -174,3 +175,60 @@ GLuint TextureLoader::loadCubemap(const std::vector<std::string>& faces) {
     // Return the generated cubemap texture ID
     return textureID;
 }
+
+
+
+GLuint TextureLoader::loadTextureArray(const std::vector<std::string>& layers) {
+    if (layers.empty()) return 0;
+
+    int width = 0, height = 0;
+    std::vector<unsigned char> pixels;
+
+    for (size_t i = 0; i < layers.size(); ++i) {
+        int layerWidth, layerHeight, nrChannels;
+
+        // Force four channels so every layer has the same layout
+        unsigned char* data = stbi_load(layers[i].c_str(), &layerWidth, &layerHeight, &nrChannels, STBI_rgb_alpha);
+        if (!data) {
+            std::cout << "Texture array layer failed to load at path: " << layers[i] << std::endl;
+            return 0;
+        }
+
+        if (i == 0) {
+            width = layerWidth;
+            height = layerHeight;
+            pixels.resize(static_cast<size_t>(width) * height * 4 * layers.size());
+        }
+        else if (layerWidth != width || layerHeight != height) {
+            std::cerr << "ERROR: Texture array layer has a different size: " << layers[i] << std::endl;
+            stbi_image_free(data);
+            return 0;
+        }
+
+        std::copy(data, data + static_cast<size_t>(width) * height * 4, pixels.begin() + i * static_cast<size_t>(width) * height * 4);
+        stbi_image_free(data);
+    }
+
+    return createTextureArray(width, height, static_cast<int>(layers.size()), pixels.data());
+}
+
+
+
+GLuint TextureLoader::createTextureArray(int width, int height, int layerCount, const unsigned char* rgbaData) {
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+
+    // Upload all layers at once; layer i starts at i * width * height * 4 bytes
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgbaData);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+    // Materials tile across the terrain, so repeat and filter trilinearly
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return textureID;
+}
@@ -8,4 +8,8 @@ class TextureLoader {
 public:
     static GLuint loadTexture(const char* path);
     static GLuint loadCubemap(const std::vector<std::string>& faces);
+
+    // RGBA8 2D texture array; all layers must have the same size. Returns 0 if any layer fails to load.
+    static GLuint loadTextureArray(const std::vector<std::string>& layers);
+    static GLuint createTextureArray(int width, int height, int layerCount, const unsigned char* rgbaData);
 };
@@ -0,0 +1,118 @@
+// ThreadPool.cpp
+
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+    : stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+ThreadPool& ThreadPool::getInstance() {
+    static ThreadPool instance; // constructed thread-safely on first use
+    return instance;
+}
+
+unsigned int ThreadPool::getThreadCount() const {
+    return static_cast<unsigned int>(workers.size());
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        tasks.push(std::move(task));
+    }
+    queueCondition.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end,
+    const std::function<void(size_t, size_t)>& body, size_t minChunk) {
+    if (end <= begin) return;
+
+    size_t count = end - begin;
+    size_t threadCount = workers.size() + 1; // workers plus the calling thread
+
+    // A few chunks per thread keeps the load balanced when chunks take uneven time
+    size_t chunkSize = std::max(std::max<size_t>(minChunk, 1), (count + threadCount * 4 - 1) / (threadCount * 4));
+    size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    if (chunkCount == 1) {
+        body(begin, end);
+        return;
+    }
+
+    // Shared between the caller and the helpers; helpers may still look at it after the caller returns
+    struct Job {
+        std::atomic<size_t> nextChunk{ 0 };
+        std::atomic<size_t> remaining{ 0 };
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+    };
+    auto job = std::make_shared<Job>();
+    job->remaining = chunkCount;
+
+    // body is only dereferenced for claimed chunks, all of which finish before this call returns
+    const auto* bodyPtr = &body;
+    auto runChunks = [job, bodyPtr, begin, end, chunkSize, chunkCount]() {
+        size_t chunk;
+        while ((chunk = job->nextChunk.fetch_add(1)) < chunkCount) {
+            size_t chunkBegin = begin + chunk * chunkSize;
+            size_t chunkEnd = std::min(end, chunkBegin + chunkSize);
+            (*bodyPtr)(chunkBegin, chunkEnd);
+
+            if (job->remaining.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(job->doneMutex);
+                job->doneCondition.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(workers.size(), chunkCount - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+        enqueue(runChunks);
+    }
+
+    // The caller works too, so nested parallelFor calls cannot deadlock on a busy pool
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(job->doneMutex);
+    job->doneCondition.wait(lock, [&job]() { return job->remaining.load() == 0; });
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
@@ -0,0 +1,47 @@
+// ThreadPool.h
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads shared by the CPU-heavy terrain and path passes.
+class ThreadPool {
+public:
+    // threadCount == 0 uses one worker per hardware thread
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Process-wide pool, created on first use
+    static ThreadPool& getInstance();
+
+    unsigned int getThreadCount() const;
+
+    // Queues a task for any worker; the caller is responsible for synchronization
+    void enqueue(std::function<void()> task);
+
+    // Splits [begin, end) into chunks of at least minChunk items and runs body(chunkBegin, chunkEnd)
+    // on the workers and the calling thread. Returns once every chunk has finished.
+    void parallelFor(size_t begin, size_t end,
+        const std::function<void(size_t, size_t)>& body, size_t minChunk = 1);
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,73 @@
+// TimeTable.cpp
+
+#include "TimeTable.h"
+#include <algorithm>
+#include <cmath>
+
+TimeTable::TimeTable()
+    : startTime(0.0) {
+}
+
+void TimeTable::build(const std::vector<double>& times, const ArcLengthTable& arcLength) {
+    clear();
+    const size_t count = arcLength.getPointCount();
+    if (times.size() != count || count < 2) return;
+
+    // Points before the first stamp start at it, later gaps and steps back repeat the previous one
+    auto first = std::find_if(times.begin(), times.end(), [](double time) { return !std::isnan(time); });
+    if (first == times.end()) return;
+    startTime = *first;
+
+    elapsed.resize(count);
+    distances.resize(count);
+    double previous = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        double time = std::isnan(times[i]) ? previous : times[i] - startTime;
+        previous = std::max(previous, time);
+        elapsed[i] = previous;
+        distances[i] = arcLength.getDistanceAtPoint(i);
+    }
+
+    if (elapsed.back() <= 0.0) clear();
+}
+
+void TimeTable::clear() {
+    elapsed.clear();
+    distances.clear();
+    startTime = 0.0;
+}
+
+bool TimeTable::isEmpty() const {
+    return elapsed.empty();
+}
+
+double TimeTable::getStartTime() const {
+    return startTime;
+}
+
+double TimeTable::getDuration() const {
+    return elapsed.empty() ? 0.0 : elapsed.back();
+}
+
+float TimeTable::getDistanceAtTime(double time) const {
+    if (elapsed.empty()) return 0.0f;
+    if (time <= 0.0) return 0.0f;
+    if (time >= elapsed.back()) return distances.back();
+
+    // First point stamped later than the time ends the segment, so equal stamps are never divided by
+    size_t end = static_cast<size_t>(std::upper_bound(elapsed.begin(), elapsed.end(), time) - elapsed.begin());
+    size_t start = end - 1;
+    double t = (time - elapsed[start]) / (elapsed[end] - elapsed[start]);
+    return distances[start] + static_cast<float>(t) * (distances[end] - distances[start]);
+}
+
+double TimeTable::getTimeAtDistance(float distance) const {
+    if (distances.empty()) return 0.0;
+    if (distance <= 0.0f) return 0.0;
+    if (distance >= distances.back()) return elapsed.back();
+
+    size_t end = static_cast<size_t>(std::upper_bound(distances.begin(), distances.end(), distance) - distances.begin());
+    size_t start = end - 1;
+    double t = static_cast<double>(distance - distances[start]) / (distances[end] - distances[start]);
+    return elapsed[start] + t * (elapsed[end] - elapsed[start]);
+}
@@ -0,0 +1,40 @@
+// TimeTable.h
+
+#ifndef TIME_TABLE_H
+#define TIME_TABLE_H
+
+#include <cstddef>
+#include <vector>
+#include "ArcLengthTable.h"
+
+// Recorded time of every path point, for replaying a hike at its real pace. Timestamps are made
+// monotonic once, so a playback time maps to its segment with a binary search and to a distance
+// along the path by interpolation; a frame costs O(log n) whether playback runs at 1x or 1000x.
+class TimeTable {
+public:
+    TimeTable();
+
+    // times[i] belongs to point i of the arc-length table, in seconds from any origin. Missing
+    // stamps (NaN) and stamps going backwards, e.g. from a clock jump, take the previous one.
+    // Stays empty when fewer than two points are timed or the whole track took no time.
+    void build(const std::vector<double>& times, const ArcLengthTable& arcLength);
+    void clear();
+
+    bool isEmpty() const;
+    double getStartTime() const;   // Stamp of the first point, Unix seconds for GPX tracks
+    double getDuration() const;    // Seconds from the first point to the last
+
+    // Distance along the path at the given seconds since the start, clamped to the recording;
+    // during a pause the distance stays where the pause began
+    float getDistanceAtTime(double elapsed) const;
+
+    // Seconds since the start at which the distance was passed, for seeking
+    double getTimeAtDistance(float distance) const;
+
+private:
+    std::vector<double> elapsed;   // Seconds since the first point, non-decreasing
+    std::vector<float> distances;  // Arc length at each point
+    double startTime;
+};
+
+#endif // TIME_TABLE_H
@@ -0,0 +1,357 @@
+// TrackFile.cpp
+
+#include "TrackFile.h"
+#include "PathLoader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    constexpr char FILE_MAGIC[4] = { 'H', 'T', 'R', 'K' };
+    constexpr uint32_t FILE_VERSION = 1;
+    constexpr size_t MAX_POINT_BYTES = 15;        // Three varints of at most five bytes
+    constexpr size_t MIN_POINT_BYTES = 3;         // Three varints of at least one byte
+    constexpr int BENCHMARK_DECODES = 20;
+
+    inline uint32_t zigzagEncode(int32_t value) {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    inline int32_t zigzagDecode(uint32_t value) {
+        return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1u)));
+    }
+
+    inline void writeVarint(std::vector<uint8_t>& output, uint32_t value) {
+        while (value >= 0x80) {
+            output.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        output.push_back(static_cast<uint8_t>(value));
+    }
+
+    // Caller guarantees MAX_POINT_BYTES / 3 readable bytes; returns nullptr on a varint longer than five bytes
+    inline const uint8_t* readVarint(const uint8_t* cursor, uint32_t& value) {
+        uint32_t byte = *cursor++;
+        value = byte & 0x7f;
+        if (byte < 0x80) return cursor;
+
+        // Track deltas are nearly always one or two bytes, so the loop rarely runs past here
+        byte = *cursor++;
+        value |= (byte & 0x7f) << 7;
+        if (byte < 0x80) return cursor;
+
+        for (int shift = 14; shift <= 28; shift += 7) {
+            byte = *cursor++;
+            value |= (byte & 0x7f) << shift;
+            if (byte < 0x80) return cursor;
+        }
+        return nullptr;
+    }
+
+    // Bounds-checked variant for the last few points of a block
+    inline const uint8_t* readVarintChecked(const uint8_t* cursor, const uint8_t* end, uint32_t& value) {
+        value = 0;
+        for (int shift = 0; shift <= 28 && cursor < end; shift += 7) {
+            uint32_t byte = *cursor++;
+            value |= (byte & 0x7f) << shift;
+            if (byte < 0x80) return cursor;
+        }
+        return nullptr;
+    }
+
+    bool quantize(const glm::vec3& point, float inverseQuantum, int32_t quantized[3]) {
+        for (int axis = 0; axis < 3; ++axis) {
+            double scaled = std::round(static_cast<double>(point[axis]) * inverseQuantum);
+            if (!(std::abs(scaled) <= 2147483647.0)) return false;
+            quantized[axis] = static_cast<int32_t>(scaled);
+        }
+        return true;
+    }
+}
+
+TrackFile::TrackFile()
+    : header{}, blocks(nullptr), payload(nullptr) {
+}
+
+bool TrackFile::write(const std::string& path, const std::vector<glm::vec3>& points, float quantum, uint32_t blockPoints) {
+    if (!(quantum > 0.0f) || blockPoints == 0 || blockPoints > MAX_BLOCK_POINTS) {
+        std::cerr << "ERROR: Invalid track quantum or block size for: " << path << std::endl;
+        return false;
+    }
+
+    const size_t blockCount = (points.size() + blockPoints - 1) / blockPoints;
+    const float inverseQuantum = 1.0f / quantum;
+    std::vector<BlockEntry> entries(blockCount);
+    std::vector<std::vector<uint8_t>> blockBytes(blockCount);
+    std::atomic<bool> inRange(true);
+
+    // Blocks are independent, so they are encoded in parallel and concatenated afterwards
+    ThreadPool::getInstance().parallelFor(0, blockCount, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            size_t first = block * blockPoints;
+            size_t last = std::min(first + blockPoints, points.size());
+            BlockEntry& entry = entries[block];
+            entry.reserved = 0;
+
+            int32_t previous[3];
+            if (!quantize(points[first], inverseQuantum, previous)) {
+                inRange = false;
+                return;
+            }
+            std::copy(previous, previous + 3, entry.first);
+
+            // Deltas wrap in 32 bits, which the decoder undoes exactly
+            std::vector<uint8_t>& bytes = blockBytes[block];
+            bytes.reserve((last - first) * 6);
+            for (size_t i = first + 1; i < last; ++i) {
+                int32_t current[3];
+                if (!quantize(points[i], inverseQuantum, current)) {
+                    inRange = false;
+                    return;
+                }
+                for (int axis = 0; axis < 3; ++axis) {
+                    uint32_t delta = static_cast<uint32_t>(current[axis]) - static_cast<uint32_t>(previous[axis]);
+                    writeVarint(bytes, zigzagEncode(static_cast<int32_t>(delta)));
+                    previous[axis] = current[axis];
+                }
+            }
+        }
+    });
+
+    if (!inRange) {
+        std::cerr << "ERROR: Track coordinates exceed the fixed-point range at quantum " << quantum << ": " << path << std::endl;
+        return false;
+    }
+
+    uint64_t payloadBytes = 0;
+    for (size_t block = 0; block < blockCount; ++block) {
+        entries[block].offset = payloadBytes;
+        payloadBytes += blockBytes[block].size();
+    }
+
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        std::cerr << "ERROR: Failed to write track file: " << path << std::endl;
+        return false;
+    }
+
+    FileHeader fileHeader = {};
+    std::memcpy(fileHeader.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    fileHeader.version = FILE_VERSION;
+    fileHeader.pointCount = points.size();
+    fileHeader.blockPoints = blockPoints;
+    fileHeader.blockCount = static_cast<uint32_t>(blockCount);
+    fileHeader.quantum = quantum;
+    fileHeader.payloadBytes = payloadBytes;
+
+    output.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    output.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(BlockEntry));
+    for (const auto& bytes : blockBytes) {
+        output.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+    return output.good();
+}
+
+bool TrackFile::convert(const std::string& textPath, const std::string& trackPath, float quantum) {
+    std::vector<glm::vec3> points;
+    if (!PathLoader::load(textPath, points).success) {
+        std::cerr << "ERROR: Failed to read path for conversion: " << textPath << std::endl;
+        return false;
+    }
+    return write(trackPath, points, quantum);
+}
+
+bool TrackFile::load(const std::string& path, std::vector<glm::vec3>& points) {
+    TrackFile track;
+    return track.open(path) && track.decodeAll(points);
+}
+
+bool TrackFile::isTrackFile(const std::string& path) {
+    if (path.size() < 4) return false;
+    std::string extension = path.substr(path.size() - 4);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".trk";
+}
+
+bool TrackFile::open(const std::string& path) {
+    close();
+    if (!file.open(path)) return false;
+
+    // Validate everything the decoder relies on, so later reads need no checks beyond the block ranges
+    const size_t size = file.size();
+    bool valid = size >= sizeof(FileHeader);
+    if (valid) {
+        std::memcpy(&header, file.data(), sizeof(FileHeader));
+        valid = std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0 && header.version == FILE_VERSION
+            && header.blockPoints > 0 && header.blockPoints <= MAX_BLOCK_POINTS && header.quantum > 0.0f
+            && header.blockCount == (header.pointCount + header.blockPoints - 1) / header.blockPoints;
+    }
+
+    const size_t indexBytes = valid ? static_cast<size_t>(header.blockCount) * sizeof(BlockEntry) : 0;
+    valid = valid && size - sizeof(FileHeader) >= indexBytes
+        && size - sizeof(FileHeader) - indexBytes >= header.payloadBytes;
+
+    // Every point after a block's first costs at least one byte per axis, so a payload too small for
+    // pointCount points is corrupt; without this check a bad header would size the decode buffer
+    valid = valid && header.pointCount - header.blockCount <= header.payloadBytes / MIN_POINT_BYTES;
+
+    if (valid) {
+        blocks = reinterpret_cast<const BlockEntry*>(file.data() + sizeof(FileHeader));
+        payload = reinterpret_cast<const uint8_t*>(file.data() + sizeof(FileHeader) + indexBytes);
+        for (size_t block = 0; block < header.blockCount && valid; ++block) {
+            uint64_t end = block + 1 < header.blockCount ? blocks[block + 1].offset : header.payloadBytes;
+            valid = blocks[block].offset <= end && end <= header.payloadBytes;
+        }
+    }
+
+    if (!valid) {
+        std::cerr << "ERROR: Not a valid track file: " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TrackFile::close() {
+    file.close();
+    header = {};
+    blocks = nullptr;
+    payload = nullptr;
+}
+
+size_t TrackFile::getPointCount() const {
+    return static_cast<size_t>(header.pointCount);
+}
+
+size_t TrackFile::getBlockCount() const {
+    return header.blockCount;
+}
+
+float TrackFile::getQuantum() const {
+    return header.quantum;
+}
+
+bool TrackFile::decodeBlock(size_t block, size_t skip, size_t count, glm::vec3* output) const {
+    const BlockEntry& entry = blocks[block];
+    const uint8_t* cursor = payload + entry.offset;
+    const uint8_t* end = payload + (block + 1 < header.blockCount ? blocks[block + 1].offset : header.payloadBytes);
+    const float quantum = header.quantum;
+
+    uint32_t x = static_cast<uint32_t>(entry.first[0]);
+    uint32_t y = static_cast<uint32_t>(entry.first[1]);
+    uint32_t z = static_cast<uint32_t>(entry.first[2]);
+    const size_t last = skip + count;
+    size_t index = 0;
+
+    while (true) {
+        if (index >= skip) {
+            *output++ = glm::vec3(static_cast<float>(static_cast<int32_t>(x)) * quantum,
+                static_cast<float>(static_cast<int32_t>(y)) * quantum,
+                static_cast<float>(static_cast<int32_t>(z)) * quantum);
+        }
+        if (++index >= last) return true;
+
+        // Unchecked reads while a whole point fits before the block end
+        uint32_t dx, dy, dz;
+        if (end - cursor >= static_cast<ptrdiff_t>(MAX_POINT_BYTES)) {
+            cursor = readVarint(cursor, dx);
+            if (cursor) cursor = readVarint(cursor, dy);
+            if (cursor) cursor = readVarint(cursor, dz);
+        }
+        else {
+            cursor = readVarintChecked(cursor, end, dx);
+            if (cursor) cursor = readVarintChecked(cursor, end, dy);
+            if (cursor) cursor = readVarintChecked(cursor, end, dz);
+        }
+        if (cursor == nullptr) return false;
+
+        x += static_cast<uint32_t>(zigzagDecode(dx));
+        y += static_cast<uint32_t>(zigzagDecode(dy));
+        z += static_cast<uint32_t>(zigzagDecode(dz));
+    }
+}
+
+bool TrackFile::decode(size_t first, size_t count, glm::vec3* output) const {
+    if (first > header.pointCount || count > header.pointCount - first) return false;
+
+    const size_t blockPoints = header.blockPoints;
+    size_t position = first;
+    const size_t end = first + count;
+    while (position < end) {
+        size_t block = position / blockPoints;
+        size_t skip = position - block * blockPoints;
+        size_t take = std::min(end - position, blockPoints - skip);
+        if (!decodeBlock(block, skip, take, output)) return false;
+
+        output += take;
+        position += take;
+    }
+    return true;
+}
+
+bool TrackFile::decodeAll(std::vector<glm::vec3>& points) const {
+    points.resize(static_cast<size_t>(header.pointCount));
+    std::atomic<bool> valid(true);
+    const size_t blockPoints = header.blockPoints;
+
+    ThreadPool::getInstance().parallelFor(0, header.blockCount, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            size_t first = block * blockPoints;
+            size_t count = std::min(blockPoints, points.size() - first);
+            if (!decodeBlock(block, 0, count, points.data() + first)) valid = false;
+        }
+    });
+
+    if (!valid) {
+        std::cerr << "ERROR: Corrupt block in track file." << std::endl;
+        points.clear();
+        return false;
+    }
+    return true;
+}
+
+void TrackFile::benchmark(const std::string& textPath) {
+    if (isTrackFile(textPath)) return;
+
+    std::string trackPath = textPath.substr(0, textPath.find_last_of('.')) + ".trk";
+    std::vector<glm::vec3> textPoints;
+    PathLoader::Result textResult = PathLoader::load(textPath, textPoints);
+    if (!textResult.success || !write(trackPath, textPoints)) {
+        std::cerr << "ERROR: Track benchmark could not convert " << textPath << std::endl;
+        return;
+    }
+
+    TrackFile track;
+    std::vector<glm::vec3> points;
+    if (!track.open(trackPath)) return;
+
+    // Small tracks decode in microseconds, so the decode is repeated for a stable figure
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < BENCHMARK_DECODES; ++i) {
+        if (!track.decodeAll(points)) return;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count()
+        / BENCHMARK_DECODES;
+
+    float worstError = 0.0f;
+    for (size_t i = 0; i < points.size() && points.size() == textPoints.size(); ++i) {
+        glm::vec3 error = glm::abs(points[i] - textPoints[i]);
+        worstError = std::max(worstError, std::max(error.x, std::max(error.y, error.z)));
+    }
+
+    size_t trackBytes = track.file.size();
+    double decodedMegabytes = static_cast<double>(points.size() * sizeof(glm::vec3)) / (1024.0 * 1024.0);
+    std::cout << "INFO: Track file " << trackPath << ": " << points.size() << " points, "
+        << static_cast<double>(trackBytes) / std::max<size_t>(points.size(), 1) << " bytes per point ("
+        << static_cast<double>(textResult.bytes) / std::max<size_t>(points.size(), 1) << " as text), worst error "
+        << worstError << "." << std::endl;
+    std::cout << "INFO: Track decode " << seconds * 1000.0 << " ms (" << (seconds > 0.0 ? decodedMegabytes / seconds : 0.0)
+        << " MB/s decoded) against " << textResult.seconds * 1000.0 << " ms for the text loader." << std::endl;
+}
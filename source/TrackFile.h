@@ -0,0 +1,84 @@
+// TrackFile.h
+
+#ifndef TRACK_FILE_H
+#define TRACK_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "MappedFile.h"
+
+// Compact binary path format (.trk). Coordinates are quantized to a fixed-point grid (1 cm by
+// default), and each point is stored as the zigzag varint deltas of its three coordinates from the
+// previous point, which takes about 5 bytes for hiking tracks against ~50 for "x y z" text. Points
+// are grouped into blocks that each start from an absolute point kept in the block index, so any
+// point range decodes without touching earlier blocks and whole files decode in parallel.
+//
+// Layout: FileHeader, blockCount BlockEntry records, then the varint payload of every block.
+class TrackFile {
+public:
+    static constexpr float DEFAULT_QUANTUM = 0.01f;
+    static constexpr uint32_t DEFAULT_BLOCK_POINTS = 4096;
+    static constexpr uint32_t MAX_BLOCK_POINTS = 1u << 20;
+
+    TrackFile();
+
+    // Quantizes and encodes the points; fails if a coordinate does not fit the fixed-point range
+    static bool write(const std::string& path, const std::vector<glm::vec3>& points,
+        float quantum = DEFAULT_QUANTUM, uint32_t blockPoints = DEFAULT_BLOCK_POINTS);
+
+    // Converts an "x y z" text path as read by PathLoader
+    static bool convert(const std::string& textPath, const std::string& trackPath, float quantum = DEFAULT_QUANTUM);
+
+    // Opens and decodes the whole file into points, which is resized to fit
+    static bool load(const std::string& path, std::vector<glm::vec3>& points);
+
+    static bool isTrackFile(const std::string& path);
+
+    // Converts a text path next to it and logs bytes per point, the worst quantization error and
+    // decode throughput against PathLoader
+    static void benchmark(const std::string& textPath);
+
+    bool open(const std::string& path);
+    void close();
+
+    size_t getPointCount() const;
+    size_t getBlockCount() const;
+    float getQuantum() const;
+
+    // Random access: decodes points [first, first + count) into output, touching only their blocks
+    bool decode(size_t first, size_t count, glm::vec3* output) const;
+
+    // Decodes every block on the ThreadPool straight into its slice of points
+    bool decodeAll(std::vector<glm::vec3>& points) const;
+
+private:
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t pointCount;
+        uint32_t blockPoints;    // Points per block, the last block may hold fewer
+        uint32_t blockCount;
+        float quantum;           // World units per fixed-point step
+        uint32_t reserved;
+        uint64_t payloadBytes;
+    };
+
+    struct BlockEntry {
+        uint64_t offset;         // Start of the block's varints, relative to the payload
+        int32_t first[3];        // Quantized first point of the block, stored outside the payload
+        uint32_t reserved;
+    };
+
+    // Decodes points [skip, skip + count) of one block
+    bool decodeBlock(size_t block, size_t skip, size_t count, glm::vec3* output) const;
+
+    MappedFile file;
+    FileHeader header;
+    const BlockEntry* blocks;
+    const uint8_t* payload;
+};
+
+#endif // TRACK_FILE_H
@@ -0,0 +1,773 @@
+// TrailGraph.cpp
+
+#include "TrailGraph.h"
+#include "PathResampler.h"
+#include "RouteStats.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <tuple>
+#include <utility>
+
+namespace {
+    constexpr size_t MIN_POINT_CHUNK = 4096;
+    constexpr int MAX_CLEANUP_PASSES = 4;
+    constexpr int HEADING_BINS = 8;                    // Undirected headings, 22.5 degrees each
+    constexpr int ATTRACTION_REACH = 2;                // Cells of half the merge radius either side
+    constexpr float PI = 3.14159265f;
+
+    // A point's contribution to one grid cell: the length-weighted centre of the track's piece inside it
+    struct Visit {
+        uint64_t key;
+        glm::vec3 sum;
+        float weight;
+    };
+
+    // Point sums of one hash cell per heading bin: xyz is the sum, w the count
+    struct CellSums {
+        uint64_t key;
+        glm::vec4 bins[HEADING_BINS];
+    };
+
+    using KeyedIndex = std::pair<uint64_t, uint32_t>;
+
+    // Sign bits are flipped so keys sort like (x, z) and each column's cells are one run
+    inline uint64_t cellKey(int x, int z) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(x) ^ 0x80000000u) << 32) | (static_cast<uint32_t>(z) ^ 0x80000000u);
+    }
+
+    inline int cellX(uint64_t key) {
+        return static_cast<int32_t>(static_cast<uint32_t>(key >> 32) ^ 0x80000000u);
+    }
+
+    inline int cellZ(uint64_t key) {
+        return static_cast<int32_t>(static_cast<uint32_t>(key) ^ 0x80000000u);
+    }
+
+    // Direction of travel folded into [0, pi), so tracks walked either way compare equal
+    inline float undirectedAngle(const glm::vec2& heading) {
+        float angle = std::atan2(heading.y, heading.x);
+        if (angle < 0.0f) angle += PI;
+        return angle >= PI ? angle - PI : angle;
+    }
+
+    inline uint64_t pointKey(const glm::vec3& point, float inverseCell) {
+        return cellKey(static_cast<int>(std::floor(point.x * inverseCell)), static_cast<int>(std::floor(point.z * inverseCell)));
+    }
+
+    // Cell keys with their point indices, sorted so each cell's points form one run
+    std::vector<KeyedIndex> buildSpatialHash(const std::vector<glm::vec3>& points, float inverseCell) {
+        std::vector<KeyedIndex> hash(points.size());
+        ThreadPool::getInstance().parallelFor(0, points.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                hash[i] = { pointKey(points[i], inverseCell), static_cast<uint32_t>(i) };
+            }
+        }, MIN_POINT_CHUNK);
+        std::sort(hash.begin(), hash.end());
+        return hash;
+    }
+
+    // Walks the cells a segment crosses, stepping one axis at a time so consecutive cells share an edge
+    void rasterizeSegment(const glm::vec3& a, const glm::vec3& b, float inverseCell, std::vector<Visit>& visits) {
+        const float ax = a.x * inverseCell;
+        const float az = a.z * inverseCell;
+        const float dx = (b.x - a.x) * inverseCell;
+        const float dz = (b.z - a.z) * inverseCell;
+        const float length = glm::length(glm::vec2(b.x - a.x, b.z - a.z));
+        constexpr float infinity = std::numeric_limits<float>::infinity();
+
+        int x = static_cast<int>(std::floor(ax));
+        int z = static_cast<int>(std::floor(az));
+        const int stepX = dx > 0.0f ? 1 : -1;
+        const int stepZ = dz > 0.0f ? 1 : -1;
+        const float deltaX = dx != 0.0f ? 1.0f / std::abs(dx) : infinity;
+        const float deltaZ = dz != 0.0f ? 1.0f / std::abs(dz) : infinity;
+        float nextX = dx > 0.0f ? (x + 1 - ax) * deltaX : dx < 0.0f ? (ax - x) * deltaX : infinity;
+        float nextZ = dz > 0.0f ? (z + 1 - az) * deltaZ : dz < 0.0f ? (az - z) * deltaZ : infinity;
+
+        const int maxSteps = std::abs(static_cast<int>(std::floor(ax + dx)) - x) + std::abs(static_cast<int>(std::floor(az + dz)) - z);
+        float t = 0.0f;
+
+        for (int step = 0; ; ++step) {
+            float exit = step < maxSteps ? std::min(std::min(nextX, nextZ), 1.0f) : 1.0f;
+            float pieceLength = (exit - t) * length + 1e-6f;
+            glm::vec3 centre = glm::mix(a, b, (t + exit) * 0.5f);
+
+            uint64_t key = cellKey(x, z);
+            if (!visits.empty() && visits.back().key == key) {
+                visits.back().sum += centre * pieceLength;
+                visits.back().weight += pieceLength;
+            }
+            else {
+                visits.push_back({ key, centre * pieceLength, pieceLength });
+            }
+
+            if (step >= maxSteps) break;
+            if (nextX < nextZ) {
+                x += stepX;
+                t = nextX;
+                nextX += deltaX;
+            }
+            else {
+                z += stepZ;
+                t = nextZ;
+                nextZ += deltaZ;
+            }
+        }
+    }
+}
+
+TrailGraph::TrailGraph()
+    : junctionCount(0), maxUsage(0) {
+}
+
+void TrailGraph::clear() {
+    vertices.clear();
+    edgeOffsets.clear();
+    edges.clear();
+    chains.clear();
+    chainPoints.clear();
+    chainVertices.clear();
+    junctionCount = 0;
+    maxUsage = 0;
+}
+
+void TrailGraph::build(const std::vector<const std::vector<glm::vec3>*>& tracks, const Options& options) {
+    clear();
+    auto startTime = std::chrono::steady_clock::now();
+    ThreadPool& pool = ThreadPool::getInstance();
+
+    const float cellSize = std::max(options.cellSize, 1e-3f);
+    const float radius = std::max(options.mergeRadius, cellSize);
+    const size_t trackCount = tracks.size();
+
+    // Stage 1: resample every track at half the cell size, so the attraction sees even point densities
+    std::vector<std::vector<glm::vec3>> resampled(trackCount);
+    PathResampler::Options resampling;
+    resampling.spacing = cellSize * 0.5f;
+    pool.parallelFor(0, trackCount, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            if (tracks[t] && tracks[t]->size() >= 2) resampled[t] = PathResampler::resample(*tracks[t], resampling);
+        }
+    });
+
+    std::vector<size_t> trackOffsets(trackCount + 1, 0);
+    for (size_t t = 0; t < trackCount; ++t) {
+        trackOffsets[t + 1] = trackOffsets[t] + resampled[t].size();
+    }
+    const size_t pointCount = trackOffsets[trackCount];
+    if (pointCount == 0) return;
+
+    // Flattened points with their XZ heading, taken across the merge radius so GPS jitter between
+    // neighbouring points does not turn it
+    const size_t headingReach = std::max<size_t>(1, static_cast<size_t>(radius / resampling.spacing));
+    std::vector<glm::vec3> points(pointCount);
+    std::vector<glm::vec2> headings(pointCount);
+    pool.parallelFor(0, trackCount, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            const std::vector<glm::vec3>& track = resampled[t];
+            for (size_t i = 0; i < track.size(); ++i) {
+                const glm::vec3& before = track[i > headingReach ? i - headingReach : 0];
+                const glm::vec3& after = track[std::min(i + headingReach, track.size() - 1)];
+                glm::vec2 direction(after.x - before.x, after.z - before.z);
+                float length = glm::length(direction);
+
+                points[trackOffsets[t] + i] = track[i];
+                headings[trackOffsets[t] + i] = length > 0.0f ? direction / length : glm::vec2(0.0f);
+            }
+            std::vector<glm::vec3>().swap(resampled[t]);
+        }
+    });
+
+    // Stage 2: pull each point towards the mean of the points around it that run parallel to it
+    // either way; Jacobi updates, so points are independent within an iteration. The hash cells are half
+    // the merge radius and keep per-heading sums, so a point reads 5x5 cell aggregates instead of
+    // every nearby point, however many tracks overlap there.
+    std::vector<uint8_t> bins(pointCount);
+    std::vector<uint8_t> binMasks(pointCount);
+    pool.parallelFor(0, pointCount, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            float angle = undirectedAngle(headings[i]);
+            bins[i] = static_cast<uint8_t>(std::min(static_cast<int>(angle / PI * HEADING_BINS), HEADING_BINS - 1));
+
+            uint8_t mask = 0;
+            for (int b = 0; b < HEADING_BINS; ++b) {
+                float difference = std::abs(angle - (b + 0.5f) * PI / HEADING_BINS);
+                if (std::min(difference, PI - difference) <= options.maxHeadingAngle) mask |= static_cast<uint8_t>(1 << b);
+            }
+            binMasks[i] = mask | static_cast<uint8_t>(1 << bins[i]);
+        }
+    }, MIN_POINT_CHUNK);
+
+    const float inverseHashCell = 2.0f / radius;
+    std::vector<glm::vec3> moved(pointCount);
+    for (int iteration = 0; iteration < options.attractionIterations; ++iteration) {
+        std::vector<KeyedIndex> hash = buildSpatialHash(points, inverseHashCell);
+
+        std::vector<size_t> runStarts;
+        for (size_t i = 0; i < hash.size(); ++i) {
+            if (i == 0 || hash[i].first != hash[i - 1].first) runStarts.push_back(i);
+        }
+        runStarts.push_back(hash.size());
+
+        std::vector<CellSums> cells(runStarts.size() - 1);
+        pool.parallelFor(0, cells.size(), [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c) {
+                CellSums& cell = cells[c];
+                cell.key = hash[runStarts[c]].first;
+                std::fill(std::begin(cell.bins), std::end(cell.bins), glm::vec4(0.0f));
+                for (size_t i = runStarts[c]; i < runStarts[c + 1]; ++i) {
+                    uint32_t point = hash[i].second;
+                    cell.bins[bins[point]] += glm::vec4(points[point], 1.0f);
+                }
+            }
+        }, 256);
+
+        pool.parallelFor(0, pointCount, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                uint64_t key = pointKey(points[i], inverseHashCell);
+                int centreX = cellX(key);
+                int centreZ = cellZ(key);
+                glm::vec4 sum(0.0f);
+
+                // One search per column, the column's cells are consecutive keys
+                for (int x = centreX - ATTRACTION_REACH; x <= centreX + ATTRACTION_REACH; ++x) {
+                    uint64_t lastKey = cellKey(x, centreZ + ATTRACTION_REACH);
+                    auto it = std::lower_bound(cells.begin(), cells.end(), cellKey(x, centreZ - ATTRACTION_REACH),
+                        [](const CellSums& cell, uint64_t value) { return cell.key < value; });
+
+                    for (; it != cells.end() && it->key <= lastKey; ++it) {
+                        for (int b = 0; b < HEADING_BINS; ++b) {
+                            if (binMasks[i] & (1 << b)) sum += it->bins[b];
+                        }
+                    }
+                }
+                if (sum.w <= 0.0f) {
+                    moved[i] = points[i];
+                    continue;
+                }
+
+                // Only sideways: along the track the mean is biased inwards near the ends, which
+                // would shorten every track and pull dead ends away from the trails they join
+                glm::vec3 mean = glm::vec3(sum) / sum.w;
+                glm::vec2 side(-headings[i].y, headings[i].x);
+                float shift = glm::dot(glm::vec2(mean.x - points[i].x, mean.z - points[i].z), side);
+                moved[i] = glm::vec3(points[i].x + side.x * shift, mean.y, points[i].z + side.y * shift);
+            }
+        }, MIN_POINT_CHUNK);
+        points.swap(moved);
+    }
+    std::vector<glm::vec2>().swap(headings);
+
+    // Stage 3: rasterize the collapsed tracks into 4-connected cells of the vertex spacing
+    const float inverseCell = 1.0f / cellSize;
+    std::vector<std::vector<Visit>> trackVisits(trackCount);
+    pool.parallelFor(0, trackCount, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            for (size_t i = trackOffsets[t]; i + 1 < trackOffsets[t + 1]; ++i) {
+                rasterizeSegment(points[i], points[i + 1], inverseCell, trackVisits[t]);
+            }
+        }
+    });
+
+    std::vector<size_t> visitOffsets(trackCount + 1, 0);
+    for (size_t t = 0; t < trackCount; ++t) {
+        visitOffsets[t + 1] = visitOffsets[t] + trackVisits[t].size();
+    }
+    const size_t visitCount = visitOffsets[trackCount];
+
+    // Stage 4: one vertex per visited cell at the weighted centre of every visit to it
+    std::vector<KeyedIndex> visitOrder(visitCount);
+    pool.parallelFor(0, trackCount, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            for (size_t i = 0; i < trackVisits[t].size(); ++i) {
+                visitOrder[visitOffsets[t] + i] = { trackVisits[t][i].key, static_cast<uint32_t>(visitOffsets[t] + i) };
+            }
+        }
+    });
+    std::sort(visitOrder.begin(), visitOrder.end());
+
+    std::vector<size_t> cellStarts;
+    std::vector<uint64_t> vertexKeys;
+    for (size_t i = 0; i < visitCount; ++i) {
+        if (i == 0 || visitOrder[i].first != visitOrder[i - 1].first) {
+            cellStarts.push_back(i);
+            vertexKeys.push_back(visitOrder[i].first);
+        }
+    }
+    cellStarts.push_back(visitCount);
+    const size_t cellCount = vertexKeys.size();
+
+    auto visitAt = [&](size_t index) -> const Visit& {
+        size_t t = std::upper_bound(visitOffsets.begin(), visitOffsets.end(), index) - visitOffsets.begin() - 1;
+        return trackVisits[t][index - visitOffsets[t]];
+    };
+
+    std::vector<glm::vec3> cellPositions(cellCount);
+    std::vector<uint32_t> visitVertices(visitCount);
+    pool.parallelFor(0, cellCount, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            glm::vec3 sum(0.0f);
+            float weight = 0.0f;
+            for (size_t i = cellStarts[c]; i < cellStarts[c + 1]; ++i) {
+                const Visit& visit = visitAt(visitOrder[i].second);
+                sum += visit.sum;
+                weight += visit.weight;
+                visitVertices[visitOrder[i].second] = static_cast<uint32_t>(c);
+            }
+            cellPositions[c] = sum / weight;
+        }
+    }, 256);
+
+    // Stage 5: steps between consecutive cells, each counted once per track that takes it
+    std::vector<std::vector<uint64_t>> trackEdges(trackCount);
+    pool.parallelFor(0, trackCount, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            std::vector<uint64_t>& steps = trackEdges[t];
+            for (size_t i = visitOffsets[t]; i + 1 < visitOffsets[t + 1]; ++i) {
+                uint32_t a = visitVertices[i];
+                uint32_t b = visitVertices[i + 1];
+                if (a != b) steps.push_back((static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b));
+            }
+            std::sort(steps.begin(), steps.end());
+            steps.erase(std::unique(steps.begin(), steps.end()), steps.end());
+        }
+    });
+
+    std::vector<uint64_t> allSteps;
+    for (auto& steps : trackEdges) {
+        allSteps.insert(allSteps.end(), steps.begin(), steps.end());
+        std::vector<uint64_t>().swap(steps);
+    }
+    std::sort(allSteps.begin(), allSteps.end());
+
+    // Both directions of every edge go into the adjacency arrays
+    std::vector<uint32_t> degrees(cellCount + 1, 0);
+    std::vector<std::pair<uint64_t, uint32_t>> uniqueSteps;
+    for (size_t i = 0; i < allSteps.size(); ) {
+        size_t j = i;
+        while (j < allSteps.size() && allSteps[j] == allSteps[i]) ++j;
+        uniqueSteps.push_back({ allSteps[i], static_cast<uint32_t>(j - i) });
+        ++degrees[allSteps[i] >> 32];
+        ++degrees[allSteps[i] & 0xFFFFFFFFu];
+        i = j;
+    }
+
+    vertices = std::move(cellPositions);
+    edgeOffsets.assign(cellCount + 1, 0);
+    for (size_t v = 0; v < cellCount; ++v) {
+        edgeOffsets[v + 1] = edgeOffsets[v] + degrees[v];
+    }
+    edges.resize(edgeOffsets[cellCount]);
+    std::vector<uint32_t> fill(edgeOffsets.begin(), edgeOffsets.end() - 1);
+    for (const auto& step : uniqueSteps) {
+        uint32_t a = static_cast<uint32_t>(step.first >> 32);
+        uint32_t b = static_cast<uint32_t>(step.first & 0xFFFFFFFFu);
+        edges[fill[a]++] = { b, step.second };
+        edges[fill[b]++] = { a, step.second };
+    }
+
+    // Stage 6: clean-up, then the chains between junctions. Pruning a spur can turn its junction
+    // into a plain trail vertex, so the chain pass repeats until the network stops changing.
+    cellKeys = std::move(vertexKeys);
+    removeStairSteps();
+    cellKeys.clear();
+    mergeSplitCells(cellSize * 0.5f);
+
+    buildChains();
+    for (int pass = 0; pass < MAX_CLEANUP_PASSES && simplifyJunctions(radius); ++pass) {
+        buildChains();
+    }
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "INFO: Trail graph: " << trackCount << " tracks, " << pointCount << " points merged into "
+        << vertices.size() << " vertices, " << junctionCount << " junctions and " << chains.size()
+        << " trail sections (max usage " << maxUsage << ") in " << milliseconds << " ms." << std::endl;
+}
+
+void TrailGraph::removeStairSteps() {
+    // Two merged tracks can round a diagonal differently, leaving a square of cells a-b-c and
+    // a-d-c. The corner with fewer tracks is a stair step: it is dropped and its tracks are
+    // credited to the other corner's edges. Removed edges keep a usage of zero until compaction.
+    auto findEdge = [&](uint32_t from, uint32_t to) -> Edge* {
+        for (uint32_t e = edgeOffsets[from]; e < edgeOffsets[from + 1]; ++e) {
+            if (edges[e].to == to && edges[e].usage > 0) return &edges[e];
+        }
+        return nullptr;
+    };
+    auto liveNeighbours = [&](uint32_t vertex, uint32_t* neighbours) {
+        uint32_t count = 0;
+        for (uint32_t e = edgeOffsets[vertex]; e < edgeOffsets[vertex + 1]; ++e) {
+            if (edges[e].usage == 0) continue;
+            if (count < 2) neighbours[count] = edges[e].to;
+            ++count;
+        }
+        return count;
+    };
+    auto cellOf = [&](uint32_t vertex) {
+        return glm::ivec2(cellX(cellKeys[vertex]), cellZ(cellKeys[vertex]));
+    };
+
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    size_t removed = 0;
+    for (uint32_t b = 0; b < vertexCount; ++b) {
+        uint32_t around[2];
+        if (liveNeighbours(b, around) != 2) continue;
+        uint32_t a = around[0];
+        uint32_t c = around[1];
+        glm::ivec2 cellA = cellOf(a);
+        glm::ivec2 cellC = cellOf(c);
+        if (std::abs(cellA.x - cellC.x) != 1 || std::abs(cellA.y - cellC.y) != 1) continue;
+
+        // The opposite corner of the square, if both of its sides exist
+        glm::ivec2 corner = cellA + cellC - cellOf(b);
+        uint32_t d = UINT32_MAX;
+        for (uint32_t e = edgeOffsets[a]; e < edgeOffsets[a + 1] && d == UINT32_MAX; ++e) {
+            if (edges[e].usage > 0 && cellOf(edges[e].to) == corner && findEdge(edges[e].to, c)) d = edges[e].to;
+        }
+        if (d == UINT32_MAX) continue;
+
+        Edge* ab = findEdge(a, b);
+        Edge* bc = findEdge(b, c);
+        Edge* ad = findEdge(a, d);
+        Edge* dc = findEdge(d, c);
+        uint32_t viaB = std::min(ab->usage, bc->usage);
+        uint32_t viaD = std::min(ad->usage, dc->usage);
+        if (viaB > viaD || (viaB == viaD && b < d)) continue;
+
+        for (auto [from, to, gain] : { std::tuple(a, d, ab->usage), std::tuple(d, c, bc->usage) }) {
+            findEdge(from, to)->usage += gain;
+            findEdge(to, from)->usage += gain;
+        }
+        for (uint32_t neighbour : { a, c }) {
+            findEdge(b, neighbour)->usage = 0;
+            findEdge(neighbour, b)->usage = 0;
+        }
+        ++removed;
+    }
+    if (removed == 0) return;
+
+    // Removed corners keep no live edges, so collapse() drops them
+    std::vector<uint32_t> identity(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v) identity[v] = v;
+    collapse(identity);
+}
+
+void TrailGraph::mergeSplitCells(float distance) {
+    // A trail whose centre line runs along a cell boundary leaves its tracks on both sides of it,
+    // two rows of cells with rungs between them. The rows' centres nearly coincide while cells
+    // along a trail lie a whole cell apart, so neighbours closer than the distance are merged,
+    // closest first, as long as every group stays within the distance of its first vertex.
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    auto planarDistance = [&](uint32_t a, uint32_t b) {
+        return glm::length(glm::vec2(vertices[a].x - vertices[b].x, vertices[a].z - vertices[b].z));
+    };
+
+    std::vector<std::pair<float, uint64_t>> candidates;
+    for (uint32_t a = 0; a < vertexCount; ++a) {
+        for (uint32_t e = edgeOffsets[a]; e < edgeOffsets[a + 1]; ++e) {
+            uint32_t b = edges[e].to;
+            float between = planarDistance(a, b);
+            if (a < b && between < distance) candidates.push_back({ between, (static_cast<uint64_t>(a) << 32) | b });
+        }
+    }
+    if (candidates.empty()) return;
+    std::sort(candidates.begin(), candidates.end());
+
+    std::vector<uint32_t> target(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v) target[v] = v;
+    auto root = [&](uint32_t v) {
+        while (target[v] != v) v = target[v] = target[target[v]];
+        return v;
+    };
+
+    for (const auto& candidate : candidates) {
+        uint32_t a = root(static_cast<uint32_t>(candidate.second >> 32));
+        uint32_t b = root(static_cast<uint32_t>(candidate.second & 0xFFFFFFFFu));
+        if (a != b && planarDistance(a, b) < distance) target[std::max(a, b)] = std::min(a, b);
+    }
+    for (uint32_t v = 0; v < vertexCount; ++v) target[v] = root(v);
+    collapse(target);
+}
+
+bool TrailGraph::simplifyJunctions(float radius) {
+    // Short dead ends and small loops off a junction are GPS noise where tracks start, stop or
+    // wander, and short sections between two junctions are one crossing split into several
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    std::vector<uint32_t> target(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v) target[v] = v;
+
+    auto root = [&](uint32_t v) {
+        while (target[v] != v && target[v] != UINT32_MAX) v = target[v];
+        return v;
+    };
+
+    bool changed = false;
+    for (const Chain& chain : chains) {
+        uint32_t fromDegree = getDegree(chain.from);
+        uint32_t toDegree = getDegree(chain.to);
+        const uint32_t* members = chainVertices.data() + chain.firstPoint;
+
+        if (chain.from == chain.to ? chain.length < 4.0f * radius
+            : chain.length < 2.0f * radius && std::min(fromDegree, toDegree) == 1 && std::max(fromDegree, toDegree) >= 3) {
+            // Everything but the junction goes
+            uint32_t junction = fromDegree >= 3 ? chain.from : chain.to;
+            for (uint32_t i = 0; i < chain.pointCount; ++i) {
+                if (members[i] != junction) target[members[i]] = UINT32_MAX;
+            }
+            changed = true;
+        }
+        else if (chain.length < 2.0f * radius && fromDegree >= 3 && toDegree >= 3) {
+            uint32_t keep = root(chain.from);
+            for (uint32_t i = 0; i < chain.pointCount; ++i) {
+                uint32_t member = root(members[i]);
+                if (member != keep && member != UINT32_MAX) target[member] = keep;
+            }
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        for (uint32_t v = 0; v < vertexCount; ++v) target[v] = target[v] == UINT32_MAX ? UINT32_MAX : root(v);
+        collapse(target);
+    }
+    return changed;
+}
+
+void TrailGraph::collapse(const std::vector<uint32_t>& target) {
+    // Surviving groups in order of their representative, positioned at the members' mean
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+    std::vector<uint32_t> degrees(vertexCount, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        if (target[v] == UINT32_MAX) continue;
+        for (uint32_t e = edgeOffsets[v]; e < edgeOffsets[v + 1]; ++e) {
+            uint32_t to = edges[e].to;
+            if (edges[e].usage > 0 && target[to] != UINT32_MAX && target[to] != target[v]) ++degrees[target[v]];
+        }
+    }
+
+    std::vector<glm::vec3> sums;
+    std::vector<float> counts;
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        if (target[v] == v && degrees[v] > 0) {
+            remap[v] = static_cast<uint32_t>(sums.size());
+            sums.push_back(glm::vec3(0.0f));
+            counts.push_back(0.0f);
+        }
+    }
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        if (target[v] == UINT32_MAX || remap[target[v]] == UINT32_MAX) continue;
+        sums[remap[target[v]]] += vertices[v];
+        counts[remap[target[v]]] += 1.0f;
+    }
+
+    // Edges between the groups; parallel ones left by a merge were taken by different tracks, so
+    // their counts add up
+    std::vector<std::pair<uint64_t, uint32_t>> merged;
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        if (target[v] == UINT32_MAX) continue;
+        uint32_t from = remap[target[v]];
+        for (uint32_t e = edgeOffsets[v]; e < edgeOffsets[v + 1]; ++e) {
+            if (edges[e].usage == 0 || target[edges[e].to] == UINT32_MAX) continue;
+            uint32_t to = remap[target[edges[e].to]];
+            if (from != UINT32_MAX && to != UINT32_MAX && from != to) {
+                merged.push_back({ (static_cast<uint64_t>(from) << 32) | to, edges[e].usage });
+            }
+        }
+    }
+    std::sort(merged.begin(), merged.end());
+
+    const uint32_t keptCount = static_cast<uint32_t>(sums.size());
+    vertices.resize(keptCount);
+    for (uint32_t v = 0; v < keptCount; ++v) vertices[v] = sums[v] / counts[v];
+
+    edges.clear();
+    edgeOffsets.assign(keptCount + 1, 0);
+    for (size_t i = 0; i < merged.size(); ++i) {
+        if (i > 0 && merged[i].first == merged[i - 1].first) {
+            edges.back().usage += merged[i].second;
+            continue;
+        }
+        edges.push_back({ static_cast<uint32_t>(merged[i].first & 0xFFFFFFFFu), merged[i].second });
+        ++edgeOffsets[(merged[i].first >> 32) + 1];
+    }
+    for (uint32_t v = 0; v < keptCount; ++v) edgeOffsets[v + 1] += edgeOffsets[v];
+}
+
+void TrailGraph::buildChains() {
+    chains.clear();
+    chainPoints.clear();
+    chainVertices.clear();
+    junctionCount = 0;
+    maxUsage = 0;
+
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    std::vector<uint8_t> walked(edges.size(), 0);
+
+    auto reverseEdge = [&](uint32_t from, uint32_t edge) {
+        uint32_t to = edges[edge].to;
+        for (uint32_t e = edgeOffsets[to]; e < edgeOffsets[to + 1]; ++e) {
+            if (edges[e].to == from) return e;
+        }
+        return edge;
+    };
+
+    // Follows degree-2 vertices from start along edge until a junction, a dead end or the start again
+    std::vector<uint32_t> usages;
+    auto walk = [&](uint32_t start, uint32_t edge) {
+        Chain chain = { static_cast<uint32_t>(chainPoints.size()), 1, start, start, 0, 0.0f };
+        chainPoints.push_back(vertices[start]);
+        chainVertices.push_back(start);
+        usages.clear();
+        uint32_t current = start;
+
+        while (true) {
+            walked[edge] = 1;
+            walked[reverseEdge(current, edge)] = 1;
+            uint32_t next = edges[edge].to;
+            usages.push_back(edges[edge].usage);
+            chain.length += glm::distance(vertices[current], vertices[next]);
+            chainPoints.push_back(vertices[next]);
+            chainVertices.push_back(next);
+            ++chain.pointCount;
+            current = next;
+
+            if (getDegree(current) != 2 || current == start) break;
+            uint32_t first = edgeOffsets[current];
+            edge = walked[first] ? first + 1 : first;
+            if (walked[edge]) break;
+        }
+
+        // The median ignores the odd cell that only a stray track crossed near the ends
+        std::nth_element(usages.begin(), usages.begin() + usages.size() / 2, usages.end());
+        chain.usage = usages[usages.size() / 2];
+        chain.to = current;
+        maxUsage = std::max(maxUsage, chain.usage);
+        chains.push_back(chain);
+    };
+
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        uint32_t degree = getDegree(v);
+        if (degree >= 3) ++junctionCount;
+        if (degree == 2) continue;
+        for (uint32_t e = edgeOffsets[v]; e < edgeOffsets[v + 1]; ++e) {
+            if (!walked[e]) walk(v, e);
+        }
+    }
+
+    // Closed loops without any junction are left over, each starts anywhere
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        for (uint32_t e = edgeOffsets[v]; e < edgeOffsets[v + 1]; ++e) {
+            if (!walked[e]) walk(v, e);
+        }
+    }
+}
+
+bool TrailGraph::isEmpty() const {
+    return vertices.empty();
+}
+
+size_t TrailGraph::getVertexCount() const {
+    return vertices.size();
+}
+
+size_t TrailGraph::getEdgeCount() const {
+    return edges.size() / 2;
+}
+
+size_t TrailGraph::getJunctionCount() const {
+    return junctionCount;
+}
+
+uint32_t TrailGraph::getMaxUsage() const {
+    return maxUsage;
+}
+
+glm::vec3 TrailGraph::getVertexPosition(uint32_t vertex) const {
+    return vertices[vertex];
+}
+
+uint32_t TrailGraph::getDegree(uint32_t vertex) const {
+    return edgeOffsets[vertex + 1] - edgeOffsets[vertex];
+}
+
+const std::vector<TrailGraph::Chain>& TrailGraph::getChains() const {
+    return chains;
+}
+
+const std::vector<glm::vec3>& TrailGraph::getChainPoints() const {
+    return chainPoints;
+}
+
+uint32_t TrailGraph::findClosestVertex(const glm::vec3& position, float& distance) const {
+    uint32_t closest = UINT32_MAX;
+    float closestSquared = std::numeric_limits<float>::infinity();
+    for (uint32_t v = 0; v < vertices.size(); ++v) {
+        glm::vec2 offset(vertices[v].x - position.x, vertices[v].z - position.z);
+        float squared = glm::dot(offset, offset);
+        if (squared < closestSquared) {
+            closestSquared = squared;
+            closest = v;
+        }
+    }
+    distance = std::sqrt(closestSquared);
+    return closest;
+}
+
+RoutePlanner::Result TrailGraph::plan(const glm::vec3& start, const glm::vec3& goal, float maxSnapDistance) const {
+    RoutePlanner::Result result;
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    float startDistance, goalDistance;
+    uint32_t source = findClosestVertex(start, startDistance);
+    uint32_t target = findClosestVertex(goal, goalDistance);
+    if (source == UINT32_MAX || startDistance > maxSnapDistance || goalDistance > maxSnapDistance) return result;
+
+    // Dijkstra; the network is small next to a terrain grid, so a binary heap is plenty
+    std::vector<float> times(vertices.size(), std::numeric_limits<float>::infinity());
+    std::vector<uint32_t> parents(vertices.size(), UINT32_MAX);
+    using Entry = std::pair<float, uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    times[source] = 0.0f;
+    open.push({ 0.0f, source });
+
+    while (!open.empty()) {
+        auto [time, vertex] = open.top();
+        open.pop();
+        if (time > times[vertex]) continue;
+        ++result.expanded;
+        if (vertex == target) break;
+
+        for (uint32_t e = edgeOffsets[vertex]; e < edgeOffsets[vertex + 1]; ++e) {
+            uint32_t next = edges[e].to;
+            glm::vec3 step = vertices[next] - vertices[vertex];
+            float run = glm::length(glm::vec2(step.x, step.z));
+            float grade = run > 1e-6f ? step.y / run : 0.0f;
+            float arrival = time + run / RouteStats::hikingSpeed(grade);
+            if (arrival < times[next]) {
+                times[next] = arrival;
+                parents[next] = vertex;
+                open.push({ arrival, next });
+            }
+        }
+    }
+
+    if (times[target] != std::numeric_limits<float>::infinity()) {
+        for (uint32_t vertex = target; vertex != UINT32_MAX; vertex = parents[vertex]) {
+            result.points.push_back(vertices[vertex]);
+        }
+        std::reverse(result.points.begin(), result.points.end());
+        result.duration = times[target];
+        result.found = true;
+    }
+
+    result.milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    return result;
+}
@@ -0,0 +1,85 @@
+// TrailGraph.h
+
+#ifndef TRAIL_GRAPH_H
+#define TRAIL_GRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "RoutePlanner.h"
+
+// Deduplicated trail network built from many overlapping recorded tracks. Points are bucketed in
+// a spatial hash of sorted cell keys; every point is pulled towards the mean of nearby points
+// heading the same way (or the opposite way), which collapses parallel recordings of one trail
+// onto its centre line while crossing trails stay apart. The collapsed tracks are rasterized into
+// 4-connected grid cells, so two trails that cross always share a cell; each visited cell becomes a
+// vertex and each step between cells an edge that counts the tracks using it. Vertices of degree
+// other than two are junctions or ends, and the runs of vertices between them form the chains
+// that are drawn. Every stage runs per track or per point on the ThreadPool.
+class TrailGraph {
+public:
+    struct Options {
+        float mergeRadius = 6.0f;          // Tracks closer than this are treated as one trail
+        float cellSize = 2.0f;             // Vertex spacing of the merged network
+        float maxHeadingAngle = 0.61f;     // Radians; points turning more than this apart do not attract
+        int attractionIterations = 3;
+    };
+
+    struct Chain {
+        uint32_t firstPoint;               // Range in getChainPoints()
+        uint32_t pointCount;
+        uint32_t from;                     // End vertices, junctions or dead ends
+        uint32_t to;
+        uint32_t usage;                    // Median number of tracks over the chain's steps
+        float length;
+    };
+
+    TrailGraph();
+
+    // Tracks are world-space polylines, e.g. TrailSet trails; replaces any previous graph
+    void build(const std::vector<const std::vector<glm::vec3>*>& tracks, const Options& options);
+    void clear();
+
+    bool isEmpty() const;
+    size_t getVertexCount() const;
+    size_t getEdgeCount() const;
+    size_t getJunctionCount() const;
+    uint32_t getMaxUsage() const;
+
+    glm::vec3 getVertexPosition(uint32_t vertex) const;
+    uint32_t getDegree(uint32_t vertex) const;
+    const std::vector<Chain>& getChains() const;
+    const std::vector<glm::vec3>& getChainPoints() const;
+
+    // Least-time route along the network between the vertices closest to start and goal, timed
+    // like RouteStats; not found if either end is further than maxSnapDistance from the network
+    RoutePlanner::Result plan(const glm::vec3& start, const glm::vec3& goal, float maxSnapDistance) const;
+
+private:
+    struct Edge {
+        uint32_t to;
+        uint32_t usage;
+    };
+
+    uint32_t findClosestVertex(const glm::vec3& position, float& distance) const;
+    void removeStairSteps();
+    void mergeSplitCells(float distance);
+    bool simplifyJunctions(float radius);
+    void buildChains();
+
+    // Merges vertex v into target[v], or drops it for UINT32_MAX, and rebuilds the adjacency
+    void collapse(const std::vector<uint32_t>& target);
+
+    std::vector<glm::vec3> vertices;
+    std::vector<uint32_t> edgeOffsets;     // Edges of vertex v are edges[edgeOffsets[v] .. edgeOffsets[v + 1])
+    std::vector<Edge> edges;               // Both directions of every undirected edge
+    std::vector<Chain> chains;
+    std::vector<glm::vec3> chainPoints;
+    std::vector<uint32_t> chainVertices;   // Vertex of each chain point
+    std::vector<uint64_t> cellKeys;        // Grid cell of each vertex, only kept while building
+    size_t junctionCount;
+    uint32_t maxUsage;
+};
+
+#endif // TRAIL_GRAPH_H
@@ -0,0 +1,452 @@
+// TrailSet.cpp
+
+#include "TrailSet.h"
+#include "GpxReader.h"
+#include "PathLoader.h"
+#include "TrackFile.h"
+#include "PathResampler.h"
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+
+namespace {
+    constexpr size_t MIN_POINT_CAPACITY = 1 << 16;
+    constexpr size_t MIN_COLOR_CAPACITY = 64;
+    constexpr GLuint INVALID_STRIP_ID = 0xFFFFFFFFu; // Marks freed points so no joint ever reaches into them
+    constexpr float TRAIL_WIDTH_PIXELS = 2.5f;
+    constexpr float TRAIL_HEIGHT_OFFSET = 0.5f;      // Same lift above the ground as the hiker's path
+    constexpr size_t TRAIL_PROFILE_SAMPLES = 128;
+
+    glm::u8vec4 toBytes(const glm::vec4& color) {
+        return glm::u8vec4(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    // Evenly spread, saturated hues so neighbouring trails are easy to tell apart
+    glm::vec4 paletteColor(size_t index) {
+        float hue = std::fmod(static_cast<float>(index) * 0.618034f, 1.0f) * 6.0f;
+        float saturation = 0.65f;
+        float value = 0.95f;
+
+        float chroma = value * saturation;
+        float x = chroma * (1.0f - std::abs(std::fmod(hue, 2.0f) - 1.0f));
+        glm::vec3 rgb;
+        if (hue < 1.0f) rgb = glm::vec3(chroma, x, 0.0f);
+        else if (hue < 2.0f) rgb = glm::vec3(x, chroma, 0.0f);
+        else if (hue < 3.0f) rgb = glm::vec3(0.0f, chroma, x);
+        else if (hue < 4.0f) rgb = glm::vec3(0.0f, x, chroma);
+        else if (hue < 5.0f) rgb = glm::vec3(x, 0.0f, chroma);
+        else rgb = glm::vec3(chroma, 0.0f, x);
+        return glm::vec4(rgb + (value - chroma), 1.0f);
+    }
+
+    // Replaces buffer with a larger one holding the same first usedBytes, copied on the GPU
+    void growBuffer(GLuint& buffer, GLuint texture, GLenum format, size_t usedBytes, size_t newBytes) {
+        GLuint grown = 0;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_DYNAMIC_DRAW);
+
+        if (buffer != 0) {
+            if (usedBytes > 0) {
+                glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+                glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &buffer);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        buffer = grown;
+
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+}
+
+TrailSet::TrailSet()
+    : usedPoints(0), pointCapacity(0), colorCapacity(0), livePoints(0),
+    vao(0), positionBuffer(0), positionTexture(0),
+    stripIdBuffer(0), stripIdTexture(0),
+    colorBuffer(0), colorTexture(0),
+    drawListDirty(false) {
+}
+
+bool TrailSet::initialize() {
+    if (vao != 0) return true;
+
+    glGenVertexArrays(1, &vao);
+    glGenTextures(1, &positionTexture);
+    glGenTextures(1, &stripIdTexture);
+    glGenTextures(1, &colorTexture);
+    glGenBuffers(1, &colorBuffer);
+
+    if (vao == 0 || positionTexture == 0 || stripIdTexture == 0 || colorTexture == 0) {
+        std::cerr << "ERROR: Failed to create trail set buffers." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void TrailSet::reserve(size_t requiredPoints) {
+    if (requiredPoints <= pointCapacity) return;
+
+    // Doubling keeps the number of copies logarithmic in the network size
+    size_t capacity = std::max({ requiredPoints, pointCapacity * 2, MIN_POINT_CAPACITY });
+
+    // Positions as single floats, like PolylineRenderer: RGB32F buffer textures need GL 4.0
+    growBuffer(positionBuffer, positionTexture, GL_R32F, usedPoints * sizeof(glm::vec3), capacity * sizeof(glm::vec3));
+    growBuffer(stripIdBuffer, stripIdTexture, GL_R32UI, usedPoints * sizeof(GLuint), capacity * sizeof(GLuint));
+    pointCapacity = capacity;
+}
+
+size_t TrailSet::allocate(size_t count) {
+    // First fit among the holes left by removed trails
+    for (size_t i = 0; i < freeRanges.size(); ++i) {
+        Range& range = freeRanges[i];
+        if (range.count < count) continue;
+
+        size_t offset = range.offset;
+        range.offset += count;
+        range.count -= count;
+        if (range.count == 0) freeRanges.erase(freeRanges.begin() + i);
+        return offset;
+    }
+
+    // Otherwise append; freed ranges never touch the end, release() trims them off
+    size_t offset = usedPoints;
+    reserve(usedPoints + count);
+    usedPoints += count;
+    return offset;
+}
+
+void TrailSet::release(size_t offset, size_t count) {
+    writeStripIds(offset, count, INVALID_STRIP_ID);
+
+    // Insert sorted and merge with the neighbours
+    auto it = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset,
+        [](const Range& range, size_t value) { return range.offset < value; });
+    it = freeRanges.insert(it, { offset, count });
+
+    auto next = it + 1;
+    if (next != freeRanges.end() && it->offset + it->count == next->offset) {
+        it->count += next->count;
+        freeRanges.erase(next);
+    }
+    if (it != freeRanges.begin()) {
+        auto previous = it - 1;
+        if (previous->offset + previous->count == it->offset) {
+            previous->count += it->count;
+            it = freeRanges.erase(it) - 1;
+        }
+    }
+
+    // A hole at the end just lowers the high-water mark
+    if (it->offset + it->count == usedPoints) {
+        usedPoints = it->offset;
+        freeRanges.erase(it);
+    }
+}
+
+void TrailSet::writeStripIds(size_t offset, size_t count, GLuint id) {
+    std::vector<GLuint> ids(count, id);
+    glBindBuffer(GL_TEXTURE_BUFFER, stripIdBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, offset * sizeof(GLuint), count * sizeof(GLuint), ids.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void TrailSet::writeColor(int id) {
+    glBindBuffer(GL_TEXTURE_BUFFER, colorBuffer);
+
+    if (trails.size() > colorCapacity) {
+        // The table is a few bytes per trail, re-uploading it whole when it grows is cheap
+        colorCapacity = std::max({ trails.size(), colorCapacity * 2, MIN_COLOR_CAPACITY });
+        std::vector<glm::u8vec4> colors(colorCapacity, glm::u8vec4(255));
+        for (size_t i = 0; i < trails.size(); ++i) {
+            colors[i] = toBytes(trails[i].color);
+        }
+        glBufferData(GL_TEXTURE_BUFFER, colors.size() * sizeof(glm::u8vec4), colors.data(), GL_DYNAMIC_DRAW);
+
+        glBindTexture(GL_TEXTURE_BUFFER, colorTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA8, colorBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    else {
+        glm::u8vec4 color = toBytes(trails[id].color);
+        glBufferSubData(GL_TEXTURE_BUFFER, id * sizeof(glm::u8vec4), sizeof(glm::u8vec4), &color);
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+int TrailSet::addTrail(const std::vector<glm::vec3>& points, const glm::vec4& color, const std::string& name) {
+    if (points.size() < 2) {
+        std::cerr << "ERROR: Trail " << name << " needs at least two points." << std::endl;
+        return INVALID_TRAIL;
+    }
+    if (vao == 0 && !initialize()) return INVALID_TRAIL;
+
+    int id;
+    if (!freeIds.empty()) {
+        id = freeIds.back();
+        freeIds.pop_back();
+    }
+    else {
+        id = static_cast<int>(trails.size());
+        trails.emplace_back();
+    }
+
+    Trail& trail = trails[id];
+    trail.offset = allocate(points.size());
+    trail.count = points.size();
+    trail.points = points;
+    trail.stats.compute(points, TRAIL_PROFILE_SAMPLES);
+    trail.color = color;
+    trail.name = name;
+    trail.active = true;
+    trail.visible = true;
+
+    // Only this trail's range is written
+    glBindBuffer(GL_TEXTURE_BUFFER, positionBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, trail.offset * sizeof(glm::vec3), trail.count * sizeof(glm::vec3), points.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    writeStripIds(trail.offset, trail.count, static_cast<GLuint>(id));
+    writeColor(id);
+
+    livePoints += trail.count;
+    drawListDirty = true;
+    return id;
+}
+
+bool TrailSet::removeTrail(int id) {
+    if (id < 0 || id >= static_cast<int>(trails.size()) || !trails[id].active) return false;
+
+    Trail& trail = trails[id];
+    release(trail.offset, trail.count);
+    livePoints -= trail.count;
+    trail = Trail();
+    freeIds.push_back(id);
+    drawListDirty = true;
+    return true;
+}
+
+void TrailSet::setTrailColor(int id, const glm::vec4& color) {
+    if (id < 0 || id >= static_cast<int>(trails.size()) || !trails[id].active) return;
+    trails[id].color = color;
+    writeColor(id);
+}
+
+void TrailSet::setTrailVisible(int id, bool visible) {
+    if (id < 0 || id >= static_cast<int>(trails.size()) || !trails[id].active) return;
+    if (trails[id].visible == visible) return;
+    trails[id].visible = visible;
+    drawListDirty = true;
+}
+
+size_t TrailSet::loadDirectory(const std::string& directory, const Terrain& terrain) {
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    if (!fs::is_directory(directory, error)) return 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+        if (!entry.is_regular_file()) continue;
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (extension == ".txt" || extension == ".gpx" || extension == ".trk") files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+
+    // Every GPX file is projected around the same origin so the trails line up
+    glm::dvec2 gpxOrigin(std::numeric_limits<double>::quiet_NaN());
+    std::vector<std::vector<glm::vec3>> paths;
+    std::vector<std::string> names;
+    glm::vec2 minPoint(FLT_MAX);
+    glm::vec2 maxPoint(-FLT_MAX);
+
+    for (const fs::path& file : files) {
+        std::vector<glm::vec3> points;
+        std::string path = file.string();
+        bool loaded = GpxReader::isGpxFile(path) ? GpxReader::loadPath(path, points, nullptr, &gpxOrigin)
+            : TrackFile::isTrackFile(path) ? TrackFile::load(path, points)
+            : PathLoader::load(path, points).success;
+        if (!loaded || points.size() < 2) {
+            std::cerr << "ERROR: Skipping trail file: " << path << std::endl;
+            continue;
+        }
+
+        for (const auto& point : points) {
+            minPoint = glm::min(minPoint, glm::vec2(point.x, point.z));
+            maxPoint = glm::max(maxPoint, glm::vec2(point.x, point.z));
+        }
+        paths.push_back(std::move(points));
+        names.push_back(file.stem().string());
+    }
+    if (paths.empty()) return 0;
+
+    // One uniform scale for the whole network, centred on the terrain like the hiker's path
+    float terrainWidth = terrain.getWidth() * terrain.getHorizontalScale();
+    float terrainDepth = terrain.getHeight() * terrain.getHorizontalScale();
+    glm::vec2 range = glm::max(maxPoint - minPoint, glm::vec2(1e-6f));
+    float scale = std::min(terrainWidth / range.x, terrainDepth / range.y) * 0.8f;
+    glm::vec2 center = (minPoint + maxPoint) * 0.5f;
+
+    PathResampler::Options options;
+    options.spacing = terrain.getHorizontalScale();
+
+    size_t added = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        for (auto& point : paths[i]) {
+            point.x = (point.x - center.x) * scale;
+            point.z = (point.z - center.y) * scale;
+        }
+
+        // Draped onto the rendered triangles like the hiker's path, so depth testing hides only what is really behind a ridge
+        std::vector<glm::vec3> draped = terrain.drapePolyline(PathResampler::resample(paths[i], options), TRAIL_HEIGHT_OFFSET);
+
+        int id = addTrail(draped, paletteColor(trails.size()), names[i]);
+        if (id != INVALID_TRAIL) {
+            std::cout << "INFO: Trail " << names[i] << ": " << RouteStats::format(trails[id].stats.getSummary()) << std::endl;
+            ++added;
+        }
+    }
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "INFO: Trail network: " << added << " trails, " << livePoints << " points loaded from "
+        << directory << " in " << milliseconds << " ms." << std::endl;
+    return added;
+}
+
+size_t TrailSet::loadGraph(const TrailGraph& graph, const Terrain& terrain) {
+    for (int id = 0; id < getTrailIdLimit(); ++id) {
+        if (isTrailActive(id)) removeTrail(id);
+    }
+
+    // Usage on a log scale, a few popular trails would otherwise leave everything else blue
+    const float maxUsage = std::log(static_cast<float>(std::max(graph.getMaxUsage(), 1u)) + 1.0f);
+    const std::vector<glm::vec3>& points = graph.getChainPoints();
+
+    size_t added = 0;
+    for (const TrailGraph::Chain& chain : graph.getChains()) {
+        std::vector<glm::vec3> section(points.begin() + chain.firstPoint, points.begin() + chain.firstPoint + chain.pointCount);
+        float busy = std::log(static_cast<float>(chain.usage) + 1.0f) / maxUsage;
+        glm::vec4 color(glm::mix(glm::vec3(0.2f, 0.45f, 1.0f), glm::vec3(1.0f, 0.2f, 0.1f), busy), 1.0f);
+
+        std::string name = "section " + std::to_string(added) + " (" + std::to_string(chain.usage) + " tracks)";
+        if (addTrail(terrain.drapePolyline(section, TRAIL_HEIGHT_OFFSET), color, name) != INVALID_TRAIL) ++added;
+    }
+    return added;
+}
+
+size_t TrailSet::getTrailCount() const {
+    return trails.size() - freeIds.size();
+}
+
+size_t TrailSet::getPointCount() const {
+    return livePoints;
+}
+
+int TrailSet::getTrailIdLimit() const {
+    return static_cast<int>(trails.size());
+}
+
+bool TrailSet::isTrailActive(int id) const {
+    return id >= 0 && id < static_cast<int>(trails.size()) && trails[id].active;
+}
+
+const std::vector<glm::vec3>& TrailSet::getTrailPoints(int id) const {
+    static const std::vector<glm::vec3> empty;
+    return isTrailActive(id) ? trails[id].points : empty;
+}
+
+const std::string& TrailSet::getTrailName(int id) const {
+    static const std::string empty;
+    return isTrailActive(id) ? trails[id].name : empty;
+}
+
+const RouteStats& TrailSet::getTrailStats(int id) const {
+    static const RouteStats empty;
+    return isTrailActive(id) ? trails[id].stats : empty;
+}
+
+void TrailSet::rebuildDrawList() {
+    drawFirsts.clear();
+    drawCounts.clear();
+
+    // Each trail is a range of whole segments; the shader derives the segment from the vertex ID
+    for (const Trail& trail : trails) {
+        if (!trail.active || !trail.visible) continue;
+        drawFirsts.push_back(static_cast<GLint>(trail.offset * PolylineRenderer::VERTICES_PER_SEGMENT));
+        drawCounts.push_back(static_cast<GLsizei>((trail.count - 1) * PolylineRenderer::VERTICES_PER_SEGMENT));
+    }
+    drawListDirty = false;
+}
+
+void TrailSet::render(const glm::mat4& view, const glm::mat4& projection, Shader& shader) {
+    if (vao == 0) return;
+    if (drawListDirty) rebuildDrawList();
+    if (drawFirsts.empty()) return;
+
+    PolylineRenderer::Style style;
+    style.width = TRAIL_WIDTH_PIXELS;
+    style.color = glm::vec4(1.0f, 1.0f, 1.0f, 0.9f);
+
+    PolylineRenderer::applyStyle(shader, view, projection, style);
+    shader.setInt("packedStrips", 1);
+    shader.setInt("firstVertex", 0);
+    shader.setInt("vertexCount", static_cast<int>(usedPoints));
+    shader.setInt("useColors", 0);
+    shader.setInt("useIndices", 0);
+
+    glActiveTexture(GL_TEXTURE0 + PolylineRenderer::POSITION_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, positionTexture);
+    glActiveTexture(GL_TEXTURE0 + PolylineRenderer::STRIP_ID_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, stripIdTexture);
+    glActiveTexture(GL_TEXTURE0 + PolylineRenderer::STRIP_COLOR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, colorTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+
+    // The whole network in one call
+    glBindVertexArray(vao);
+    glMultiDrawArrays(GL_TRIANGLES, drawFirsts.data(), drawCounts.data(), static_cast<GLsizei>(drawFirsts.size()));
+    glBindVertexArray(0);
+
+    glDepthMask(GL_TRUE);
+    if (!depthTest) glDisable(GL_DEPTH_TEST);
+}
+
+void TrailSet::cleanup() {
+    if (vao) glDeleteVertexArrays(1, &vao);
+    for (GLuint* texture : { &positionTexture, &stripIdTexture, &colorTexture }) {
+        if (*texture) glDeleteTextures(1, texture);
+        *texture = 0;
+    }
+    for (GLuint* buffer : { &positionBuffer, &stripIdBuffer, &colorBuffer }) {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    vao = 0;
+
+    trails.clear();
+    freeIds.clear();
+    freeRanges.clear();
+    drawFirsts.clear();
+    drawCounts.clear();
+    usedPoints = 0;
+    pointCapacity = 0;
+    colorCapacity = 0;
+    livePoints = 0;
+    drawListDirty = false;
+}
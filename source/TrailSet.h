@@ -0,0 +1,104 @@
+// TrailSet.h
+
+#ifndef TRAIL_SET_H
+#define TRAIL_SET_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "Shader.h"
+#include "Terrain.h"
+#include "PolylineRenderer.h"
+#include "RouteStats.h"
+#include "TrailGraph.h"
+
+// A network of trails packed into one shared point buffer. Each trail owns a contiguous range
+// found in a first-fit free list, so adding or removing one only writes that range; the buffer
+// grows by doubling with a GPU-side copy. All visible trails are drawn with one glMultiDrawArrays
+// through the polyline shader in packed mode, which looks up each trail's colour by its ID.
+class TrailSet {
+public:
+    static constexpr int INVALID_TRAIL = -1;
+
+    TrailSet();
+
+    bool initialize();
+
+    // Points are world-space and already draped; returns the trail ID or INVALID_TRAIL
+    int addTrail(const std::vector<glm::vec3>& points, const glm::vec4& color, const std::string& name = "");
+    bool removeTrail(int id);
+    void setTrailColor(int id, const glm::vec4& color);
+    void setTrailVisible(int id, bool visible);
+
+    // Loads every .txt, .gpx and .trk file in the directory, fitted into the terrain in one shared frame;
+    // returns the number of trails added
+    size_t loadDirectory(const std::string& directory, const Terrain& terrain);
+
+    // Replaces the trails with the graph's sections, draped and shaded from blue for the least
+    // walked to red for the busiest; returns the number of trails added
+    size_t loadGraph(const TrailGraph& graph, const Terrain& terrain);
+
+    size_t getTrailCount() const;
+    size_t getPointCount() const;
+
+    // Highest ID handed out so far plus one; removed IDs in between are inactive
+    int getTrailIdLimit() const;
+    bool isTrailActive(int id) const;
+
+    // CPU copy of a trail's points, e.g. for spatial queries; empty for inactive IDs
+    const std::vector<glm::vec3>& getTrailPoints(int id) const;
+    const std::string& getTrailName(int id) const;
+    const RouteStats& getTrailStats(int id) const;
+
+    void render(const glm::mat4& view, const glm::mat4& projection, Shader& shader);
+    void cleanup();
+
+private:
+    struct Trail {
+        size_t offset = 0;       // First point in the shared buffer
+        size_t count = 0;
+        std::vector<glm::vec3> points;
+        RouteStats stats;
+        glm::vec4 color = glm::vec4(1.0f);
+        std::string name;
+        bool active = false;
+        bool visible = true;
+    };
+
+    struct Range {
+        size_t offset;
+        size_t count;
+    };
+
+    size_t allocate(size_t count);
+    void release(size_t offset, size_t count);
+    void reserve(size_t pointCapacity);
+    void writeStripIds(size_t offset, size_t count, GLuint id);
+    void writeColor(int id);
+    void rebuildDrawList();
+
+    std::vector<Trail> trails;       // Indexed by trail ID
+    std::vector<int> freeIds;
+    std::vector<Range> freeRanges;   // Sorted by offset, adjacent ranges merged
+    size_t usedPoints;               // High-water mark of the shared buffer
+    size_t pointCapacity;
+    size_t colorCapacity;            // Trail slots in the colour table
+    size_t livePoints;
+
+    GLuint vao;
+    GLuint positionBuffer;
+    GLuint positionTexture;
+    GLuint stripIdBuffer;
+    GLuint stripIdTexture;
+    GLuint colorBuffer;
+    GLuint colorTexture;
+
+    // glMultiDrawArrays arguments, rebuilt only when trails change
+    std::vector<GLint> drawFirsts;
+    std::vector<GLsizei> drawCounts;
+    bool drawListDirty;
+};
+
+#endif // TRAIL_SET_H